@@ -13,7 +13,7 @@
 //#include "stb_image_write.h"
 
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
-//#include "stb_image_resize2.h"
+#include "stb_image_resize2.h"
 
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "stb_truetype.h"
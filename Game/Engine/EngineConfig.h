@@ -2,6 +2,9 @@
 
 #define ENABLE_SRGB 1
 
+// texturecache::Save decodes the compressed level 0 back on the CPU and logs its PSNR
+#define VERIFY_TEXTURE_COMPRESSION 0
+
 #define VERSION_OPENGL33 3
 #define VERSION_OPENGL46 4
 
@@ -1,2 +1,91 @@
 ﻿#include "stdafx.h"
-#include "NanoCore.h"
\ No newline at end of file
+#include "NanoCore.h"
+//=============================================================================
+namespace
+{
+	constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+	constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+	constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+	inline uint64_t read64(const uint8_t* p) noexcept
+	{
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint32_t read32(const uint8_t* p) noexcept
+	{
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t round(uint64_t acc, uint64_t input) noexcept
+	{
+		acc += input * Prime2;
+		acc = std::rotl(acc, 31);
+		return acc * Prime1;
+	}
+
+	inline uint64_t mergeRound(uint64_t acc, uint64_t val) noexcept
+	{
+		acc ^= round(0, val);
+		return acc * Prime1 + Prime4;
+	}
+}
+//=============================================================================
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed) noexcept
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	const uint8_t* const end = p + size;
+	uint64_t h;
+
+	if (size >= 32)
+	{
+		uint64_t v1 = seed + Prime1 + Prime2;
+		uint64_t v2 = seed + Prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - Prime1;
+		const uint8_t* const limit = end - 32;
+		do
+		{
+			v1 = round(v1, read64(p));
+			v2 = round(v2, read64(p + 8));
+			v3 = round(v3, read64(p + 16));
+			v4 = round(v4, read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		h = mergeRound(h, v1);
+		h = mergeRound(h, v2);
+		h = mergeRound(h, v3);
+		h = mergeRound(h, v4);
+	}
+	else
+	{
+		h = seed + Prime5;
+	}
+	h += static_cast<uint64_t>(size);
+
+	for (; p + 8 <= end; p += 8)
+		h = std::rotl(h ^ round(0, read64(p)), 27) * Prime1 + Prime4;
+	if (p + 4 <= end)
+	{
+		h = std::rotl(h ^ (static_cast<uint64_t>(read32(p)) * Prime1), 23) * Prime2 + Prime3;
+		p += 4;
+	}
+	for (; p < end; p++)
+		h = std::rotl(h ^ (*p * Prime5), 11) * Prime1;
+
+	h ^= h >> 33;
+	h *= Prime2;
+	h ^= h >> 29;
+	h *= Prime3;
+	h ^= h >> 32;
+	return h;
+}
+//=============================================================================
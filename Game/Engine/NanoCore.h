@@ -44,4 +44,7 @@ struct Hash<std::tuple<TT...>>
 		HashValueImpl<std::tuple<TT...>>::Apply(seed, tt);
 		return seed;
 	}
-};
\ No newline at end of file
+};
+
+// 64 bit non-cryptographic hash of a byte range (the XXH64 algorithm), for content keys of assets and caches
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0) noexcept;
@@ -3,6 +3,10 @@
 #include "NanoWindow.h"
 #include "NanoRender.h"
 #include "NanoLog.h"
+#include "NanoJobs.h"
+#include "NanoRenderModel.h"
+#include "NanoRenderGeometryArena.h"
+#include "NanoRenderFrameRing.h"
 #include "OGLContext.h"
 //=============================================================================
 bool OGLContextInit();
@@ -51,6 +55,12 @@ bool engine::Init(uint16_t width, uint16_t height, std::string_view title)
 	if (!textures::Init())
 		return false;
 
+	if (!framering::Init())
+		return false;
+
+	if (!jobs::Init())
+		return false;
+
 	deltaTime = 0.0f;
 	previousTime = std::chrono::high_resolution_clock::now();
 
@@ -59,7 +69,11 @@ bool engine::Init(uint16_t width, uint16_t height, std::string_view title)
 //=============================================================================
 void engine::Close() noexcept
 {
+	jobs::Close();
+	models::Close();
+	geometry::Close();
 	textures::Close();
+	framering::Close();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplRgfw_Shutdown();
 	ImGui::DestroyContext();
@@ -93,6 +107,16 @@ void engine::BeginFrame()
 		}
 	}
 
+	// streaming uploads of async loaded models and textures
+	models::UpdateUploads();
+	textures::UpdateUploads();
+
+	// geometry freed by released models, the ranges move before the draws of the frame read them
+	geometry::Defragment();
+
+	// per frame GPU data, waits for the GPU to release the region of this frame
+	framering::BeginFrame();
+
 	// Start a new ImGUi frame
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplRgfw_NewFrame();
@@ -111,6 +135,7 @@ void engine::EndFrame()
 		EnableSRGB(true);
 	}
 
+	framering::EndFrame();
 	window::Swap();
 	input::Update();
 }
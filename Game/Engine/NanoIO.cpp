@@ -1,6 +1,14 @@
 ﻿#include "stdafx.h"
 #include "NanoIO.h"
 #include "NanoLog.h"
+#if defined(_WIN32)
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
 //=============================================================================
 template <typename T>
 [[nodiscard]] bool contains(const std::vector<T>& vec, const T& obj) noexcept
@@ -100,4 +108,95 @@ std::vector<char> io::LoadBinaryFile(const std::filesystem::path& path)
 	binaryFile.close();
 	return buffer;
 }
+//=============================================================================
+bool io::IsNewerThan(const std::string& filePath, const std::string& sourcePath)
+{
+	std::error_code ec;
+	const auto fileTime = std::filesystem::last_write_time(filePath, ec);
+	if (ec) return false;
+	const auto sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+	if (ec) return false;
+	return fileTime >= sourceTime;
+}
+//=============================================================================
+bool io::MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		Error("Fail to open file: " + path.string());
+		return false;
+	}
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		Error("Cannot map empty file: " + path.string());
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		Error("Cannot map file: " + path.string());
+		return false;
+	}
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		Error("Cannot map file: " + path.string());
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(size.QuadPart);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		Error("Fail to open file: " + path.string());
+		return false;
+	}
+	struct stat st{};
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		Error("Cannot map empty file: " + path.string());
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		close(fd);
+		Error("Cannot map file: " + path.string());
+		return false;
+	}
+	m_fd = fd;
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(st.st_size);
+#endif
+	return true;
+}
+//=============================================================================
+void io::MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mapping) CloseHandle(m_mapping);
+	if (m_file) CloseHandle(m_file);
+	m_file = m_mapping = nullptr;
+#else
+	if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+	if (m_fd >= 0) close(m_fd);
+	m_fd = -1;
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
 //=============================================================================
\ No newline at end of file
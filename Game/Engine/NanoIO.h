@@ -13,4 +13,34 @@ namespace io
 
 	std::string LoadFile(const std::filesystem::path& path);
 	std::vector<char> LoadBinaryFile(const std::filesystem::path& path);
+
+	// true if 'filePath' exists and was written after 'sourcePath'
+	bool IsNewerThan(const std::string& filePath, const std::string& sourcePath);
+
+	// Read-only memory mapping of a whole file
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile() { Close(); }
+
+		bool Open(const std::filesystem::path& path);
+		void Close();
+
+		bool IsOpen() const noexcept { return m_data != nullptr; }
+		const uint8_t* GetData() const noexcept { return m_data; }
+		size_t GetSize() const noexcept { return m_size; }
+
+	private:
+		const uint8_t* m_data{ nullptr };
+		size_t         m_size{ 0 };
+#if defined(_WIN32)
+		void*          m_file{ nullptr };
+		void*          m_mapping{ nullptr };
+#else
+		int            m_fd{ -1 };
+#endif
+	};
 } // namespace io
\ No newline at end of file
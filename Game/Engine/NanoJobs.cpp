@@ -0,0 +1,140 @@
+﻿#include "stdafx.h"
+#include "NanoJobs.h"
+#include "NanoLog.h"
+//=============================================================================
+namespace
+{
+	std::vector<std::thread>          workers;
+	std::deque<std::function<void()>> queue;
+	std::mutex                        queueMutex;
+	std::condition_variable           queueCondition;
+	bool                              stopWorkers{ false };
+
+	void workerThread()
+	{
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock lock(queueMutex);
+				queueCondition.wait(lock, [] { return stopWorkers || !queue.empty(); });
+				if (stopWorkers && queue.empty())
+					return;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+			job();
+		}
+	}
+
+	struct ParallelForState final
+	{
+		ParallelForState(size_t count, const std::function<void(size_t)>& func) : count(count), func(func) {}
+
+		// returns false when there are no indices left
+		bool RunNext()
+		{
+			const size_t id = next.fetch_add(1, std::memory_order_relaxed);
+			if (id >= count) return false;
+
+			func(id);
+
+			if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+			{
+				std::lock_guard lock(mutex);
+				condition.notify_all();
+			}
+			return true;
+		}
+
+		const size_t                      count;
+		const std::function<void(size_t)> func;
+		std::atomic<size_t>               next{ 0 };
+		std::atomic<size_t>               done{ 0 };
+		std::mutex                        mutex;
+		std::condition_variable           condition;
+	};
+}
+//=============================================================================
+bool jobs::Init(unsigned numThreads)
+{
+	Close();
+
+	if (numThreads == 0)
+	{
+		const unsigned hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	stopWorkers = false;
+	workers.reserve(numThreads);
+	for (unsigned i = 0; i < numThreads; i++)
+	{
+		workers.emplace_back(workerThread);
+	}
+
+	Info("Job system: " + std::to_string(numThreads) + " worker threads");
+	return true;
+}
+//=============================================================================
+void jobs::Close()
+{
+	{
+		std::lock_guard lock(queueMutex);
+		stopWorkers = true;
+	}
+	queueCondition.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	queue.clear();
+}
+//=============================================================================
+unsigned jobs::GetNumThreads()
+{
+	return static_cast<unsigned>(workers.size());
+}
+//=============================================================================
+void jobs::Submit(std::function<void()> job)
+{
+	if (workers.empty())
+	{
+		job();
+		return;
+	}
+
+	{
+		std::lock_guard lock(queueMutex);
+		queue.emplace_back(std::move(job));
+	}
+	queueCondition.notify_one();
+}
+//=============================================================================
+void jobs::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0) return;
+	if (workers.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	// The state is shared with helper jobs: a helper may start after this call has already returned
+	auto state = std::make_shared<ParallelForState>(count, func);
+
+	const size_t numHelpers = std::min(count - 1, workers.size());
+	for (size_t i = 0; i < numHelpers; i++)
+	{
+		Submit([state] { while (state->RunNext()) {} });
+	}
+
+	// the calling thread also takes indices, so ParallelFor from a worker thread does not deadlock
+	while (state->RunNext()) {}
+
+	std::unique_lock lock(state->mutex);
+	state->condition.wait(lock, [&state] { return state->done.load(std::memory_order_acquire) == state->count; });
+}
+//=============================================================================
\ No newline at end of file
@@ -0,0 +1,17 @@
+﻿#pragma once
+
+// Worker thread pool for CPU work (asset decoding, mesh processing). Jobs must not call OpenGL.
+namespace jobs
+{
+	// numThreads == 0 - hardware_concurrency - 1
+	bool Init(unsigned numThreads = 0);
+	void Close();
+
+	unsigned GetNumThreads();
+
+	void Submit(std::function<void()> job);
+
+	// Calls func(i) for i in [0, count) on the workers and the calling thread, returns when all are done.
+	// Runs inline when the pool is not initialized.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+} // namespace jobs
\ No newline at end of file
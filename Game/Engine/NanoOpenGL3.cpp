@@ -2,6 +2,9 @@
 #include "NanoOpenGL3.h"
 #include "NanoLog.h"
 #include "NanoCore.h"
+#include "OGLDirectState.h"
+#include "OGLStateCache.h"
+#include "NanoRenderTextures.h"
 //=============================================================================
 std::unordered_map<SamplerStateInfo, SamplerHandle> SamplerCache;
 //=============================================================================
@@ -17,16 +20,6 @@ GLenum GetColorFormatGL(ColorFormat format) noexcept
 	}
 }
 //=============================================================================
-[[nodiscard]] inline GLenum GetGLEnum(PolygonMode mode) noexcept
-{
-	switch (mode) {
-	case PolygonMode::Point: return GL_POINT;
-	case PolygonMode::Line:  return GL_LINE;
-	case PolygonMode::Fill:  return GL_FILL;
-	default: std::unreachable();
-	}
-}
-//=============================================================================
 [[nodiscard]] inline GLint GetGLEnum(TextureFilter filter) noexcept
 {
 	switch (filter) {
@@ -51,6 +44,18 @@ GLenum GetColorFormatGL(ColorFormat format) noexcept
 	}
 }
 //=============================================================================
+#if USE_OPENGL == VERSION_OPENGL46
+// level 0 of the faces in the order +X, -X, +Y, -Y, +Z, -Z, the layers of a cube map
+inline void setCubeFaces(GLuint texture, unsigned width, unsigned height, PixelFormat format, PixelType type, const std::array<const void*, 6>& faces)
+{
+	for (size_t face = 0; face < faces.size(); face++)
+	{
+		if (faces[face])
+			dsa::TextureSubImage3D(texture, 0, 0, 0, static_cast<GLint>(face), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 1, EnumToValue(format), EnumToValue(type), faces[face]);
+	}
+}
+#endif
+//=============================================================================
 Texture1DHandle CreateTexture1D(unsigned width, InternalFormat internalformat, PixelFormat format, PixelType type, const void* pixels)
 {
 	if (width == 0 || format == PixelFormat::None)
@@ -58,14 +63,21 @@ Texture1DHandle CreateTexture1D(unsigned width, InternalFormat internalformat, P
 		Error("Invalid texture parameters");
 		return {};
 	}
-	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_1D);
-	
 	Texture1DHandle texture;
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::CreateTextures(GL_TEXTURE_1D, 1, &texture.handle);
+	dsa::TextureStorage1D(texture.handle, dsa::GetMipLevels(width), static_cast<GLenum>(EnumToValue(internalformat)), static_cast<GLsizei>(width));
+	if (pixels)
+		dsa::TextureSubImage1D(texture.handle, 0, 0, static_cast<GLsizei>(width), EnumToValue(format), EnumToValue(type), pixels);
+#else
+	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_1D);
+
 	glGenTextures(1, &texture.handle);
 	glBindTexture(GL_TEXTURE_1D, texture.handle);
 	glTexImage1D(GL_TEXTURE_1D, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), 0, EnumToValue(format), EnumToValue(type), pixels);
 	
 	glBindTexture(GL_TEXTURE_1D, currentTexture);
+#endif
 	return texture;
 }
 //=============================================================================
@@ -77,14 +89,21 @@ Texture2DHandle CreateTexture2D(unsigned width, unsigned height, InternalFormat
 		return {};
 	}
 
+	Texture2DHandle texture;
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::CreateTextures(GL_TEXTURE_2D, 1, &texture.handle);
+	dsa::TextureStorage2D(texture.handle, dsa::GetMipLevels(width, height), static_cast<GLenum>(EnumToValue(internalformat)), static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+	if (pixels)
+		dsa::TextureSubImage2D(texture.handle, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), EnumToValue(format), EnumToValue(type), pixels);
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D);
 
-	Texture2DHandle texture;
 	glGenTextures(1, &texture.handle);
 	glBindTexture(GL_TEXTURE_2D, texture.handle);
 	glTexImage2D(GL_TEXTURE_2D, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, EnumToValue(format), EnumToValue(type), pixels);
 
 	glBindTexture(GL_TEXTURE_2D, currentTexture);
+#endif
 	return texture;
 }
 //=============================================================================
@@ -95,14 +114,21 @@ Texture3DHandle CreateTexture3D(unsigned width, unsigned height, unsigned depth,
 		Error("Invalid texture parameters");
 		return {};
 	}
-	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_3D);
-	
 	Texture3DHandle texture;
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::CreateTextures(GL_TEXTURE_3D, 1, &texture.handle);
+	dsa::TextureStorage3D(texture.handle, dsa::GetMipLevels(width, height, depth), static_cast<GLenum>(EnumToValue(internalformat)), static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(depth));
+	if (pixels)
+		dsa::TextureSubImage3D(texture.handle, 0, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(depth), EnumToValue(format), EnumToValue(type), pixels);
+#else
+	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_3D);
+
 	glGenTextures(1, &texture.handle);
 	glBindTexture(GL_TEXTURE_3D, texture.handle);
 	glTexImage3D(GL_TEXTURE_3D, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(depth), 0, EnumToValue(format), EnumToValue(type), pixels);
 
 	glBindTexture(GL_TEXTURE_3D, currentTexture);
+#endif
 	return texture;
 }
 //=============================================================================
@@ -113,12 +139,19 @@ Texture1DArrayHandle CreateTexture1DArray(InternalFormat internalformat, unsigne
 		Error("Invalid texture parameters");
 		return {};
 	}
-	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_1D_ARRAY);
 	Texture1DArrayHandle texture;
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::CreateTextures(GL_TEXTURE_1D_ARRAY, 1, &texture.handle);
+	dsa::TextureStorage2D(texture.handle, dsa::GetMipLevels(width), static_cast<GLenum>(EnumToValue(internalformat)), static_cast<GLsizei>(width), static_cast<GLsizei>(arraySize));
+	if (pixels)
+		dsa::TextureSubImage2D(texture.handle, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(arraySize), EnumToValue(format), EnumToValue(type), pixels);
+#else
+	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_1D_ARRAY);
 	glGenTextures(1, &texture.handle);
 	glBindTexture(GL_TEXTURE_1D_ARRAY, texture.handle);
 	glTexImage2D(GL_TEXTURE_1D_ARRAY, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(arraySize), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_1D_ARRAY, currentTexture);
+#endif
 	return texture;
 }
 //=============================================================================
@@ -129,12 +162,19 @@ Texture2DArrayHandle CreateTexture2DArray(InternalFormat internalformat, unsigne
 		Error("Invalid texture parameters");
 		return {};
 	}
-	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D_ARRAY);
 	Texture2DArrayHandle texture;
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::CreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture.handle);
+	dsa::TextureStorage3D(texture.handle, dsa::GetMipLevels(width, height), static_cast<GLenum>(EnumToValue(internalformat)), static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(arraySize));
+	if (pixels)
+		dsa::TextureSubImage3D(texture.handle, 0, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(arraySize), EnumToValue(format), EnumToValue(type), pixels);
+#else
+	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D_ARRAY);
 	glGenTextures(1, &texture.handle);
 	glBindTexture(GL_TEXTURE_2D_ARRAY, texture.handle);
 	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(arraySize), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_2D_ARRAY, currentTexture);
+#endif
 	return texture;
 }
 //=============================================================================
@@ -145,8 +185,13 @@ TextureCubeHandle CreateCubeTexture(InternalFormat internalformat, unsigned widt
 		Error("Invalid texture parameters");
 		return {};
 	}
-	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_CUBE_MAP);
 	TextureCubeHandle texture;
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::CreateTextures(GL_TEXTURE_CUBE_MAP, 1, &texture.handle);
+	dsa::TextureStorage2D(texture.handle, dsa::GetMipLevels(width, height), static_cast<GLenum>(EnumToValue(internalformat)), static_cast<GLsizei>(width), static_cast<GLsizei>(height));
+	setCubeFaces(texture.handle, width, height, format, type, { posX, negX, posY, negY, posZ, negZ });
+#else
+	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_CUBE_MAP);
 	glGenTextures(1, &texture.handle);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture.handle);
 
@@ -158,6 +203,7 @@ TextureCubeHandle CreateCubeTexture(InternalFormat internalformat, unsigned widt
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, EnumToValue(format), EnumToValue(type), negZ);
 	
 	glBindTexture(GL_TEXTURE_CUBE_MAP, currentTexture);
+#endif
 	return texture;
 }
 //=============================================================================
@@ -168,11 +214,16 @@ void SetTextureData(Texture1DHandle texture, InternalFormat internalformat, unsi
 		Error("Invalid texture parameters");
 		return;
 	}
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)internalformat;
+	dsa::TextureSubImage1D(texture.handle, 0, 0, static_cast<GLsizei>(width), EnumToValue(format), EnumToValue(type), pixels);
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_1D);
 
 	glBindTexture(GL_TEXTURE_1D, texture.handle);
 	glTexImage1D(GL_TEXTURE_1D, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_1D, currentTexture);
+#endif
 }
 //=============================================================================
 void SetTextureData(Texture2DHandle texture, InternalFormat internalformat, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* pixels)
@@ -183,11 +234,16 @@ void SetTextureData(Texture2DHandle texture, InternalFormat internalformat, unsi
 		return;
 	}
 
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)internalformat;
+	dsa::TextureSubImage2D(texture.handle, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), EnumToValue(format), EnumToValue(type), pixels);
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D);
 
 	glBindTexture(GL_TEXTURE_2D, texture.handle);
 	glTexImage2D(GL_TEXTURE_2D, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_2D, currentTexture);
+#endif
 }
 //=============================================================================
 void SetTextureData(Texture3DHandle texture, InternalFormat internalformat, unsigned width, unsigned height, unsigned depth, PixelFormat format, PixelType type, const void* pixels)
@@ -198,11 +254,16 @@ void SetTextureData(Texture3DHandle texture, InternalFormat internalformat, unsi
 		return;
 	}
 
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)internalformat;
+	dsa::TextureSubImage3D(texture.handle, 0, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(depth), EnumToValue(format), EnumToValue(type), pixels);
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_3D);
 
 	glBindTexture(GL_TEXTURE_3D, texture.handle);
 	glTexImage3D(GL_TEXTURE_3D, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(depth), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_3D, currentTexture);
+#endif
 }
 //=============================================================================
 void SetTextureData(Texture1DArrayHandle texture, InternalFormat internalformat, unsigned width, unsigned arraySize, PixelFormat format, PixelType type, const void* pixels)
@@ -212,11 +273,17 @@ void SetTextureData(Texture1DArrayHandle texture, InternalFormat internalformat,
 		Error("Invalid texture parameters");
 		return;
 	}
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)internalformat;
+	if (pixels)
+		dsa::TextureSubImage2D(texture.handle, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(arraySize), EnumToValue(format), EnumToValue(type), pixels);
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_1D_ARRAY);
 
 	glBindTexture(GL_TEXTURE_1D_ARRAY, texture.handle);
 	glTexImage2D(GL_TEXTURE_1D_ARRAY, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(arraySize), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_1D_ARRAY, currentTexture);
+#endif
 }
 //=============================================================================
 void SetTextureData(Texture2DArrayHandle texture, InternalFormat internalformat, unsigned width, unsigned height, unsigned arraySize, PixelFormat format, PixelType type, const void* pixels)
@@ -226,11 +293,17 @@ void SetTextureData(Texture2DArrayHandle texture, InternalFormat internalformat,
 		Error("Invalid texture parameters");
 		return;
 	}
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)internalformat;
+	if (pixels)
+		dsa::TextureSubImage3D(texture.handle, 0, 0, 0, 0, static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(arraySize), EnumToValue(format), EnumToValue(type), pixels);
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D_ARRAY);
 
 	glBindTexture(GL_TEXTURE_2D_ARRAY, texture.handle);
 	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(arraySize), 0, EnumToValue(format), EnumToValue(type), pixels);
 	glBindTexture(GL_TEXTURE_2D_ARRAY, currentTexture);
+#endif
 }
 //=============================================================================
 void SetTextureData(TextureCubeHandle texture, InternalFormat internalformat, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* posX, const void* negX, const void* posY, const void* negY, const void* posZ, const void* negZ)
@@ -240,6 +313,10 @@ void SetTextureData(TextureCubeHandle texture, InternalFormat internalformat, un
 		Error("Invalid texture parameters");
 		return;
 	}
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)internalformat;
+	setCubeFaces(texture.handle, width, height, format, type, { posX, negX, posY, negY, posZ, negZ });
+#else
 	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_CUBE_MAP);
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture.handle);
@@ -252,14 +329,40 @@ void SetTextureData(TextureCubeHandle texture, InternalFormat internalformat, un
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, EnumToValue(internalformat), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, EnumToValue(format), EnumToValue(type), negZ);
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, currentTexture);
+#endif
+}
+//=============================================================================
+void SetTextureLayerData(Texture2DArrayHandle texture, unsigned layer, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* pixels)
+{
+	if (width == 0 || height == 0 || format == PixelFormat::None)
+	{
+		Error("Invalid texture parameters");
+		return;
+	}
+#if USE_OPENGL == VERSION_OPENGL46
+	dsa::TextureSubImage3D(texture.handle, 0, 0, 0, static_cast<GLint>(layer), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 1, EnumToValue(format), EnumToValue(type), pixels);
+#else
+	const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D_ARRAY);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture.handle);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), static_cast<GLsizei>(width), static_cast<GLsizei>(height), 1, EnumToValue(format), EnumToValue(type), pixels);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, currentTexture);
+#endif
 }
 //=============================================================================
 void BindTexture2D(GLenum id, Texture2DHandle texture)
 {
+	textures::Touch(texture);
 	glActiveTexture(GL_TEXTURE0 + id);
 	glBindTexture(GL_TEXTURE_2D, texture.handle);
 }
 //=============================================================================
+void BindTexture2DArray(GLenum id, Texture2DArrayHandle texture)
+{
+	glActiveTexture(GL_TEXTURE0 + id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture.handle);
+}
+//=============================================================================
 bool IsValid(Texture1DHandle id)
 {
 	return id.handle > 0;
@@ -334,6 +437,17 @@ inline void setTextureParameters(GLenum target, GLuint texture, const TextureCon
 		return;
 	}
 
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)target;
+	if (config.generateMipmaps)
+		dsa::GenerateTextureMipmap(texture);
+
+	dsa::TextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GetGLEnum(config.minFilter));
+	dsa::TextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GetGLEnum(config.magFilter));
+	dsa::TextureParameteri(texture, GL_TEXTURE_WRAP_T, GetGLEnum(config.wrapT));
+	dsa::TextureParameteri(texture, GL_TEXTURE_WRAP_S, GetGLEnum(config.wrapS));
+	dsa::TextureParameteri(texture, GL_TEXTURE_WRAP_R, GetGLEnum(config.wrapR));
+#else
 	const GLuint currentTexture = GetCurrentTexture(target);
 	glBindTexture(target, texture);
 
@@ -347,6 +461,7 @@ inline void setTextureParameters(GLenum target, GLuint texture, const TextureCon
 	glTexParameteri(target, GL_TEXTURE_WRAP_R, GetGLEnum(config.wrapR));
 
 	glBindTexture(target, currentTexture);
+#endif
 }
 //=============================================================================
 void SetTextureParameters(Texture1DHandle texture, const TextureConfig& config)
@@ -369,6 +484,11 @@ void SetTextureParameters(TextureCubeHandle texture, const TextureConfig& config
 	setTextureParameters(GL_TEXTURE_CUBE_MAP, texture.handle, config);
 }
 //=============================================================================
+void SetTextureParameters(Texture2DArrayHandle texture, const TextureConfig& config)
+{
+	setTextureParameters(GL_TEXTURE_2D_ARRAY, texture.handle, config);
+}
+//=============================================================================
 std::size_t std::hash<SamplerStateInfo>::operator()(const SamplerStateInfo& k) const noexcept
 {
 	auto rtup = std::make_tuple(
@@ -455,230 +575,27 @@ GLuint CreateFramebuffer(GLuint colorTex, GLuint depthTex)
 	return fbo;
 }
 //=============================================================================
-struct CachedState final
-{
-	bool restoreDepth{ true };
-	bool restoreStencil{ true };
-	bool restoreBlend{ true };
-	bool restoreMultisample{ true };
-	bool restoreColorMaskState{ true };
-	bool restoreCullState{ true };
-	bool restorePolygonState{ true };
-
-	bool depthTestEnabled{ false };
-	ComparisonFunc depthFunc{ ComparisonFunc::Less };
-	bool depthMask{ true };
-
-	bool stencilEnabled{ false };
-	ComparisonFunc frontFunc{ ComparisonFunc::Always };
-	ComparisonFunc backFunc{ ComparisonFunc::Always };
-	int frontRef{ 0 };
-	int backRef{ 0 };
-	unsigned int frontMask{ 0xFF };
-	unsigned int backMask{ 0xFF };
-
-	bool blendEnabled{ false };
-	BlendFactor srcRGB{ BlendFactor::SrcAlpha };
-	BlendFactor dstRGB{ BlendFactor::OneMinusSrcAlpha };
-	BlendFactor srcAlpha{ BlendFactor::One };
-	BlendFactor dstAlpha{ BlendFactor::OneMinusSrcAlpha };
-
-	bool multisampleEnabled{ true };
-
-	bool colorMaskR{ true };
-	bool colorMaskG{ true };
-	bool colorMaskB{ true };
-	bool colorMaskA{ true };
-
-	bool cullEnabled{ false };
-	CullFace cullFace{ CullFace::Back };
-
-	PolygonMode polygonMode{ PolygonMode::Fill };
-} cachedState;
-//=============================================================================
-void ResetStateDepth()
-{
-	cachedState.restoreDepth = true;
-}
-//=============================================================================
-void ResetStateStencil()
-{
-	cachedState.restoreStencil = true;
-}
-//=============================================================================
-void ResetStateBlend()
-{
-	cachedState.restoreBlend = true;
-}
-//=============================================================================
-void ResetStateMultisample()
-{
-	cachedState.restoreMultisample = true;
-}
-//=============================================================================
-void ResetStateColorMaskState()
-{
-	cachedState.restoreColorMaskState = true;
-}
-//=============================================================================
-void ResetStateCullState()
-{
-	cachedState.restoreCullState = true;
-}
-//=============================================================================
-void ResetStatePolygonState()
-{
-	cachedState.restorePolygonState = true;
-}
-//=============================================================================
-void ResetStateAll()
+GLuint GetCurrentTexture(GLenum target)
 {
-	ResetStateDepth();
-	ResetStateStencil();
-	ResetStateBlend();
-	ResetStateMultisample();
-	ResetStateColorMaskState();
-	ResetStateCullState();
-	ResetStatePolygonState();
+	return GetBoundTexture(target);
 }
 //=============================================================================
-void BindState(const GLState& state)
-{
-	// Depth State
-	if (cachedState.restoreDepth || cachedState.depthTestEnabled != state.depthState.enable)
-	{
-		if (state.depthState.enable) glEnable(GL_DEPTH_TEST);
-		else glDisable(GL_DEPTH_TEST);
-		cachedState.depthTestEnabled = state.depthState.enable;
-	}
-	if (cachedState.restoreDepth || cachedState.depthFunc != state.depthState.depthFunc)
-	{
-		glDepthFunc(EnumToValue(state.depthState.depthFunc));
-		cachedState.depthFunc = state.depthState.depthFunc;
-	}
-	if (cachedState.restoreDepth || cachedState.depthMask != state.depthState.depthMask)
-	{
-		glDepthMask(state.depthState.depthMask ? GL_TRUE : GL_FALSE);
-		cachedState.depthMask = state.depthState.depthMask;
-	}
-	cachedState.restoreDepth = false;
-
-	// Stencil State
-	if (cachedState.restoreStencil || cachedState.stencilEnabled != state.stencilState.enable)
-	{
-		if (state.stencilState.enable) glEnable(GL_STENCIL_TEST);
-		else glDisable(GL_STENCIL_TEST);
-		cachedState.stencilEnabled = state.stencilState.enable;
-	}
-	if (cachedState.restoreStencil || 
-		cachedState.frontFunc != state.stencilState.frontFunc || cachedState.backFunc != state.stencilState.backFunc ||
-		cachedState.frontRef != state.stencilState.frontRef || cachedState.backRef != state.stencilState.backRef ||
-		cachedState.frontMask != state.stencilState.frontMask || cachedState.backMask != state.stencilState.backMask)
-	{
-		glStencilFuncSeparate(GL_FRONT, EnumToValue(state.stencilState.frontFunc), state.stencilState.frontRef, state.stencilState.frontMask);
-		glStencilFuncSeparate(GL_BACK, EnumToValue(state.stencilState.backFunc), state.stencilState.backRef, state.stencilState.backMask);
-		cachedState.frontFunc = state.stencilState.frontFunc;
-		cachedState.backFunc = state.stencilState.backFunc;
-		cachedState.frontRef = state.stencilState.frontRef;
-		cachedState.backRef = state.stencilState.backRef;
-		cachedState.frontMask = state.stencilState.frontMask;
-		cachedState.backMask = state.stencilState.backMask;
-	}
-	cachedState.restoreStencil = false;
-
-	// Blend State
-	if (cachedState.restoreBlend || cachedState.blendEnabled != state.blendState.enable)
-	{
-		if (state.blendState.enable) glEnable(GL_BLEND);
-		else glDisable(GL_BLEND);
-		cachedState.blendEnabled = state.blendState.enable;
-	}
-	if (cachedState.restoreBlend || 
-		cachedState.srcRGB != state.blendState.srcRGB || cachedState.dstRGB != state.blendState.dstRGB ||
-		cachedState.srcAlpha != state.blendState.srcAlpha || cachedState.dstAlpha != state.blendState.dstAlpha)
-	{
-		glBlendFuncSeparate(
-			EnumToValue(state.blendState.srcRGB),
-			EnumToValue(state.blendState.dstRGB),
-			EnumToValue(state.blendState.srcAlpha),
-			EnumToValue(state.blendState.dstAlpha)
-		);
-		cachedState.srcRGB = state.blendState.srcRGB;
-		cachedState.dstRGB = state.blendState.dstRGB;
-		cachedState.srcAlpha = state.blendState.srcAlpha;
-		cachedState.dstAlpha = state.blendState.dstAlpha;
-	}
-	cachedState.restoreBlend = false;
-
-	// Multisample State
-	if (cachedState.restoreMultisample || cachedState.multisampleEnabled != state.multisampleState.enable)
-	{
-		if (state.multisampleState.enable) glEnable(GL_MULTISAMPLE);
-		else glDisable(GL_MULTISAMPLE);
-		cachedState.multisampleEnabled = state.multisampleState.enable;
-	}
-	cachedState.restoreMultisample = false;
-
-	// Color Mask
-	if (cachedState.restoreColorMaskState || 
-		cachedState.colorMaskR != state.colorMaskState.r || cachedState.colorMaskG != state.colorMaskState.g ||
-		cachedState.colorMaskB != state.colorMaskState.b || cachedState.colorMaskA != state.colorMaskState.a)
-	{
-		glColorMask(state.colorMaskState.r ? GL_TRUE : GL_FALSE,
-			state.colorMaskState.g ? GL_TRUE : GL_FALSE,
-			state.colorMaskState.b ? GL_TRUE : GL_FALSE,
-			state.colorMaskState.a ? GL_TRUE : GL_FALSE);
-		cachedState.colorMaskR = state.colorMaskState.r;
-		cachedState.colorMaskG = state.colorMaskState.g;
-		cachedState.colorMaskB = state.colorMaskState.b;
-		cachedState.colorMaskA = state.colorMaskState.a;
-	}
-	cachedState.restoreColorMaskState = false;
-		
-	// Cull State
-	if (cachedState.restoreCullState || cachedState.cullEnabled != state.cullState.enable)
-	{
-		if (state.cullState.enable) glEnable(GL_CULL_FACE);
-		else glDisable(GL_CULL_FACE);
-		cachedState.cullEnabled = state.cullState.enable;
-	}
-	if (cachedState.restoreCullState || cachedState.cullFace != state.cullState.cullFace)
-	{
-		glCullFace(EnumToValue(state.cullState.cullFace));
-		cachedState.cullFace = state.cullState.cullFace;
-	}
-	cachedState.restoreCullState = false;
-
-	// Polygon Mode
-	if (cachedState.restorePolygonState || cachedState.polygonMode != state.polygonState.mode)
-	{
-		glPolygonMode(GL_FRONT_AND_BACK, GetGLEnum(state.polygonState.mode));
-		cachedState.polygonMode = state.polygonState.mode;
-	}
-	cachedState.restorePolygonState = false;
-}
-//=============================================================================
-GLuint GetCurrentTexture(GLenum target)
+bool IsExtensionSupported(std::string_view name)
 {
-	GLenum targetBinding{ 0 };
-	switch (target)
+	static std::set<std::string, std::less<>> extensions;
+	static bool loaded{ false };
+	if (!loaded)
 	{
-	case GL_TEXTURE_1D:                   targetBinding = GL_TEXTURE_BINDING_1D; break;
-	case GL_TEXTURE_2D:                   targetBinding = GL_TEXTURE_BINDING_2D; break;
-	case GL_TEXTURE_3D:                   targetBinding = GL_TEXTURE_BINDING_3D; break;
-	case GL_TEXTURE_1D_ARRAY:             targetBinding = GL_TEXTURE_BINDING_1D_ARRAY; break;
-	case GL_TEXTURE_2D_ARRAY:             targetBinding = GL_TEXTURE_BINDING_2D_ARRAY; break;
-	case GL_TEXTURE_2D_MULTISAMPLE:       targetBinding = GL_TEXTURE_BINDING_2D_MULTISAMPLE; break;
-	case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: targetBinding = GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY; break;
-	case GL_TEXTURE_BUFFER:               targetBinding = GL_TEXTURE_BINDING_BUFFER; break;
-	case GL_TEXTURE_CUBE_MAP:             targetBinding = GL_TEXTURE_BINDING_CUBE_MAP; break;
-	case GL_TEXTURE_RECTANGLE:            targetBinding = GL_TEXTURE_BINDING_RECTANGLE; break;
-
-	default: std::unreachable(); break;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			if (const GLubyte* extension = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)))
+				extensions.emplace(reinterpret_cast<const char*>(extension));
+		}
+		loaded = true;
 	}
-	GLuint currentState{ 0 };
-	glGetIntegerv(targetBinding, (GLint*)&currentState);
-	return currentState;
+	return extensions.find(name) != extensions.end();
 }
 //=============================================================================
 void EnableSRGB(bool enable)
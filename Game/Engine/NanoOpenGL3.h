@@ -74,14 +74,19 @@ Texture2DArrayHandle CreateTexture2DArray(InternalFormat internalformat, unsigne
 TextureCubeHandle CreateCubeTexture(InternalFormat internalformat, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* posX, const void* negX, const void* posY, const void* negY, const void* posZ, const void* negZ);
 
 // Функции для подгрузки данных в текстуры
+// With USE_OPENGL == VERSION_OPENGL46 the storage is immutable: the Create functions allocate the whole mip chain and
+// SetTextureData uploads level 0 in the size given at creation, 'internalformat' is ignored
 void SetTextureData(Texture1DHandle texture, InternalFormat internalformat, unsigned width, PixelFormat format, PixelType type, const void* pixels);
 void SetTextureData(Texture2DHandle texture, InternalFormat internalformat, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* pixels);
 void SetTextureData(Texture3DHandle texture, InternalFormat internalformat, unsigned width, unsigned height, unsigned depth, PixelFormat format, PixelType type, const void* pixels);
 void SetTextureData(Texture1DArrayHandle texture, InternalFormat internalformat, unsigned width, unsigned arraySize, PixelFormat format, PixelType type, const void* pixels);
 void SetTextureData(Texture2DArrayHandle texture, InternalFormat internalformat, unsigned width, unsigned height, unsigned arraySize, PixelFormat format, PixelType type, const void* pixels);
 void SetTextureData(TextureCubeHandle texture, InternalFormat internalformat, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* posX, const void* negX, const void* posY, const void* negY, const void* posZ, const void* negZ);
+// level 0 of one layer, the array storage must exist
+void SetTextureLayerData(Texture2DArrayHandle texture, unsigned layer, unsigned width, unsigned height, PixelFormat format, PixelType type, const void* pixels);
 
 void BindTexture2D(GLenum id, Texture2DHandle texture);
+void BindTexture2DArray(GLenum id, Texture2DArrayHandle texture);
 
 bool IsValid(Texture1DHandle id);
 bool IsValid(Texture2DHandle id);
@@ -110,6 +115,7 @@ void SetTextureParameters(Texture1DHandle texture, const TextureConfig& config);
 void SetTextureParameters(Texture2DHandle texture, const TextureConfig& config);
 void SetTextureParameters(Texture3DHandle texture, const TextureConfig& config);
 void SetTextureParameters(TextureCubeHandle texture, const TextureConfig& config);
+void SetTextureParameters(Texture2DArrayHandle texture, const TextureConfig& config);
 
 //=============================================================================
 // Sampler
@@ -223,8 +229,12 @@ void BindState(const GLState& state);
 // Get GL States
 //=============================================================================
 
+// binding of the active unit, read from the state cache without glGet
 GLuint GetCurrentTexture(GLenum target);
 
+// extension string of the current context, e.g. "GL_EXT_texture_compression_s3tc". The list is read once
+bool IsExtensionSupported(std::string_view name);
+
 void EnableSRGB(bool enable);
 
 //=============================================================================
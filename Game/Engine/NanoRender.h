@@ -6,4 +6,6 @@
 #include "NanoRenderMaterial.h"
 #include "NanoRenderMesh.h"
 #include "NanoRenderModel.h"
+#include "NanoRenderQueue.h"
+#include "NanoRenderFrameRing.h"
 #include "NanoRenderGeometryGen.h"
\ No newline at end of file
@@ -0,0 +1,301 @@
+﻿#include "stdafx.h"
+#include "NanoRenderFrameRing.h"
+#include "NanoLog.h"
+#include "OGLStateCache.h"
+//=============================================================================
+namespace
+{
+	// GL 4.4 / GL_ARB_buffer_storage, glad is generated for 3.3
+	using PFNBufferStorage = void (GLAD_API_PTR*)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+	constexpr GLbitfield MapPersistentBit = 0x0040; // GL_MAP_PERSISTENT_BIT
+	constexpr GLbitfield MapCoherentBit   = 0x0080; // GL_MAP_COHERENT_BIT
+	constexpr GLuint64   FenceTimeout     = 1'000'000'000; // ns, the wait is repeated until the fence is signaled
+
+	// allocation that did not fit into the ring, uploaded by its first Bind
+	struct OverflowBlock final
+	{
+		BufferHandle         buffer{};
+		std::vector<uint8_t> data;
+		bool                 uploaded{ false };
+	};
+
+	PFNBufferStorage                            bufferStorage{ nullptr };
+	BufferHandle                                ringBuffer{};
+	uint8_t*                                    mapped{ nullptr }; // persistent: the mapping of the whole ring
+	std::vector<uint8_t>                        staging;           // orphaning: the data of the frame
+	std::array<GLsync, framering::FrameRegions> fences{};
+	std::vector<OverflowBlock>                  overflowBlocks;
+	size_t                                      frameSize{ 0 };
+	size_t                                      uniformAlignment{ 256 };
+	unsigned                                    region{ 0 };
+	size_t                                      head{ 0 };     // in the region of the frame
+	size_t                                      uploaded{ 0 }; // orphaning: bytes of the frame already in the buffer
+	bool                                        outOfSpace{ false };
+
+	size_t alignUp(size_t value, size_t alignment) noexcept
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool hasBufferStorage()
+	{
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		if (major * 10 + minor < 44 && !IsExtensionSupported("GL_ARB_buffer_storage"))
+			return false;
+		bufferStorage = reinterpret_cast<PFNBufferStorage>(RGFW_getProcAddress_OpenGL("glBufferStorage"));
+		return bufferStorage != nullptr;
+	}
+
+	void waitFence(GLsync& fence)
+	{
+		if (!fence) return;
+		while (true)
+		{
+			const GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout);
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+				break;
+			if (result == GL_WAIT_FAILED)
+			{
+				Error("Frame ring fence wait failed");
+				break;
+			}
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// created on the copy target, the bindings the passes use are not touched
+	BufferHandle createStreamBuffer(size_t size, const void* data)
+	{
+		const GLuint currentBuffer = GetBoundBuffer(GL_COPY_WRITE_BUFFER);
+		BufferHandle buffer{};
+		glGenBuffers(1, &buffer.handle);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.handle);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), data, GL_STREAM_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, currentBuffer);
+		return buffer;
+	}
+
+	// persistent mapping of the whole ring, false leaves no buffer
+	bool createPersistentRing()
+	{
+		const GLsizeiptr ringSize = static_cast<GLsizeiptr>(frameSize * framering::FrameRegions);
+		const GLbitfield flags = GL_MAP_WRITE_BIT | MapPersistentBit | MapCoherentBit;
+
+		const GLuint currentBuffer = GetBoundBuffer(GL_COPY_WRITE_BUFFER);
+		glGenBuffers(1, &ringBuffer.handle);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer.handle);
+		bufferStorage(GL_COPY_WRITE_BUFFER, ringSize, nullptr, flags);
+		mapped = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, ringSize, flags));
+		glBindBuffer(GL_COPY_WRITE_BUFFER, currentBuffer);
+
+		if (!mapped)
+		{
+			glDeleteBuffers(1, &ringBuffer.handle);
+			ringBuffer.handle = 0;
+		}
+		return mapped != nullptr;
+	}
+
+	bool createRing(size_t size)
+	{
+		frameSize = alignUp(size, uniformAlignment);
+		region = 0;
+		head = 0;
+		uploaded = 0;
+
+		if (bufferStorage && !createPersistentRing())
+		{
+			Warning("Frame ring buffer mapping failed, the ring falls back to orphaning");
+			bufferStorage = nullptr;
+		}
+		if (!bufferStorage)
+		{
+			ringBuffer = createStreamBuffer(frameSize, nullptr);
+			staging.resize(frameSize);
+		}
+		return ringBuffer.handle != 0;
+	}
+
+	void destroyRing()
+	{
+		// the GPU keeps a deleted buffer alive while it reads it, the fences are not waited for
+		for (GLsync& fence : fences)
+		{
+			if (fence) glDeleteSync(fence);
+			fence = nullptr;
+		}
+		if (mapped)
+		{
+			const GLuint currentBuffer = GetBoundBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer.handle);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, currentBuffer);
+			mapped = nullptr;
+		}
+		if (ringBuffer.handle)
+			glDeleteBuffers(1, &ringBuffer.handle);
+		ringBuffer.handle = 0;
+		staging.clear();
+	}
+
+	void releaseOverflow()
+	{
+		for (OverflowBlock& block : overflowBlocks)
+			glDeleteBuffers(1, &block.buffer.handle);
+		overflowBlocks.clear();
+	}
+
+	// orphaning: uploads the data written since the last upload
+	void uploadStaging()
+	{
+		if (mapped || uploaded == head) return;
+
+		const GLuint currentBuffer = GetBoundBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer.handle);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(uploaded), static_cast<GLsizeiptr>(head - uploaded), staging.data() + uploaded);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, currentBuffer);
+		uploaded = head;
+	}
+
+	void uploadOverflow(GLuint buffer)
+	{
+		for (OverflowBlock& block : overflowBlocks)
+		{
+			if (block.buffer.handle != buffer || block.uploaded) continue;
+
+			const GLuint currentBuffer = GetBoundBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(block.data.size()), block.data.data());
+			glBindBuffer(GL_COPY_WRITE_BUFFER, currentBuffer);
+			block.uploaded = true;
+			return;
+		}
+	}
+}
+//=============================================================================
+bool framering::Init(size_t size)
+{
+	Close();
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	uniformAlignment = alignment > 0 ? static_cast<size_t>(alignment) : 256;
+
+	if (!hasBufferStorage())
+		bufferStorage = nullptr;
+	if (!createRing(size))
+	{
+		Error("Frame ring buffer creation failed");
+		return false;
+	}
+
+	Info("Frame ring: " + std::to_string(frameSize / 1024) + " KB per frame, " + (mapped ? "persistent mapping" : "orphaning"));
+	return true;
+}
+//=============================================================================
+void framering::Close()
+{
+	destroyRing();
+	releaseOverflow();
+	outOfSpace = false;
+}
+//=============================================================================
+void framering::BeginFrame()
+{
+	// the draws of the last frame keep the deleted buffers
+	releaseOverflow();
+	if (!ringBuffer.handle) return;
+
+	if (outOfSpace)
+	{
+		const size_t newSize = frameSize * 2;
+		Warning("Frame ring is out of space, the size of a frame grows to " + std::to_string(newSize / 1024) + " KB");
+		destroyRing();
+		outOfSpace = false;
+		if (!createRing(newSize))
+			Error("Frame ring buffer creation failed, every allocation takes a buffer of its own");
+		return;
+	}
+
+	head = 0;
+	uploaded = 0;
+	if (mapped)
+	{
+		region = (region + 1) % FrameRegions;
+		waitFence(fences[region]);
+	}
+	else
+	{
+		// the driver gives the buffer new storage, the draws of the previous frames keep the old one
+		const GLuint currentBuffer = GetBoundBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ringBuffer.handle);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(frameSize), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, currentBuffer);
+	}
+}
+//=============================================================================
+void framering::EndFrame()
+{
+	if (mapped)
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+//=============================================================================
+FrameAllocation framering::Allocate(size_t size, size_t alignment)
+{
+	if (alignment == 0) alignment = uniformAlignment;
+
+	FrameAllocation allocation{};
+	allocation.size = static_cast<GLsizeiptr>(size);
+
+	const size_t offset = alignUp(head, alignment);
+	if (!ringBuffer.handle || offset + size > frameSize)
+	{
+		// a buffer of its own for this frame, the ring grows on the next one
+		outOfSpace = ringBuffer.handle != 0;
+		OverflowBlock& block = overflowBlocks.emplace_back();
+		block.data.resize(std::max<size_t>(size, 1));
+		block.buffer = createStreamBuffer(block.data.size(), nullptr);
+		allocation.buffer = block.buffer.handle;
+		allocation.data = block.data.data();
+		return allocation;
+	}
+	head = offset + size;
+
+	allocation.buffer = ringBuffer.handle;
+	if (mapped)
+	{
+		const size_t regionOffset = static_cast<size_t>(region) * frameSize;
+		allocation.offset = static_cast<GLintptr>(regionOffset + offset);
+		allocation.data = mapped + regionOffset + offset;
+	}
+	else
+	{
+		allocation.offset = static_cast<GLintptr>(offset);
+		allocation.data = staging.data() + offset;
+	}
+	return allocation;
+}
+//=============================================================================
+void framering::Bind(GLenum target, GLuint index, const FrameAllocation& allocation, GLintptr offset, GLsizeiptr size)
+{
+	if (allocation.buffer == ringBuffer.handle)
+		uploadStaging();
+	else
+		uploadOverflow(allocation.buffer);
+	glBindBufferRange(target, index, allocation.buffer, allocation.offset + offset, size);
+}
+//=============================================================================
+size_t framering::GetUniformAlignment()
+{
+	return uniformAlignment;
+}
+//=============================================================================
+bool framering::IsPersistent()
+{
+	return mapped != nullptr;
+}
+//=============================================================================
@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "OGLBuffer.h"
+
+// Place of an allocation in the frame ring, or in a buffer of its own when the ring is out of space. offset is from
+// the start of 'buffer', as glBindBufferRange takes it
+struct FrameAllocation final
+{
+	GLuint     buffer{ 0 };
+	GLintptr   offset{ 0 };
+	GLsizeiptr size{ 0 };
+	uint8_t*   data{ nullptr };
+};
+
+// One buffer for the data that changes every frame: per object matrices, material constants. With
+// GL_ARB_buffer_storage it is mapped once, persistent and coherent, and split into FrameRegions regions. A frame
+// writes to its region while the GPU reads the previous ones, a fence per region keeps the CPU from writing over
+// data the GPU has not read yet. On plain GL 3.3 the writes go to system memory, the buffer is orphaned at the start
+// of the frame and Bind uploads what was written since the last Bind
+namespace framering
+{
+	constexpr unsigned FrameRegions = 3;
+
+	// frameSize - bytes of one frame
+	bool Init(size_t frameSize = 8 * 1024 * 1024);
+	void Close();
+
+	// engine::BeginFrame, waits until the GPU has read the region of this frame. After a frame that ran out of
+	// space the ring is created again twice as large. A failed persistent mapping falls back to orphaning
+	void BeginFrame();
+	// engine::EndFrame, after the last draw of the frame
+	void EndFrame();
+
+	// Bump allocation in the region of the frame, valid until EndFrame. alignment 0 - the uniform buffer offset
+	// alignment. An allocation that does not fit gets a buffer of its own for this frame, so it never fails.
+	// GL thread, the memory may be written by the job system. The data must be complete before the first Bind
+	// that follows the allocation, the GPU never reads it back
+	FrameAllocation Allocate(size_t size, size_t alignment = 0);
+
+	// glBindBufferRange of [offset, offset + size) inside the allocation, offset is the place of the item
+	void Bind(GLenum target, GLuint index, const FrameAllocation& allocation, GLintptr offset, GLsizeiptr size);
+
+	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, the stride of items bound one by one is a multiple of it
+	size_t GetUniformAlignment();
+	bool IsPersistent();
+} // namespace framering
@@ -0,0 +1,365 @@
+﻿#include "stdafx.h"
+#include "NanoRenderGeometryArena.h"
+#include "NanoLog.h"
+//=============================================================================
+namespace
+{
+	// First fit free list, neighbour blocks are merged on free
+	class RangeAllocator final
+	{
+	public:
+		void Init(uint32_t capacity, uint32_t used = 0)
+		{
+			m_capacity = capacity;
+			m_used = used;
+			m_free.clear();
+			if (capacity > used) m_free.emplace(used, capacity - used);
+		}
+
+		std::optional<uint32_t> Allocate(uint32_t size)
+		{
+			if (size == 0) return 0u;
+
+			for (auto it = m_free.begin(); it != m_free.end(); ++it)
+			{
+				if (it->second < size) continue;
+
+				const uint32_t offset = it->first;
+				const uint32_t rest = it->second - size;
+				m_free.erase(it);
+				if (rest > 0) m_free.emplace(offset + size, rest);
+				m_used += size;
+				return offset;
+			}
+			return std::nullopt;
+		}
+
+		void Free(uint32_t offset, uint32_t size)
+		{
+			if (size == 0) return;
+			m_used -= size;
+
+			auto next = m_free.lower_bound(offset);
+			if (next != m_free.begin())
+			{
+				auto prev = std::prev(next);
+				if (prev->first + prev->second == offset)
+				{
+					offset = prev->first;
+					size += prev->second;
+					m_free.erase(prev);
+				}
+			}
+			if (next != m_free.end() && offset + size == next->first)
+			{
+				size += next->second;
+				m_free.erase(next);
+			}
+			m_free.emplace(offset, size);
+		}
+
+		uint32_t GetLargestFree() const
+		{
+			uint32_t largest = 0;
+			for (const auto& [offset, size] : m_free)
+				largest = std::max(largest, size);
+			return largest;
+		}
+
+		bool CanAllocate(uint32_t size) const { return size == 0 || GetLargestFree() >= size; }
+
+		float GetFragmentation() const
+		{
+			const uint32_t freeSize = m_capacity - m_used;
+			return freeSize > 0 ? 1.0f - float(GetLargestFree()) / float(freeSize) : 0.0f;
+		}
+
+		uint32_t GetCapacity() const noexcept { return m_capacity; }
+		uint32_t GetUsed() const noexcept { return m_used; }
+
+	private:
+		std::map<uint32_t, uint32_t> m_free; // offset -> size
+		uint32_t                     m_capacity{ 0 };
+		uint32_t                     m_used{ 0 };
+	};
+
+	struct GeometryPage final
+	{
+		MeshVertexFormat format{ MeshVertexFormat::Full };
+		GLuint           vao{ 0 };
+		BufferHandle     vbo{};
+		BufferHandle     ebo{};
+		RangeAllocator   vertices;
+		RangeAllocator   indices;
+		uint32_t         allocationCount{ 0 };
+		bool             dedicated{ false }; // bigger than the page size, released when empty
+	};
+
+	size_t pageVertexBytes{ 32 * 1024 * 1024 };
+	size_t pageIndexBytes{ 16 * 1024 * 1024 };
+
+	std::vector<GeometryPage>  pages;       // released pages have vao == 0 and are reused
+	std::vector<GeometryRange> allocations; // handle id - 1, free slots have vao == 0
+	std::vector<uint32_t>      freeIds;
+	bool                       freedSinceDefragment{ false };
+	const GeometryRange        emptyRange{};
+
+	void attachBuffers(GeometryPage& page)
+	{
+		GLuint currentVBO = GetCurrentBuffer(BufferTarget::Array);
+		GLuint currentEBO = GetCurrentBuffer(BufferTarget::ElementArray);
+
+		glBindVertexArray(page.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, page.vbo.handle);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.ebo.handle);
+		if (page.format == MeshVertexFormat::Packed)
+			MeshVertexPacked::SetVertexAttributes();
+		else
+			MeshVertex::SetVertexAttributes();
+		glBindVertexArray(0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, currentVBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, currentEBO);
+	}
+
+	uint32_t createPage(MeshVertexFormat format, uint32_t vertexCapacity, uint32_t indexCapacity, bool dedicated)
+	{
+		uint32_t pageId = 0;
+		while (pageId < pages.size() && pages[pageId].vao) pageId++;
+		if (pageId == pages.size()) pages.emplace_back();
+
+		GeometryPage& page = pages[pageId];
+		page.format = format;
+		page.dedicated = dedicated;
+		page.allocationCount = 0;
+		page.vbo = CreateBuffer(BufferTarget::Array, BufferUsage::StaticDraw, size_t(vertexCapacity) * GetVertexSize(format), nullptr);
+		page.ebo = CreateBuffer(BufferTarget::ElementArray, BufferUsage::StaticDraw, size_t(indexCapacity) * sizeof(uint32_t), nullptr);
+		page.vertices.Init(vertexCapacity);
+		page.indices.Init(indexCapacity);
+		glGenVertexArrays(1, &page.vao);
+		attachBuffers(page);
+
+		Debug("Geometry page created: " + std::to_string(size_t(vertexCapacity) * GetVertexSize(format) / 1024) + " KB vertices, " + std::to_string(size_t(indexCapacity) * sizeof(uint32_t) / 1024) + " KB indices");
+		return pageId;
+	}
+
+	void releasePage(GeometryPage& page)
+	{
+		if (page.vbo.handle) glDeleteBuffers(1, &page.vbo.handle);
+		if (page.ebo.handle) glDeleteBuffers(1, &page.ebo.handle);
+		if (page.vao) glDeleteVertexArrays(1, &page.vao);
+		page = GeometryPage{};
+	}
+
+	// Copies the live allocations into new buffers one after another. VAO stays the same, ranges get new offsets
+	void compactPage(uint32_t pageId)
+	{
+		GeometryPage& page = pages[pageId];
+		const size_t vertexSize = GetVertexSize(page.format);
+
+		std::vector<GeometryRange*> ranges;
+		ranges.reserve(page.allocationCount);
+		for (GeometryRange& range : allocations)
+		{
+			if (range.vao && range.page == pageId)
+				ranges.push_back(&range);
+		}
+		std::sort(ranges.begin(), ranges.end(), [](const GeometryRange* a, const GeometryRange* b) { return a->baseVertex < b->baseVertex; });
+
+		const BufferHandle vbo = CreateBuffer(BufferTarget::Array, BufferUsage::StaticDraw, size_t(page.vertices.GetCapacity()) * vertexSize, nullptr);
+		const BufferHandle ebo = CreateBuffer(BufferTarget::ElementArray, BufferUsage::StaticDraw, size_t(page.indices.GetCapacity()) * sizeof(uint32_t), nullptr);
+
+		uint32_t vertexOffset = 0;
+		uint32_t indexOffset = 0;
+		glBindBuffer(GL_COPY_READ_BUFFER, page.vbo.handle);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo.handle);
+		for (GeometryRange* range : ranges)
+		{
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(size_t(range->baseVertex) * vertexSize), static_cast<GLintptr>(size_t(vertexOffset) * vertexSize), static_cast<GLsizeiptr>(size_t(range->vertexCount) * vertexSize));
+			range->baseVertex = static_cast<GLint>(vertexOffset);
+			vertexOffset += range->vertexCount;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, page.ebo.handle);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo.handle);
+		for (GeometryRange* range : ranges)
+		{
+			if (range->indexCount == 0) continue;
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(size_t(range->firstIndex) * sizeof(uint32_t)), static_cast<GLintptr>(size_t(indexOffset) * sizeof(uint32_t)), static_cast<GLsizeiptr>(size_t(range->indexCount) * sizeof(uint32_t)));
+			range->firstIndex = indexOffset;
+			indexOffset += range->indexCount;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		glDeleteBuffers(1, &page.vbo.handle);
+		glDeleteBuffers(1, &page.ebo.handle);
+		page.vbo = vbo;
+		page.ebo = ebo;
+		page.vertices.Init(page.vertices.GetCapacity(), vertexOffset);
+		page.indices.Init(page.indices.GetCapacity(), indexOffset);
+		attachBuffers(page);
+	}
+
+	GeometryRange* getAllocation(GeometryHandle handle)
+	{
+		if (handle.id == 0 || handle.id > allocations.size()) return nullptr;
+		GeometryRange& range = allocations[handle.id - 1];
+		return range.vao ? &range : nullptr;
+	}
+}
+//=============================================================================
+void geometry::SetPageSize(size_t vertexBytes, size_t indexBytes)
+{
+	pageVertexBytes = vertexBytes;
+	pageIndexBytes = indexBytes;
+}
+//=============================================================================
+GeometryHandle geometry::Allocate(MeshVertexFormat format, uint32_t vertexCount, uint32_t indexCount)
+{
+	uint32_t pageId = 0;
+	for (; pageId < pages.size(); pageId++)
+	{
+		const GeometryPage& page = pages[pageId];
+		if (page.vao && page.format == format && page.vertices.CanAllocate(vertexCount) && page.indices.CanAllocate(indexCount))
+			break;
+	}
+	if (pageId == pages.size())
+	{
+		const uint32_t pageVertices = static_cast<uint32_t>(pageVertexBytes / GetVertexSize(format));
+		const uint32_t pageIndices = static_cast<uint32_t>(pageIndexBytes / sizeof(uint32_t));
+		const bool dedicated = vertexCount > pageVertices || indexCount > pageIndices;
+		pageId = createPage(format, std::max(vertexCount, pageVertices), std::max(indexCount, pageIndices), dedicated);
+	}
+
+	GeometryPage& page = pages[pageId];
+	GeometryRange range{};
+	range.vao = page.vao;
+	range.page = pageId;
+	range.format = format;
+	range.baseVertex = static_cast<GLint>(*page.vertices.Allocate(vertexCount));
+	range.vertexCount = vertexCount;
+	range.firstIndex = *page.indices.Allocate(indexCount);
+	range.indexCount = indexCount;
+	page.allocationCount++;
+
+	uint32_t id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+		allocations[id] = range;
+	}
+	else
+	{
+		id = static_cast<uint32_t>(allocations.size());
+		allocations.push_back(range);
+	}
+	return { id + 1 };
+}
+//=============================================================================
+void geometry::Free(GeometryHandle handle)
+{
+	// also called for meshes that outlive Close()
+	GeometryRange* range = getAllocation(handle);
+	if (!range) return;
+
+	GeometryPage& page = pages[range->page];
+	page.vertices.Free(static_cast<uint32_t>(range->baseVertex), range->vertexCount);
+	page.indices.Free(range->firstIndex, range->indexCount);
+	// shared pages stay for the next allocations, Defragment() releases them
+	if (--page.allocationCount == 0 && page.dedicated)
+		releasePage(page);
+
+	*range = GeometryRange{};
+	freeIds.push_back(handle.id - 1);
+	freedSinceDefragment = true;
+}
+//=============================================================================
+const GeometryRange& geometry::GetRange(GeometryHandle handle)
+{
+	const GeometryRange* range = getAllocation(handle);
+	return range ? *range : emptyRange;
+}
+//=============================================================================
+void geometry::SetVertexData(GeometryHandle handle, size_t firstVertex, size_t vertexCount, const void* vertices)
+{
+	const GeometryRange* range = getAllocation(handle);
+	if (!range) return;
+	assert(firstVertex + vertexCount <= range->vertexCount);
+
+	const size_t vertexSize = GetVertexSize(range->format);
+	BufferSubData(pages[range->page].vbo, BufferTarget::Array, static_cast<GLintptr>((size_t(range->baseVertex) + firstVertex) * vertexSize), static_cast<GLsizeiptr>(vertexCount * vertexSize), vertices);
+}
+//=============================================================================
+void geometry::SetIndexData(GeometryHandle handle, size_t firstIndex, std::span<const uint32_t> indices)
+{
+	const GeometryRange* range = getAllocation(handle);
+	if (!range) return;
+	assert(firstIndex + indices.size() <= range->indexCount);
+
+	BufferSubData(pages[range->page].ebo, BufferTarget::ElementArray, static_cast<GLintptr>((size_t(range->firstIndex) + firstIndex) * sizeof(uint32_t)), static_cast<GLsizeiptr>(indices.size_bytes()), indices.data());
+}
+//=============================================================================
+void geometry::Bind(const GeometryRange& range)
+{
+	// the state cache drops the bind of the VAO already current
+	glBindVertexArray(range.vao);
+}
+//=============================================================================
+void geometry::ResetBinding()
+{
+	glBindVertexArray(0);
+}
+//=============================================================================
+void geometry::Defragment(float minFragmentation)
+{
+	// fragmentation only grows by Free, without one the pages are as the last call left them
+	if (!freedSinceDefragment) return;
+	freedSinceDefragment = false;
+
+	for (uint32_t pageId = 0; pageId < pages.size(); pageId++)
+	{
+		GeometryPage& page = pages[pageId];
+		if (!page.vao) continue;
+
+		if (page.allocationCount == 0)
+		{
+			releasePage(page);
+			continue;
+		}
+		if (page.vertices.GetFragmentation() < minFragmentation && page.indices.GetFragmentation() < minFragmentation)
+			continue;
+
+		compactPage(pageId);
+		Debug("Geometry page defragmented: " + std::to_string(pageId));
+	}
+}
+//=============================================================================
+GeometryStats geometry::GetStats()
+{
+	GeometryStats stats{};
+	for (const GeometryPage& page : pages)
+	{
+		if (!page.vao) continue;
+
+		const size_t vertexSize = GetVertexSize(page.format);
+		stats.pages++;
+		stats.allocations += page.allocationCount;
+		stats.vertexBytesUsed += size_t(page.vertices.GetUsed()) * vertexSize;
+		stats.vertexBytesReserved += size_t(page.vertices.GetCapacity()) * vertexSize;
+		stats.indexBytesUsed += size_t(page.indices.GetUsed()) * sizeof(uint32_t);
+		stats.indexBytesReserved += size_t(page.indices.GetCapacity()) * sizeof(uint32_t);
+	}
+	return stats;
+}
+//=============================================================================
+void geometry::Close()
+{
+	for (GeometryPage& page : pages)
+		releasePage(page);
+	pages.clear();
+	allocations.clear();
+	freeIds.clear();
+	freedSinceDefragment = false;
+}
+//=============================================================================
\ No newline at end of file
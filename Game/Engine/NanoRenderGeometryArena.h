@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "OGLBuffer.h"
+#include "OGLVertexAttribute.h"
+
+enum class MeshVertexFormat : uint8_t
+{
+	Full,  // MeshVertex
+	Packed // MeshVertexPacked
+};
+
+constexpr size_t GetVertexSize(MeshVertexFormat format) noexcept
+{
+	return format == MeshVertexFormat::Packed ? sizeof(MeshVertexPacked) : sizeof(MeshVertex);
+}
+
+struct GeometryHandle final { uint32_t id{ 0u }; };
+
+// Current place of an allocation. Indices are local to the allocation, draws add baseVertex
+struct GeometryRange final
+{
+	GLuint           vao{ 0 };
+	uint32_t         page{ 0 };
+	MeshVertexFormat format{ MeshVertexFormat::Full };
+	GLint            baseVertex{ 0 };
+	uint32_t         vertexCount{ 0 };
+	uint32_t         firstIndex{ 0 };
+	uint32_t         indexCount{ 0 };
+};
+
+struct GeometryStats final
+{
+	size_t pages{ 0 };
+	size_t allocations{ 0 };
+	size_t vertexBytesUsed{ 0 };
+	size_t vertexBytesReserved{ 0 };
+	size_t indexBytesUsed{ 0 };
+	size_t indexBytesReserved{ 0 };
+};
+
+// Shared vertex and index buffers for all meshes. Every vertex format has its own pages (VBO + EBO + VAO),
+// so meshes of one format are drawn without VAO switches.
+namespace geometry
+{
+	// size of new pages, bigger allocations get a page of their own
+	void SetPageSize(size_t vertexBytes, size_t indexBytes);
+
+	GeometryHandle Allocate(MeshVertexFormat format, uint32_t vertexCount, uint32_t indexCount);
+	void Free(GeometryHandle handle);
+
+	// changes after Defragment(), do not keep it between frames
+	const GeometryRange& GetRange(GeometryHandle handle);
+
+	void SetVertexData(GeometryHandle handle, size_t firstVertex, size_t vertexCount, const void* vertices);
+	void SetIndexData(GeometryHandle handle, size_t firstIndex, std::span<const uint32_t> indices);
+
+	// binds the page VAO, the state cache drops the bind when it is already current. ResetBinding() unbinds it
+	// after a group of draws, for code that expects no vertex array bound
+	void Bind(const GeometryRange& range);
+	void ResetBinding();
+
+	// Moves the allocations of pages with free space split into pieces next to each other, empty pages are released.
+	// fragmentation = 1 - largest free block / all free space. engine::BeginFrame calls it before the draws of the
+	// frame take their ranges, it returns at once when nothing was freed since the last call
+	void Defragment(float minFragmentation = 0.5f);
+
+	GeometryStats GetStats();
+
+	void Close();
+} // namespace geometry
\ No newline at end of file
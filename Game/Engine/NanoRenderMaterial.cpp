@@ -3,4 +3,48 @@
 
 void MaterialShaderSlot::Bind(GLuint program, const Material& material)
 {
-}
\ No newline at end of file
+}
+//=============================================================================
+namespace
+{
+	template<typename Func>
+	void forEachTexture(const Material& material, Func&& func)
+	{
+		for (const auto* textures : { &material.diffuseTextures, &material.specularTextures, &material.normalTextures, &material.shininessTextures, &material.emissionTextures, &material.opacityTextures })
+		{
+			for (const Texture2D& texture : *textures)
+				func(texture);
+		}
+	}
+
+	template<typename Func>
+	void forEachTexture(const PBRMaterial& material, Func&& func)
+	{
+		func(material.albedoTexture);
+		func(material.normalTexture);
+		func(material.metallicRoughnessTexture);
+		func(material.AOTexture);
+		func(material.emissiveTexture);
+	}
+}
+//=============================================================================
+void AddTextureRefs(const Material& material)
+{
+	forEachTexture(material, textures::AddRef);
+}
+//=============================================================================
+void ReleaseTextureRefs(const Material& material)
+{
+	forEachTexture(material, textures::Release);
+}
+//=============================================================================
+void AddTextureRefs(const PBRMaterial& material)
+{
+	forEachTexture(material, textures::AddRef);
+}
+//=============================================================================
+void ReleaseTextureRefs(const PBRMaterial& material)
+{
+	forEachTexture(material, textures::Release);
+}
+//=============================================================================
\ No newline at end of file
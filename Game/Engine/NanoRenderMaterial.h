@@ -43,6 +43,12 @@ struct PBRMaterial final
 	Texture2D emissiveTexture;
 };
 
+// References of the material textures for the texture residency (textures::AddRef/Release). Mesh holds them while it lives
+void AddTextureRefs(const Material& material);
+void ReleaseTextureRefs(const Material& material);
+void AddTextureRefs(const PBRMaterial& material);
+void ReleaseTextureRefs(const PBRMaterial& material);
+
 struct PBRMaterialShaderSlot final
 {
 	int albedoTexture{ -1 };
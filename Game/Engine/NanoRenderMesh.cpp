@@ -1,101 +1,186 @@
 ﻿#include "stdafx.h"
 #include "NanoRenderMesh.h"
 //=============================================================================
-Mesh::Mesh(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial)
+namespace
 {
-	assert(!vertices.empty());
+	// half float keeps at least 1/256 precision below this value
+	constexpr float PackedTexCoordLimit = 8.0f;
 
-	m_vertexCount = static_cast<uint32_t>(vertices.size());
-	m_indicesCount = static_cast<uint32_t>(indices.size());
+	glm::vec2 octEncode(const glm::vec3& v)
+	{
+		const float length = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+		if (length <= 0.0f) return glm::vec2(0.0f);
+
+		glm::vec2 e = glm::vec2(v.x, v.y) / length;
+		if (v.z < 0.0f)
+		{
+			const glm::vec2 s(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+			e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * s;
+		}
+		return e;
+	}
+
+	void packDirection(const glm::vec3& v, int16_t out[2])
+	{
+		const glm::vec2 e = octEncode(v);
+		out[0] = static_cast<int16_t>(meshopt_quantizeSnorm(e.x, 16));
+		out[1] = static_cast<int16_t>(meshopt_quantizeSnorm(e.y, 16));
+	}
 
-	m_material = material;
-	m_pbrMaterial = pbrMaterial;
+	// uniforms of Mesh::tDraw, resolved once per program
+	struct DrawUniforms final
+	{
+		VertexDecodeUniforms vertexDecode;
 
-	GLuint currentVBO = GetCurrentBuffer(BufferTarget::Array);
-	GLuint currentEBO = GetCurrentBuffer(BufferTarget::ElementArray);
+		int colorDiffuse{ -1 };
+		int colorSpecular{ -1 };
+		int colorAmbient{ -1 };
+		int shininess{ -1 };
+		int hasDiffuse{ -1 };
+		int hasSpecular{ -1 };
+		int hasNormal{ -1 };
+		int nbTextures{ -1 };
+		int opacity{ -1 };
+	};
+	std::unordered_map<GLuint, DrawUniforms> drawUniforms;
 
-	// Buffers
-	m_vbo = CreateBuffer(BufferTarget::Array, BufferUsage::StaticDraw, vertices.size() * sizeof(MeshVertex), vertices.data());
-	if (!indices.empty())
-		m_ebo = CreateBuffer(BufferTarget::ElementArray, BufferUsage::StaticDraw, indices.size() * sizeof(uint32_t), indices.data());
+	const DrawUniforms& getDrawUniforms(ProgramHandle program)
+	{
+		auto [it, inserted] = drawUniforms.try_emplace(program.handle);
+		if (!inserted) return it->second;
 
-	// VAO
-	glGenVertexArrays(1, &m_vao);
-	glBindVertexArray(m_vao);
-	glBindBuffer(GL_ARRAY_BUFFER, m_vbo.handle);
-	if (m_ebo.handle > 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo.handle);
-	MeshVertex::SetVertexAttributes();
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, currentVBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, currentEBO);
+		static bool deleteCallback = false;
+		if (!deleteCallback)
+		{
+			AddProgramDeleteCallback([](GLuint deleted) { drawUniforms.erase(deleted); });
+			deleteCallback = true;
+		}
 
-	initAABB(vertices, indices);
+		DrawUniforms& uniforms = it->second;
+		uniforms.vertexDecode.Init(program);
+		uniforms.colorDiffuse = GetUniformLocation(program, "material.color_diffuse");
+		uniforms.colorSpecular = GetUniformLocation(program, "material.color_specular");
+		uniforms.colorAmbient = GetUniformLocation(program, "material.color_ambient");
+		uniforms.shininess = GetUniformLocation(program, "material.shininess");
+		uniforms.hasDiffuse = GetUniformLocation(program, "material.hasDiffuse");
+		uniforms.hasSpecular = GetUniformLocation(program, "material.hasSpecular");
+		uniforms.hasNormal = GetUniformLocation(program, "material.hasNormal");
+		uniforms.nbTextures = GetUniformLocation(program, "material.nbTextures");
+		uniforms.opacity = GetUniformLocation(program, "material.opacity");
+		return uniforms;
+	}
+}
+//=============================================================================
+Mesh::Mesh(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial)
+	: Mesh(vertices, indices, ComputeMeshAABB(vertices, indices), std::move(material), std::move(pbrMaterial))
+{
+}
+//=============================================================================
+Mesh::Mesh(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices, const AABB& aabb, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial)
+	: m_material(std::move(material))
+	, m_pbrMaterial(std::move(pbrMaterial))
+	, m_aabb(aabb)
+{
+	createBuffers(static_cast<uint32_t>(vertices.size()), vertices.data(), static_cast<uint32_t>(indices.size()), indices.data());
+}
+//=============================================================================
+Mesh::Mesh(std::span<const MeshVertexPacked> vertices, std::span<const uint32_t> indices, const AABB& aabb, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial)
+	: m_vertexFormat(MeshVertexFormat::Packed)
+	, m_material(std::move(material))
+	, m_pbrMaterial(std::move(pbrMaterial))
+	, m_aabb(aabb)
+{
+	createBuffers(static_cast<uint32_t>(vertices.size()), vertices.data(), static_cast<uint32_t>(indices.size()), indices.data());
+}
+//=============================================================================
+Mesh::Mesh(uint32_t vertexCount, uint32_t indexCount, const AABB& aabb, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial, MeshVertexFormat vertexFormat)
+	: m_vertexFormat(vertexFormat)
+	, m_material(std::move(material))
+	, m_pbrMaterial(std::move(pbrMaterial))
+	, m_aabb(aabb)
+{
+	createBuffers(vertexCount, nullptr, indexCount, nullptr);
 }
 //=============================================================================
 Mesh::Mesh(Mesh&& old) noexcept
-	: m_vertexCount(std::exchange(old.m_vertexCount, 0))
+	: m_vertexFormat(old.m_vertexFormat)
+	, m_vertexCount(std::exchange(old.m_vertexCount, 0))
 	, m_indicesCount(std::exchange(old.m_indicesCount, 0))
-	, m_vao(std::exchange(old.m_vao, 0))
-	, m_vbo(std::exchange(old.m_vbo.handle, 0))
-	, m_ebo(std::exchange(old.m_ebo.handle, 0))
+	, m_geometry(std::exchange(old.m_geometry, {}))
 	, m_material(std::exchange(old.m_material, std::nullopt))
 	, m_pbrMaterial(std::exchange(old.m_pbrMaterial, std::nullopt))
 	, m_aabb(old.m_aabb)
+	, m_lods(std::move(old.m_lods))
+	, m_meshlets(std::move(old.m_meshlets))
 {
 }
 //=============================================================================
 Mesh::~Mesh()
 {
-	if (m_vbo.handle) glDeleteBuffers(1, &m_vbo.handle);
-	if (m_ebo.handle) glDeleteBuffers(1, &m_ebo.handle);
-	if (m_vao) glDeleteVertexArrays(1, &m_vao);
+	release();
 }
 //=============================================================================
 Mesh& Mesh::operator=(Mesh&& old) noexcept
 {
 	if (this != &old)
 	{
-		this->~Mesh();
+		release();
+		m_vertexFormat = old.m_vertexFormat;
 		m_vertexCount = std::exchange(old.m_vertexCount, 0);
 		m_indicesCount = std::exchange(old.m_indicesCount, 0);
-		m_vao = std::exchange(old.m_vao, 0);
-		m_vbo.handle = std::exchange(old.m_vbo.handle, 0);
-		m_ebo.handle = std::exchange(old.m_ebo.handle, 0);
+		m_geometry = std::exchange(old.m_geometry, {});
 		m_material = std::exchange(old.m_material, std::nullopt);
 		m_pbrMaterial = std::exchange(old.m_pbrMaterial, std::nullopt);
 		m_aabb = old.m_aabb;
+		m_lods = std::move(old.m_lods);
+		m_meshlets = std::move(old.m_meshlets);
 	}
 	return *this;
 }
 //=============================================================================
-void Mesh::Draw(GLenum mode, unsigned instanceCount) const
+void Mesh::release()
+{
+	geometry::Free(std::exchange(m_geometry, {}));
+	if (m_material) ReleaseTextureRefs(*m_material);
+	if (m_pbrMaterial) ReleaseTextureRefs(*m_pbrMaterial);
+	m_material.reset();
+	m_pbrMaterial.reset();
+}
+//=============================================================================
+void Mesh::Draw(GLenum mode, unsigned instanceCount, size_t lod) const
 {
-	assert(m_vao);
-	glBindVertexArray(m_vao);
+	const GeometryRange& geometryRange = geometry::GetRange(m_geometry);
+	assert(geometryRange.vao);
+	geometry::Bind(geometryRange);
 
-	if (m_ebo.handle > 0)
+	if (m_indicesCount > 0)
 	{
+		const MeshLod& range = m_lods[std::min(lod, m_lods.size() - 1)];
+		const void* offset = reinterpret_cast<const void*>((size_t(geometryRange.firstIndex) + range.indexOffset) * sizeof(uint32_t));
 		if (instanceCount > 1)
-			glDrawElementsInstanced(mode, static_cast<GLsizei>(m_indicesCount), GL_UNSIGNED_INT, 0, static_cast<GLsizei>(instanceCount));
+			glDrawElementsInstancedBaseVertex(mode, static_cast<GLsizei>(range.indexCount), GL_UNSIGNED_INT, offset, static_cast<GLsizei>(instanceCount), geometryRange.baseVertex);
 		else
-			glDrawElements(mode, static_cast<GLsizei>(m_indicesCount), GL_UNSIGNED_INT, 0);
+			glDrawElementsBaseVertex(mode, static_cast<GLsizei>(range.indexCount), GL_UNSIGNED_INT, offset, geometryRange.baseVertex);
 	}
 	else
 	{
 		if (instanceCount > 1)
 			; // TODO:???
 		else
-			glDrawArrays(mode, 0, static_cast<GLsizei>(m_vertexCount));
+			glDrawArrays(mode, geometryRange.baseVertex, static_cast<GLsizei>(m_vertexCount));
 	}
-	glBindVertexArray(0);
 }
 //=============================================================================
 void Mesh::tDraw(GLenum mode, ProgramHandle program, bool bindMaterial, bool instancing, int amount)
 {
-	assert(m_vao);
+	const GeometryRange& geometryRange = geometry::GetRange(m_geometry);
+	assert(geometryRange.vao);
 
 	// TODO: переделать. убрать биндинг материала в отдельную функцию
 
+	if (program.handle)
+		getDrawUniforms(program).vertexDecode.Set(*this);
+
 	if (bindMaterial && m_material)
 	{
 		bool hasDiffuseTexture = false;
@@ -126,52 +211,298 @@ void Mesh::tDraw(GLenum mode, ProgramHandle program, bool bindMaterial, bool ins
 
 		if (program.handle)
 		{
-			SetUniform(GetUniformLocation(program, "material.color_diffuse"), m_material->diffuseColor);
-			SetUniform(GetUniformLocation(program, "material.color_specular"), m_material->specularColor);
-			SetUniform(GetUniformLocation(program, "material.color_ambient"), m_material->ambientColor);
-			SetUniform(GetUniformLocation(program, "material.shininess"), m_material->shininess);
-
-			SetUniform(GetUniformLocation(program, "material.hasDiffuse"), hasDiffuseTexture ? 1 : 0);
-			SetUniform(GetUniformLocation(program, "material.hasSpecular"), hasSpecularTexture ? 1 : 0);
-			SetUniform(GetUniformLocation(program, "material.hasNormal"), hasNormalTexture ? 1 : 0);
-			SetUniform(GetUniformLocation(program, "material.nbTextures"), nbTextures);
-			SetUniform(GetUniformLocation(program, "material.opacity"), m_material->opacity);
+			const DrawUniforms& uniforms = getDrawUniforms(program);
+			SetUniform(uniforms.colorDiffuse, m_material->diffuseColor);
+			SetUniform(uniforms.colorSpecular, m_material->specularColor);
+			SetUniform(uniforms.colorAmbient, m_material->ambientColor);
+			SetUniform(uniforms.shininess, m_material->shininess);
+
+			SetUniform(uniforms.hasDiffuse, hasDiffuseTexture ? 1 : 0);
+			SetUniform(uniforms.hasSpecular, hasSpecularTexture ? 1 : 0);
+			SetUniform(uniforms.hasNormal, hasNormalTexture ? 1 : 0);
+			SetUniform(uniforms.nbTextures, nbTextures);
+			SetUniform(uniforms.opacity, m_material->opacity);
 		}
 	}
 
-	glBindVertexArray(m_vao);
-	if (m_ebo.handle > 0)
+	geometry::Bind(geometryRange);
+	if (m_indicesCount > 0)
 	{
+		const void* offset = reinterpret_cast<const void*>(size_t(geometryRange.firstIndex) * sizeof(uint32_t));
 		if (instancing)
-			glDrawElementsInstanced(mode, static_cast<GLsizei>(m_indicesCount), GL_UNSIGNED_INT, 0, amount);
+			glDrawElementsInstancedBaseVertex(mode, static_cast<GLsizei>(m_lods[0].indexCount), GL_UNSIGNED_INT, offset, amount, geometryRange.baseVertex);
 		else
-			glDrawElements(mode, static_cast<GLsizei>(m_indicesCount), GL_UNSIGNED_INT, 0);
+			glDrawElementsBaseVertex(mode, static_cast<GLsizei>(m_lods[0].indexCount), GL_UNSIGNED_INT, offset, geometryRange.baseVertex);
 	}
 	else
 	{
 		if (instancing)
 			; // TODO:???
 		else
-			glDrawArrays(mode, 0, static_cast<GLsizei>(m_vertexCount));
+			glDrawArrays(mode, geometryRange.baseVertex, static_cast<GLsizei>(m_vertexCount));
 	}
-	glBindVertexArray(0);
+	geometry::ResetBinding();
 }
 //=============================================================================
-void Mesh::initAABB(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indexData)
+void Mesh::SetVertexData(size_t firstVertex, std::span<const MeshVertex> vertices)
 {
+	assert(m_vertexFormat == MeshVertexFormat::Full && firstVertex + vertices.size() <= m_vertexCount);
+	geometry::SetVertexData(m_geometry, firstVertex, vertices.size(), vertices.data());
+}
+//=============================================================================
+void Mesh::SetVertexData(size_t firstVertex, std::span<const MeshVertexPacked> vertices)
+{
+	assert(m_vertexFormat == MeshVertexFormat::Packed && firstVertex + vertices.size() <= m_vertexCount);
+	geometry::SetVertexData(m_geometry, firstVertex, vertices.size(), vertices.data());
+}
+//=============================================================================
+void Mesh::SetIndexData(size_t firstIndex, std::span<const uint32_t> indices)
+{
+	assert(firstIndex + indices.size() <= m_indicesCount);
+	geometry::SetIndexData(m_geometry, firstIndex, indices);
+}
+//=============================================================================
+void Mesh::SetLods(std::span<const MeshLod> lods)
+{
+	if (lods.empty()) return;
+	assert(lods[0].indexOffset == 0);
+	for (const MeshLod& lod : lods)
+		assert(lod.indexOffset + lod.indexCount <= m_indicesCount);
+
+	m_lods.assign(lods.begin(), lods.end());
+}
+//=============================================================================
+size_t Mesh::SelectLod(float distance, const LodSelectInfo& info, size_t currentLod) const
+{
+	if (m_lods.size() <= 1) return 0;
+
+	const float invDistance = info.projScale / std::max(distance, 0.0001f);
+	auto screenError = [&](size_t lod) { return m_lods[lod].error * invDistance; };
+
+	// errors grow with the level, take the coarsest one under the threshold
+	size_t lod = 0;
+	for (size_t i = 1; i < m_lods.size() && screenError(i) <= info.pixelError; i++)
+		lod = i;
+
+	currentLod = std::min(currentLod, m_lods.size() - 1);
+	if (lod > currentLod)
+	{
+		// go coarser only when the new level is clearly under the threshold
+		while (lod > currentLod && screenError(lod) > info.pixelError * (1.0f - info.hysteresis))
+			lod--;
+	}
+	else if (lod < currentLod && screenError(currentLod) <= info.pixelError * (1.0f + info.hysteresis))
+	{
+		lod = currentLod;
+	}
+
+	const int biased = static_cast<int>(lod) + info.lodBias;
+	return static_cast<size_t>(std::clamp(biased, 0, static_cast<int>(m_lods.size()) - 1));
+}
+//=============================================================================
+void Mesh::SetMeshlets(std::span<const Meshlet> meshlets)
+{
+	for (const Meshlet& meshlet : meshlets)
+		assert(m_lods.empty() || meshlet.indexOffset + meshlet.indexCount <= m_lods[0].indexCount);
+
+	m_meshlets.assign(meshlets.begin(), meshlets.end());
+}
+//=============================================================================
+bool Mesh::CullMeshlets(const MeshletCullInfo& info, MeshDrawRanges& outRanges) const
+{
+	outRanges.Clear();
+	if (m_meshlets.empty()) return false;
+
+	// tests run in object space. Planes are normalized there so the meshlet radius needs no scaling
+	glm::vec4 planes[6];
+	GetFrustumPlanes(info.viewProj * info.worldMatrix, planes);
+	for (glm::vec4& plane : planes)
+		plane /= std::max(glm::length(glm::vec3(plane)), 0.000001f);
+
+	const glm::mat4 invWorld = glm::inverse(info.worldMatrix);
+	const glm::vec3 viewPosition = glm::vec3(invWorld * glm::vec4(info.viewPosition, 1.0f));
+	const glm::vec3 viewDirection = glm::normalize(glm::vec3(invWorld * glm::vec4(info.viewDirection, 0.0f)));
+	const GeometryRange& geometryRange = geometry::GetRange(m_geometry);
+
+	const glm::vec3 scale(glm::length(glm::vec3(info.worldMatrix[0])), glm::length(glm::vec3(info.worldMatrix[1])), glm::length(glm::vec3(info.worldMatrix[2])));
+	const float minScale = std::min({ scale.x, scale.y, scale.z });
+	const float maxScale = std::max({ scale.x, scale.y, scale.z });
+	const float maxDistance = info.maxDistance / std::max(minScale, 0.000001f);
+	// normal cones keep their angle only under rotation and uniform scale, mirroring swaps the faces
+	const bool coneCulling = info.coneCulling && maxScale - minScale <= maxScale * 0.01f && glm::determinant(glm::mat3(info.worldMatrix)) > 0.0f;
+
+	size_t rangeEnd = 0;
+	for (const Meshlet& meshlet : m_meshlets)
+	{
+		bool visible = true;
+		if (info.frustumCulling)
+		{
+			for (const glm::vec4& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius)
+				{
+					visible = false;
+					break;
+				}
+			}
+		}
+		if (visible && maxDistance > 0.0f && glm::distance(meshlet.center, viewPosition) > maxDistance + meshlet.radius)
+			visible = false;
+		if (visible && coneCulling)
+		{
+			const glm::vec3 direction = info.orthographic ? viewDirection : glm::normalize(meshlet.coneApex - viewPosition);
+			if (glm::dot(direction, meshlet.coneAxis) >= meshlet.coneCutoff)
+				visible = false;
+		}
+		if (!visible) continue;
+
+		// meshlets are stored in order, neighbours merge into one range
+		if (!outRanges.Empty() && rangeEnd == meshlet.indexOffset)
+		{
+			outRanges.counts.back() += static_cast<GLsizei>(meshlet.indexCount);
+		}
+		else
+		{
+			outRanges.counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+			outRanges.offsets.push_back(reinterpret_cast<const void*>((size_t(geometryRange.firstIndex) + meshlet.indexOffset) * sizeof(uint32_t)));
+			outRanges.baseVertices.push_back(geometryRange.baseVertex);
+		}
+		rangeEnd = size_t(meshlet.indexOffset) + meshlet.indexCount;
+	}
+	return true;
+}
+//=============================================================================
+void Mesh::DrawRanges(const MeshDrawRanges& ranges, GLenum mode) const
+{
+	assert(m_indicesCount > 0);
+	if (ranges.Empty()) return;
+
+	geometry::Bind(geometry::GetRange(m_geometry));
+	glMultiDrawElementsBaseVertex(mode, ranges.counts.data(), GL_UNSIGNED_INT, ranges.offsets.data(), static_cast<GLsizei>(ranges.counts.size()), ranges.baseVertices.data());
+}
+//=============================================================================
+void Mesh::DrawCulled(const MeshletCullInfo& info, MeshDrawRanges& ranges, size_t lod, GLenum mode) const
+{
+	if (lod == 0 && CullMeshlets(info, ranges))
+		DrawRanges(ranges, mode);
+	else
+		Draw(mode, 1, lod);
+}
+//=============================================================================
+void Mesh::createBuffers(uint32_t vertexCount, const void* vertices, uint32_t indexCount, const uint32_t* indices)
+{
+	assert(vertexCount > 0);
+
+	m_vertexCount = vertexCount;
+	m_indicesCount = indexCount;
+	if (indexCount > 0)
+		m_lods = { MeshLod{ 0, indexCount, 0.0f } };
+
+	if (m_material) AddTextureRefs(*m_material);
+	if (m_pbrMaterial) AddTextureRefs(*m_pbrMaterial);
+
+	m_geometry = geometry::Allocate(m_vertexFormat, vertexCount, indexCount);
+	if (vertices)
+		geometry::SetVertexData(m_geometry, 0, vertexCount, vertices);
+	if (indices)
+		geometry::SetIndexData(m_geometry, 0, { indices, indexCount });
+}
+//=============================================================================
+AABB ComputeMeshAABB(std::span<const MeshVertex> vertices, std::span<const uint32_t> indexData)
+{
+	AABB aabb;
 	if (indexData.size() > 0)
 	{
 		for (size_t index_id = 0; index_id < indexData.size(); index_id++)
 		{
-			m_aabb.CombinePoint(vertices[indexData[index_id]].position);
+			aabb.CombinePoint(vertices[indexData[index_id]].position);
 		}
 	}
 	else
 	{
 		for (size_t vertex_id = 0; vertex_id < vertices.size(); vertex_id++)
 		{
-			m_aabb.CombinePoint(vertices[vertex_id].position);
+			aabb.CombinePoint(vertices[vertex_id].position);
 		}
 	}
+	return aabb;
+}
+//=============================================================================
+bool CanPackMeshVertices(std::span<const MeshVertex> vertices)
+{
+	for (const MeshVertex& v : vertices)
+	{
+		if (std::abs(v.texCoord.x) > PackedTexCoordLimit || std::abs(v.texCoord.y) > PackedTexCoordLimit)
+			return false;
+	}
+	return true;
+}
+//=============================================================================
+std::vector<MeshVertexPacked> PackMeshVertices(std::span<const MeshVertex> vertices, const AABB& bounds)
+{
+	const glm::vec3 size = bounds.max - bounds.min;
+	const glm::vec3 invSize(
+		size.x > 0.0f ? 1.0f / size.x : 0.0f,
+		size.y > 0.0f ? 1.0f / size.y : 0.0f,
+		size.z > 0.0f ? 1.0f / size.z : 0.0f);
+
+	std::vector<MeshVertexPacked> packed(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const MeshVertex& v = vertices[i];
+		MeshVertexPacked& p = packed[i];
+
+		// vertices outside of bounds (not referenced by indices) are clamped
+		const glm::vec3 position = glm::clamp((v.position - bounds.min) * invSize, 0.0f, 1.0f);
+		p.position[0] = static_cast<uint16_t>(meshopt_quantizeUnorm(position.x, 16));
+		p.position[1] = static_cast<uint16_t>(meshopt_quantizeUnorm(position.y, 16));
+		p.position[2] = static_cast<uint16_t>(meshopt_quantizeUnorm(position.z, 16));
+		p.position[3] = glm::dot(glm::cross(v.normal, v.tangent), v.bitangent) < 0.0f ? uint16_t(0) : uint16_t(65535);
+
+		p.color[0] = static_cast<uint8_t>(meshopt_quantizeUnorm(v.color.x, 8));
+		p.color[1] = static_cast<uint8_t>(meshopt_quantizeUnorm(v.color.y, 8));
+		p.color[2] = static_cast<uint8_t>(meshopt_quantizeUnorm(v.color.z, 8));
+		p.color[3] = 255;
+
+		packDirection(v.normal, p.normal);
+		packDirection(v.tangent, p.tangent);
+
+		p.texCoord[0] = meshopt_quantizeHalf(v.texCoord.x);
+		p.texCoord[1] = meshopt_quantizeHalf(v.texCoord.y);
+	}
+	return packed;
+}
+//=============================================================================
+float GetLodProjScale(const glm::mat4& proj, float viewportHeight)
+{
+	return proj[1][1] * viewportHeight * 0.5f;
+}
+//=============================================================================
+float GetLodDistance(const AABB& localBounds, const glm::mat4& worldMatrix, const glm::vec3& cameraPosition)
+{
+	const AABB worldBounds = localBounds.GetTransformed(worldMatrix);
+	const glm::vec3 closest = glm::clamp(cameraPosition, worldBounds.min, worldBounds.max);
+	const float scale = std::max({ glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1])), glm::length(glm::vec3(worldMatrix[2])) });
+	return glm::distance(cameraPosition, closest) / std::max(scale, 0.0001f);
+}
+//=============================================================================
+void VertexDecodeUniforms::Init(ProgramHandle program)
+{
+	packed = GetUniformLocation(program, "vertexPacked");
+	positionOffset = GetUniformLocation(program, "vertexPositionOffset");
+	positionScale = GetUniformLocation(program, "vertexPositionScale");
+}
+//=============================================================================
+void VertexDecodeUniforms::Set(const Mesh& mesh) const
+{
+	if (packed < 0) return; // program without the decode block, only MeshVertex meshes
+
+	const bool isPacked = mesh.GetVertexFormat() == MeshVertexFormat::Packed;
+	SetUniform(packed, isPacked);
+	if (isPacked)
+	{
+		SetUniform(positionOffset, mesh.GetAABB().min);
+		SetUniform(positionScale, mesh.GetAABB().max - mesh.GetAABB().min);
+	}
 }
 //=============================================================================
\ No newline at end of file
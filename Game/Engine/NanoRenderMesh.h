@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "NanoRenderMaterial.h"
+#include "NanoRenderGeometryArena.h"
 #include "NanoMath.h"
 #include "NanoOpenGL3.h"
 #include "OGLShader.h"
@@ -14,10 +15,77 @@ struct MeshInfo final
 	std::optional<PBRMaterial> pbrMaterial{};
 };
 
+// Index range of one level of detail inside the mesh index buffer. Level 0 is the full mesh
+struct MeshLod final
+{
+	uint32_t indexOffset{ 0 };
+	uint32_t indexCount{ 0 };
+	float    error{ 0.0f }; // simplification error in object space units
+};
+
+struct LodSelectInfo final
+{
+	float projScale{ 1.0f };   // pixels per unit at distance 1, see GetLodProjScale()
+	float pixelError{ 1.0f };  // max screen error of the selected level
+	float hysteresis{ 0.25f }; // band around pixelError in which the current level is kept
+	int   lodBias{ 0 };        // added to the selected level (shadow passes use coarser levels)
+};
+
+// Cluster of level 0 triangles (see MeshOptimizer::BuildMeshlets) with bounds for CPU culling, object space
+struct Meshlet final
+{
+	uint32_t  indexOffset{ 0 };
+	uint32_t  indexCount{ 0 };
+	glm::vec3 center{ 0.0f };
+	float     radius{ 0.0f };
+	glm::vec3 coneApex{ 0.0f };
+	glm::vec3 coneAxis{ 0.0f };
+	float     coneCutoff{ 1.0f }; // cos of the normal cone half angle, 1 - never rejected
+};
+
+struct MeshletCullInfo final
+{
+	glm::mat4 viewProj{ 1.0f };
+	glm::mat4 worldMatrix{ 1.0f };
+	glm::vec3 viewPosition{ 0.0f };               // world space, perspective views and maxDistance
+	glm::vec3 viewDirection{ 0.0f, 0.0f, -1.0f }; // world space, orthographic views
+	bool      orthographic{ false };
+	bool      frustumCulling{ true };             // false for views that are not one frustum (point light cube)
+	float     maxDistance{ 0.0f };                // from viewPosition, 0 - unlimited
+	bool      coneCulling{ true };                // back-face rejection, only for passes that cull back faces
+};
+
+// Index ranges for glMultiDrawElementsBaseVertex. Kept by the render pass and reused between draws
+struct MeshDrawRanges final
+{
+	void Clear() { counts.clear(); offsets.clear(); baseVertices.clear(); }
+	bool Empty() const noexcept { return counts.empty(); }
+
+	std::vector<GLsizei>     counts;
+	std::vector<const void*> offsets;
+	std::vector<GLint>       baseVertices;
+};
+
+AABB ComputeMeshAABB(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices);
+
+// false if the vertices lose too much precision in MeshVertexPacked (texture coordinates outside the half float range)
+bool CanPackMeshVertices(std::span<const MeshVertex> vertices);
+// positions are quantized inside bounds, the mesh must be created with the same AABB
+std::vector<MeshVertexPacked> PackMeshVertices(std::span<const MeshVertex> vertices, const AABB& bounds);
+
+float GetLodProjScale(const glm::mat4& proj, float viewportHeight);
+// distance from the camera to the bounds, in object space units
+float GetLodDistance(const AABB& localBounds, const glm::mat4& worldMatrix, const glm::vec3& cameraPosition);
+
 class Mesh final
 {
 public:
-	Mesh(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial);
+	Mesh(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial);
+	Mesh(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices, const AABB& aabb, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial);
+	// aabb must be the bounds passed to PackMeshVertices()
+	Mesh(std::span<const MeshVertexPacked> vertices, std::span<const uint32_t> indices, const AABB& aabb, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial);
+	// allocates geometry only, data is uploaded later with SetVertexData/SetIndexData
+	Mesh(uint32_t vertexCount, uint32_t indexCount, const AABB& aabb, std::optional<Material> material, std::optional<PBRMaterial> pbrMaterial, MeshVertexFormat vertexFormat = MeshVertexFormat::Full);
 	Mesh(const Mesh&) = delete;
 	Mesh(Mesh&& other) noexcept;
 	~Mesh();
@@ -25,25 +93,61 @@ public:
 	Mesh& operator=(const Mesh&) = delete;
 	Mesh& operator=(Mesh&& other) noexcept;
 
-	void Draw(GLenum mode = GL_TRIANGLES, unsigned instanceCount = 1) const;
+	// leaves the geometry page bound, call geometry::ResetBinding() after the last mesh
+	void Draw(GLenum mode = GL_TRIANGLES, unsigned instanceCount = 1, size_t lod = 0) const;
 
 	void tDraw(GLenum mode = GL_TRIANGLES, ProgramHandle program = {}, bool bindMaterial = true, bool instancing = false, int amount = 1);
 
+	void SetVertexData(size_t firstVertex, std::span<const MeshVertex> vertices);
+	void SetVertexData(size_t firstVertex, std::span<const MeshVertexPacked> vertices);
+	void SetIndexData(size_t firstIndex, std::span<const uint32_t> indices);
+
+	// lods[0] must be the full mesh
+	void SetLods(std::span<const MeshLod> lods);
+	size_t SelectLod(float distance, const LodSelectInfo& info, size_t currentLod = 0) const;
+	size_t GetNumLods() const noexcept { return m_lods.size(); }
+	const MeshLod& GetLod(size_t lod) const noexcept { return m_lods[lod]; }
+
+	// meshlets must cover level 0
+	void SetMeshlets(std::span<const Meshlet> meshlets);
+	size_t GetNumMeshlets() const noexcept { return m_meshlets.size(); }
+	// Visible meshlets merged into contiguous ranges, offsets are inside the shared index buffer. false if the mesh has no meshlets
+	bool CullMeshlets(const MeshletCullInfo& info, MeshDrawRanges& outRanges) const;
+	void DrawRanges(const MeshDrawRanges& ranges, GLenum mode = GL_TRIANGLES) const;
+	// Draw() of one level, level 0 of a mesh with meshlets draws only the visible clusters. ranges is scratch memory
+	void DrawCulled(const MeshletCullInfo& info, MeshDrawRanges& ranges, size_t lod = 0, GLenum mode = GL_TRIANGLES) const;
+
+	auto GetGeometry() const noexcept { return m_geometry; }
 	auto GetVertexCount() const noexcept { return m_vertexCount; }
+	auto GetVertexFormat() const noexcept { return m_vertexFormat; }
 	auto GetIndexCount() const noexcept { return m_indicesCount; }
 	auto GetMaterial() const noexcept { return m_material; }
 	auto GetPbrMaterial() const noexcept { return m_pbrMaterial; }
 	const AABB& GetAABB() const noexcept { return m_aabb; }
 
 private:
-	void initAABB(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices);
+	void createBuffers(uint32_t vertexCount, const void* vertices, uint32_t indexCount, const uint32_t* indices);
+	// frees the geometry and the texture references, the destructor and the move assignment share it
+	void release();
 
+	MeshVertexFormat           m_vertexFormat{ MeshVertexFormat::Full };
 	uint32_t                   m_vertexCount{ 0 };
 	uint32_t                   m_indicesCount{ 0 };
-	GLuint                     m_vao{ 0 };
-	BufferHandle               m_vbo{};
-	BufferHandle               m_ebo{};
+	GeometryHandle             m_geometry{};
 	std::optional<Material>    m_material{};
 	std::optional<PBRMaterial> m_pbrMaterial{};
 	AABB                       m_aabb{};
+	std::vector<MeshLod>       m_lods;
+	std::vector<Meshlet>       m_meshlets;
+};
+
+// Uniforms of data/shaders/vertexDecode.glsl. Set before drawing every mesh, packed meshes need their bounds
+struct VertexDecodeUniforms final
+{
+	void Init(ProgramHandle program);
+	void Set(const Mesh& mesh) const;
+
+	int packed{ -1 };
+	int positionOffset{ -1 };
+	int positionScale{ -1 };
 };
\ No newline at end of file
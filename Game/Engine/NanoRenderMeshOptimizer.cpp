@@ -0,0 +1,183 @@
+﻿#include "stdafx.h"
+#include "NanoRenderMeshOptimizer.h"
+#include "NanoLog.h"
+//=============================================================================
+namespace
+{
+	// typical desktop GPU post-transform cache
+	constexpr unsigned CacheSize = 16;
+
+	void analyze(std::span<const MeshVertex> vertices, std::span<const uint32_t> indices, bool overdraw, size_t& transformed, size_t& covered, size_t& shaded)
+	{
+		const meshopt_VertexCacheStatistics cacheStats = meshopt_analyzeVertexCache(indices.data(), indices.size(), vertices.size(), CacheSize, 0, 0);
+		transformed = cacheStats.vertices_transformed;
+
+		if (overdraw)
+		{
+			const meshopt_OverdrawStatistics overdrawStats = meshopt_analyzeOverdraw(indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(MeshVertex));
+			covered = overdrawStats.pixels_covered;
+			shaded = overdrawStats.pixels_shaded;
+		}
+	}
+}
+//=============================================================================
+void MeshOptimizeStats::Add(const MeshOptimizeStats& stats)
+{
+	meshes             += stats.meshes;
+	triangles          += stats.triangles;
+	verticesBefore     += stats.verticesBefore;
+	verticesAfter      += stats.verticesAfter;
+	transformedBefore  += stats.transformedBefore;
+	transformedAfter   += stats.transformedAfter;
+	pixelsCovered      += stats.pixelsCovered;
+	pixelsShadedBefore += stats.pixelsShadedBefore;
+	pixelsShadedAfter  += stats.pixelsShadedAfter;
+}
+//=============================================================================
+MeshOptimizeStats MeshOptimizer::Optimize(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizeOptions& options)
+{
+	MeshOptimizeStats stats{};
+	if (vertices.empty()) return stats;
+
+	if (indices.empty())
+	{
+		indices.resize(vertices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = static_cast<uint32_t>(i);
+	}
+	assert(indices.size() % 3 == 0);
+
+	stats.meshes = 1;
+	stats.triangles = indices.size() / 3;
+	stats.verticesBefore = vertices.size();
+	if (options.collectStats)
+		analyze(vertices, indices, options.overdraw, stats.transformedBefore, stats.pixelsCovered, stats.pixelsShadedBefore);
+
+	std::vector<uint32_t> remap(vertices.size());
+
+	if (options.removeDuplicates)
+	{
+		const size_t vertexCount = meshopt_generateVertexRemap(remap.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(MeshVertex));
+		meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+		meshopt_remapVertexBuffer(vertices.data(), vertices.data(), vertices.size(), sizeof(MeshVertex), remap.data());
+		vertices.resize(vertexCount);
+	}
+
+	if (options.vertexCache)
+		meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+
+	if (options.overdraw)
+		meshopt_optimizeOverdraw(indices.data(), indices.data(), indices.size(), &vertices[0].position.x, vertices.size(), sizeof(MeshVertex), options.overdrawThreshold);
+
+	if (options.vertexFetch)
+	{
+		const size_t vertexCount = meshopt_optimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertices.size());
+		meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+		meshopt_remapVertexBuffer(vertices.data(), vertices.data(), vertices.size(), sizeof(MeshVertex), remap.data());
+		vertices.resize(vertexCount);
+	}
+
+	stats.verticesAfter = vertices.size();
+	if (options.collectStats)
+	{
+		size_t covered = 0;
+		analyze(vertices, indices, options.overdraw, stats.transformedAfter, covered, stats.pixelsShadedAfter);
+	}
+
+	return stats;
+}
+//=============================================================================
+std::vector<MeshLod> MeshOptimizer::GenerateLods(std::span<const MeshVertex> vertices, std::vector<uint32_t>& indices, const MeshLodOptions& options)
+{
+	std::vector<MeshLod> lods;
+	if (vertices.empty() || indices.empty()) return lods;
+
+	const size_t baseCount = indices.size();
+	lods.push_back({ 0, static_cast<uint32_t>(baseCount), 0.0f });
+
+	const float* positions = &vertices[0].position.x;
+	const float scale = meshopt_simplifyScale(positions, vertices.size(), sizeof(MeshVertex));
+
+	std::vector<uint32_t> lod(baseCount);
+	size_t prevCount = baseCount;
+	for (uint32_t level = 1; level < options.levels; level++)
+	{
+		const size_t targetCount = static_cast<size_t>(float(prevCount) * options.reduction) / 3 * 3;
+		if (targetCount < 3) break;
+
+		// every level is simplified from the full mesh, it keeps the error of the chain smaller
+		float error = 0.0f;
+		const size_t count = meshopt_simplify(lod.data(), indices.data(), baseCount, positions, vertices.size(), sizeof(MeshVertex), targetCount, options.targetError, 0, &error);
+		if (count == 0 || float(count) > float(prevCount) * 0.9f)
+			break;
+
+		meshopt_optimizeVertexCache(lod.data(), lod.data(), count, vertices.size());
+
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(count), error * scale });
+		indices.insert(indices.end(), lod.begin(), lod.begin() + static_cast<ptrdiff_t>(count));
+		prevCount = count;
+	}
+
+	return lods;
+}
+//=============================================================================
+std::vector<Meshlet> MeshOptimizer::BuildMeshlets(std::span<const MeshVertex> vertices, std::span<uint32_t> indices, const MeshletOptions& options)
+{
+	std::vector<Meshlet> meshlets;
+	if (vertices.empty() || indices.size() / 3 < options.minTriangles) return meshlets;
+
+	const size_t maxVertices = std::clamp<size_t>(options.maxVertices, 3, 256);
+	const size_t maxTriangles = std::clamp<size_t>(options.maxTriangles, 1, 512);
+	const float* positions = &vertices[0].position.x;
+
+	std::vector<meshopt_Meshlet> clusters(meshopt_buildMeshletsBound(indices.size(), maxVertices, maxTriangles));
+	std::vector<unsigned> clusterVertices(indices.size());
+	std::vector<unsigned char> clusterTriangles(indices.size());
+	clusters.resize(meshopt_buildMeshlets(clusters.data(), clusterVertices.data(), clusterTriangles.data(), indices.data(), indices.size(), positions, vertices.size(), sizeof(MeshVertex), maxVertices, maxTriangles, options.coneWeight));
+
+	// the triangles stay the same, only their order changes
+	std::vector<uint32_t> reordered;
+	reordered.reserve(indices.size());
+	meshlets.reserve(clusters.size());
+	for (const meshopt_Meshlet& cluster : clusters)
+	{
+		unsigned* localVertices = &clusterVertices[cluster.vertex_offset];
+		unsigned char* localTriangles = &clusterTriangles[cluster.triangle_offset];
+		meshopt_optimizeMeshlet(localVertices, localTriangles, cluster.triangle_count, cluster.vertex_count);
+		const meshopt_Bounds bounds = meshopt_computeMeshletBounds(localVertices, localTriangles, cluster.triangle_count, positions, vertices.size(), sizeof(MeshVertex));
+
+		Meshlet& meshlet = meshlets.emplace_back();
+		meshlet.indexOffset = static_cast<uint32_t>(reordered.size());
+		meshlet.indexCount = cluster.triangle_count * 3;
+		meshlet.center = glm::vec3(bounds.center[0], bounds.center[1], bounds.center[2]);
+		meshlet.radius = bounds.radius;
+		meshlet.coneApex = glm::vec3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+		meshlet.coneAxis = glm::vec3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+		meshlet.coneCutoff = bounds.cone_cutoff;
+
+		for (size_t i = 0; i < size_t(cluster.triangle_count) * 3; i++)
+			reordered.push_back(localVertices[localTriangles[i]]);
+	}
+
+	assert(reordered.size() == indices.size());
+	std::copy(reordered.begin(), reordered.end(), indices.begin());
+	return meshlets;
+}
+//=============================================================================
+void MeshOptimizer::PrintStats(std::string_view name, const MeshOptimizeStats& stats)
+{
+	auto toStr = [](float v)
+		{
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%.3f", v);
+			return std::string(buf);
+		};
+
+	Info("Mesh optimize: " + std::string(name)
+		+ "\n\tmeshes: " + std::to_string(stats.meshes) + ", triangles: " + std::to_string(stats.triangles)
+		+ "\n\tvertices: " + std::to_string(stats.verticesBefore) + " -> " + std::to_string(stats.verticesAfter)
+		+ "\n\tACMR: " + toStr(stats.GetACMRBefore()) + " -> " + toStr(stats.GetACMRAfter())
+		+ "\n\tATVR: " + toStr(stats.GetATVRBefore()) + " -> " + toStr(stats.GetATVRAfter())
+		+ "\n\toverdraw: " + toStr(stats.GetOverdrawBefore()) + " -> " + toStr(stats.GetOverdrawAfter()));
+}
+//=============================================================================
\ No newline at end of file
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "NanoRenderMesh.h"
+
+struct MeshOptimizeOptions final
+{
+	bool  removeDuplicates{ true };   // merge identical vertices and drop unused ones
+	bool  vertexCache{ true };        // post-transform cache order of triangles
+	bool  overdraw{ true };           // cluster reorder for less overdraw, ACMR may grow up to overdrawThreshold
+	float overdrawThreshold{ 1.05f };
+	bool  vertexFetch{ true };        // vertex buffer in order of first use
+	bool  collectStats{ false };      // overdraw analysis rasterizes the mesh, only for debug
+};
+
+struct MeshLodOptions final
+{
+	uint32_t levels{ 4 };          // including the full mesh
+	float    reduction{ 0.5f };    // index count of a level relative to the previous one
+	float    targetError{ 0.05f }; // max error relative to the mesh extent
+};
+
+struct MeshletOptions final
+{
+	uint32_t maxVertices{ 128 };   // <= 256
+	uint32_t maxTriangles{ 256 };  // <= 512
+	float    coneWeight{ 0.25f };  // 0..1, higher - tighter normal cones, less uniform clusters
+	uint32_t minTriangles{ 4096 }; // smaller meshes are drawn whole
+};
+
+// Sums over one or more meshes, ACMR/ATVR/overdraw are computed from the sums
+struct MeshOptimizeStats final
+{
+	void Add(const MeshOptimizeStats& stats);
+
+	float GetACMRBefore() const { return triangles ? float(transformedBefore) / float(triangles) : 0.0f; }
+	float GetACMRAfter() const { return triangles ? float(transformedAfter) / float(triangles) : 0.0f; }
+	float GetATVRBefore() const { return verticesBefore ? float(transformedBefore) / float(verticesBefore) : 0.0f; }
+	float GetATVRAfter() const { return verticesAfter ? float(transformedAfter) / float(verticesAfter) : 0.0f; }
+	float GetOverdrawBefore() const { return pixelsCovered ? float(pixelsShadedBefore) / float(pixelsCovered) : 0.0f; }
+	float GetOverdrawAfter() const { return pixelsCovered ? float(pixelsShadedAfter) / float(pixelsCovered) : 0.0f; }
+
+	size_t meshes{ 0 };
+	size_t triangles{ 0 };
+	size_t verticesBefore{ 0 };
+	size_t verticesAfter{ 0 };
+	size_t transformedBefore{ 0 };
+	size_t transformedAfter{ 0 };
+	size_t pixelsCovered{ 0 };
+	size_t pixelsShadedBefore{ 0 };
+	size_t pixelsShadedAfter{ 0 };
+};
+
+namespace MeshOptimizer
+{
+	// Reorders (and with removeDuplicates shrinks) indexed triangle list in place. Non-indexed meshes are indexed first.
+	MeshOptimizeStats Optimize(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices, const MeshOptimizeOptions& options = {});
+
+	// Appends simplified index ranges to 'indices' and returns all levels, level 0 is the existing index range.
+	// Stops early when the simplifier cannot reduce the mesh further within targetError.
+	std::vector<MeshLod> GenerateLods(std::span<const MeshVertex> vertices, std::vector<uint32_t>& indices, const MeshLodOptions& options = {});
+
+	// Reorders the triangles of an index list (level 0, before GenerateLods) into meshlet order, every meshlet is one index range
+	std::vector<Meshlet> BuildMeshlets(std::span<const MeshVertex> vertices, std::span<uint32_t> indices, const MeshletOptions& options = {});
+
+	void PrintStats(std::string_view name, const MeshOptimizeStats& stats);
+} // namespace MeshOptimizer
\ No newline at end of file
@@ -1,10 +1,10 @@
 ﻿#include "stdafx.h"
 #include "NanoRenderModel.h"
+#include "NanoRenderModelCache.h"
 #include "NanoLog.h"
 #include "NanoIO.h"
+#include "NanoJobs.h"
 //=============================================================================
-bool Model::Load(const std::string& fileName, ModelMaterialType materialType)
-{
 #define ASSIMP_LOAD_FLAGS (aiProcess_JoinIdenticalVertices |    \
                            aiProcess_Triangulate |              \
                            aiProcess_GenSmoothNormals |         \
@@ -19,308 +19,949 @@ bool Model::Load(const std::string& fileName, ModelMaterialType materialType)
                            aiProcess_CalcTangentSpace |         \
                            aiProcess_SortByPType |              \
                            aiProcess_OptimizeMeshes)
+//=============================================================================
+struct MeshSourceView final
+{
+	size_t GetVertexCount() const noexcept { return vertexFormat == MeshVertexFormat::Packed ? packedVertices.size() : vertices.size(); }
+
+	MeshVertexFormat                  vertexFormat{ MeshVertexFormat::Full };
+	std::span<const MeshVertex>       vertices;
+	std::span<const MeshVertexPacked> packedVertices;
+	std::span<const uint32_t>         indices;
+	std::span<const MeshLod>          lods;
+	std::span<const Meshlet>          meshlets;
+	AABB                              aabb;
+	const MeshMaterialSource*         material{ nullptr };
+};
+//=============================================================================
+// CPU side of a model: cooked file mapping or Assimp scene + converted meshes
+struct ModelSourceData final
+{
+	void Release()
+	{
+		meshes.clear();
+		sources.clear();
+		cooked.Close();
+		scene = nullptr;
+		importer.reset();
+	}
 
-	Free();
+	modelcache::CookedModel           cooked;
+	std::unique_ptr<Assimp::Importer> importer;
+	const aiScene*                    scene{ nullptr }; // owned by importer, needed for embedded textures
+	std::vector<MeshSource>           sources;
+	std::vector<MeshSourceView>       meshes;
+};
+//=============================================================================
+struct ModelLoadState final
+{
+	std::string       name;
+	ModelMaterialType materialType{ ModelMaterialType::None };
+	ModelLoadInfo     loadInfo{};
+
+	// written by the decode job, read by the GL thread after 'decoded'
+	ModelSourceData   data;
+	bool              failed{ false };
+	std::atomic<bool> decoded{ false };
+	std::atomic<bool> cancelled{ false };
+
+	// GL thread upload progress
+	size_t                     currentMesh{ 0 };
+	size_t                     currentTexture{ 0 };
+	size_t                     uploadedVertices{ 0 };
+	size_t                     uploadedIndices{ 0 };
+	std::optional<Material>    material;
+	std::optional<PBRMaterial> pbrMaterial;
+	std::optional<Mesh>        mesh;
+	std::vector<Mesh>          meshes;
+	bool                       finished{ false };
+};
+//=============================================================================
+namespace
+{
+	struct ModelRegistryKey final
+	{
+		auto operator<=>(const ModelRegistryKey&) const = default;
 
-	m_materialType = materialType;
+		std::string       path;
+		ModelMaterialType materialType{ ModelMaterialType::None };
+		uint64_t          processFlags{ 0 };
+	};
 
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(fileName.c_str(), ASSIMP_LOAD_FLAGS);
-	if (!scene || !scene->HasMeshes() || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	size_t uploadBudget{ 4 * 1024 * 1024 };
+	std::vector<std::shared_ptr<ModelLoadState>> pendingLoads;
+	std::map<ModelRegistryKey, std::shared_ptr<ModelResource>> registry;
+	const std::vector<Mesh> emptyMeshes;
+	const AABB emptyAABB;
+
+	void processNode(const aiScene* scene, aiNode* node, std::vector<aiMesh*>& meshes)
 	{
-		Error("Not load mesh: " + fileName + "\n\tError: " + importer.GetErrorString());
-		return false;
+		for (unsigned i = 0; i < node->mNumMeshes; i++)
+		{
+			meshes.emplace_back(scene->mMeshes[node->mMeshes[i]]);
+		}
+
+		for (unsigned i = 0; i < node->mNumChildren; i++)
+		{
+			processNode(scene, node->mChildren[i], meshes);
+		}
 	}
 
-	m_name = fileName;
+	void addMaterialTextures(std::string_view directory, const aiScene* scene, aiMaterial* mat, aiTextureType type, ColorSpace colorSpace, MaterialTextureSlot slot, std::vector<MaterialTextureSource>& outTextures)
+	{
+		for (unsigned i{ 0 }; i < mat->GetTextureCount(type); ++i)
+		{
+			aiString path;
+			mat->GetTexture(type, i, &path);
+
+			size_t index = std::string(path.C_Str()).find_last_of("/");
+			std::string texName = std::string(path.C_Str()).substr(index + 1);
+
+			MaterialTextureSource texture;
+			texture.slot = slot;
+			texture.colorSpace = colorSpace;
+			if (texName.at(0) == '*' && index == std::string::npos)
+			{
+				texture.embeddedIndex = std::atoi(texName.c_str() + 1);
+				if (texture.embeddedIndex < 0 || texture.embeddedIndex >= static_cast<int>(scene->mNumTextures))
+				{
+					Warning("Invalid embedded texture: " + texName);
+					continue;
+				}
+				texture.path = texName;
+			}
+			else
+			{
+				texture.path = std::string(directory) + texName;
+			}
+
+			bool isFind{ false };
+			for (size_t j = 0; j < outTextures.size(); j++)
+			{
+				if (outTextures[j].slot == slot && outTextures[j].path == texture.path)
+				{
+					isFind = true;
+					break;
+				}
+			}
+			if (!isFind)
+				outTextures.emplace_back(std::move(texture));
+		}
+	}
 
-	std::string directory = io::GetFileDirectory(fileName);
-	processNode(scene, scene->mRootNode, directory);
+	void postProcessMesh(const ModelLoadInfo& loadInfo, MeshSource& mesh, MeshOptimizeStats& outStats)
+	{
+		if (loadInfo.optimize)
+			outStats = MeshOptimizer::Optimize(mesh.vertices, mesh.indices, loadInfo.optimizeOptions);
+		if (loadInfo.buildMeshlets)
+			mesh.meshlets = MeshOptimizer::BuildMeshlets(mesh.vertices, mesh.indices, loadInfo.meshletOptions);
+		if (loadInfo.generateLods)
+			mesh.lods = MeshOptimizer::GenerateLods(mesh.vertices, mesh.indices, loadInfo.lodOptions);
 
-	computeAABB();
+		mesh.aabb = ComputeMeshAABB(mesh.vertices, mesh.indices);
+
+		if (loadInfo.vertexFormat == MeshVertexFormat::Packed && CanPackMeshVertices(mesh.vertices))
+		{
+			mesh.packedVertices = PackMeshVertices(mesh.vertices, mesh.aabb);
+			mesh.vertexFormat = MeshVertexFormat::Packed;
+			std::vector<MeshVertex>().swap(mesh.vertices);
+		}
+	}
+
+	void processMesh(const aiScene* scene, const aiMesh* mesh, std::string_view directory, ModelMaterialType materialType, const ModelLoadInfo& loadInfo, MeshSource& outMesh, MeshOptimizeStats& outStats)
+	{
+		// Process vertices
+		std::vector<MeshVertex>& vertices = outMesh.vertices;
+		vertices.resize(mesh->mNumVertices);
+		for (unsigned i = 0; i < mesh->mNumVertices; i++)
+		{
+			MeshVertex& v = vertices[i];
+
+			v.position.x = mesh->mVertices[i].x;
+			v.position.y = mesh->mVertices[i].y;
+			v.position.z = mesh->mVertices[i].z;
+
+			if (mesh->HasVertexColors(0))
+			{
+				v.color.x = mesh->mColors[0][i].r;
+				v.color.y = mesh->mColors[0][i].g;
+				v.color.z = mesh->mColors[0][i].b;
+			}
+
+			if (mesh->HasNormals())
+			{
+				v.normal.x = mesh->mNormals[i].x;
+				v.normal.y = mesh->mNormals[i].y;
+				v.normal.z = mesh->mNormals[i].z;
+			}
+
+			if (mesh->HasTextureCoords(0))
+			{
+				v.texCoord.x = mesh->mTextureCoords[0][i].x;
+				v.texCoord.y = mesh->mTextureCoords[0][i].y;
+			}
+
+			if (mesh->HasTangentsAndBitangents())
+			{
+				v.tangent.x = mesh->mTangents[i].x;
+				v.tangent.y = mesh->mTangents[i].y;
+				v.tangent.z = mesh->mTangents[i].z;
+
+				v.bitangent.x = mesh->mBitangents[i].x;
+				v.bitangent.y = mesh->mBitangents[i].y;
+				v.bitangent.z = mesh->mBitangents[i].z;
+			}
+		}
+
+		// Process indices
+		std::vector<uint32_t>& indices = outMesh.indices;
+		indices.reserve(mesh->mNumFaces * 3);
+		for (size_t i = 0; i < mesh->mNumFaces; i++)
+		{
+			const aiFace& face = mesh->mFaces[i];
+
+			// Assume the model has only triangles.
+			indices.emplace_back(face.mIndices[0]);
+			indices.emplace_back(face.mIndices[1]);
+			indices.emplace_back(face.mIndices[2]);
+		}
+
+		postProcessMesh(loadInfo, outMesh, outStats);
+
+		// Process material
+		MeshMaterialSource& material = outMesh.material;
+		std::vector<MaterialTextureSource>& texs = material.textures;
+		auto countSlot = [&texs](MaterialTextureSlot slot)
+			{
+				return std::count_if(texs.begin(), texs.end(), [slot](const MaterialTextureSource& t) { return t.slot == slot; });
+			};
+
+		if (materialType == ModelMaterialType::BlinnPhong)
+		{
+			// TODO: по одной текстуре грузится, а тут есть возможность нескольих текстур
+			aiMaterial* mesh_material = scene->mMaterials[mesh->mMaterialIndex];
+
+			aiColor3D colorDiffuse;
+			mesh_material->Get(AI_MATKEY_COLOR_DIFFUSE, colorDiffuse);
+			aiColor3D colorSpecular;
+			mesh_material->Get(AI_MATKEY_COLOR_SPECULAR, colorSpecular);
+			aiColor3D colorAmbient;
+			mesh_material->Get(AI_MATKEY_COLOR_AMBIENT, colorAmbient);
+			float opacity{ 0.0f };
+			mesh_material->Get(AI_MATKEY_OPACITY, opacity);
+			float shininess{ 0.0f };
+			mesh_material->Get(AI_MATKEY_SHININESS, shininess);
+			float roughness{ 0.0f };
+			//mesh_material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, roughness);
+			float metallic{ 0.0f };
+			//mesh_material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, metallic);
+
+			material.params = Material();
+			material.params->diffuseColor = glm::vec3(colorDiffuse.r, colorDiffuse.g, colorDiffuse.b);
+			material.params->specularColor = glm::vec3(colorSpecular.r, colorSpecular.g, colorSpecular.b);
+			material.params->ambientColor = glm::vec3(colorAmbient.r, colorAmbient.g, colorAmbient.b);
+
+			material.params->opacity = opacity;
+			//material.shininess = shininess; // TODO: не работает
+			material.params->roughness = roughness;
+			material.params->metallic = metallic;
+
+			// DIFFUSE TEXTURES
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_DIFFUSE, ColorSpace::sRGB, MaterialTextureSlot::Diffuse, texs);
+			if (countSlot(MaterialTextureSlot::Diffuse) > 1)
+				Warning("More than one diffuse texture loaded. Engine does not support multiple diffuse textures");
+
+			// SPECULAR TEXTURES
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_SPECULAR, ColorSpace::Linear, MaterialTextureSlot::Specular, texs);
+			if (countSlot(MaterialTextureSlot::Specular) > 1)
+				Warning("More than one specular texture loaded. Engine does not support multiple specular textures");
+
+			// NORMAL TEXTURES
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_NORMALS, ColorSpace::Linear, MaterialTextureSlot::Normal, texs);
+			if (countSlot(MaterialTextureSlot::Normal) == 0)
+				addMaterialTextures(directory, scene, mesh_material, aiTextureType_HEIGHT, ColorSpace::Linear, MaterialTextureSlot::Normal, texs);
+			if (countSlot(MaterialTextureSlot::Normal) > 1)
+				Warning("More than one normal texture loaded. Engine does not support multiple normal textures");
+
+			// SHININESS TEXTURES
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_SHININESS, ColorSpace::Linear, MaterialTextureSlot::Shininess, texs);
+			if (countSlot(MaterialTextureSlot::Shininess) > 1)
+				Warning("More than one shininess texture loaded. Engine does not support multiple shininessMaps textures");
+
+			// EMISSIVE TEXTURES
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_EMISSIVE, ColorSpace::Linear, MaterialTextureSlot::Emission, texs);
+			if (countSlot(MaterialTextureSlot::Emission) > 1)
+				Warning("More than one emission texture loaded. Engine does not support multiple emissionMaps textures");
+
+			// OPACITY TEXTURES
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_OPACITY, ColorSpace::Linear, MaterialTextureSlot::Opacity, texs);
+			if (countSlot(MaterialTextureSlot::Opacity) > 1)
+				Warning("More than one opacity texture loaded. Engine does not support multiple opacityMaps textures");
+		}
+		else if (materialType == ModelMaterialType::PBR)
+		{
+			material.pbr = true;
+
+			aiMaterial* mesh_material = scene->mMaterials[mesh->mMaterialIndex];
+
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_BASE_COLOR, ColorSpace::sRGB, MaterialTextureSlot::Albedo, texs);
+			if (countSlot(MaterialTextureSlot::Albedo) == 0)
+				addMaterialTextures(directory, scene, mesh_material, aiTextureType_DIFFUSE, ColorSpace::sRGB, MaterialTextureSlot::Albedo, texs);
+
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_NORMALS, ColorSpace::Linear, MaterialTextureSlot::PBRNormal, texs);
+			if (countSlot(MaterialTextureSlot::PBRNormal) == 0)
+				addMaterialTextures(directory, scene, mesh_material, aiTextureType_HEIGHT, ColorSpace::Linear, MaterialTextureSlot::PBRNormal, texs);
+
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_METALNESS, ColorSpace::Linear, MaterialTextureSlot::MetallicRoughness, texs);
+
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_AMBIENT_OCCLUSION, ColorSpace::Linear, MaterialTextureSlot::AO, texs);
+			if (countSlot(MaterialTextureSlot::AO) == 0)
+				addMaterialTextures(directory, scene, mesh_material, aiTextureType_AMBIENT, ColorSpace::Linear, MaterialTextureSlot::AO, texs);
+			if (countSlot(MaterialTextureSlot::AO) == 0)
+				addMaterialTextures(directory, scene, mesh_material, aiTextureType_LIGHTMAP, ColorSpace::Linear, MaterialTextureSlot::AO, texs);
+
+			addMaterialTextures(directory, scene, mesh_material, aiTextureType_EMISSIVE, ColorSpace::sRGB, MaterialTextureSlot::Emissive, texs);
+		}
+	}
+
+	// selects the block compression of the cooked texture
+	TextureUsage getTextureUsage(MaterialTextureSlot slot)
+	{
+		switch (slot)
+		{
+		case MaterialTextureSlot::Normal:
+		case MaterialTextureSlot::PBRNormal: return TextureUsage::NormalMap;
+		case MaterialTextureSlot::Shininess:
+		case MaterialTextureSlot::Opacity:
+		case MaterialTextureSlot::AO:        return TextureUsage::Mask;
+		default:                             return TextureUsage::Color;
+		}
+	}
+
+	Texture2D loadTexture(const MaterialTextureSource& texture, const aiScene* scene, const std::string& modelName)
+	{
+		if (texture.embeddedIndex >= 0)
+		{
+			if (!scene) return {};
+			aiTexture* embTex = scene->mTextures[texture.embeddedIndex];
+			std::string name = modelName + " --- " + std::string(embTex->mFilename.C_Str()) + " --- " + texture.path;
+			return textures::CreateTextureFromData(name, embTex, texture.colorSpace, false);
+		}
+		return textures::LoadTexture2D(texture.path, texture.colorSpace, false, getTextureUsage(texture.slot));
+	}
+
+	void setMaterialTexture(MaterialTextureSlot slot, Texture2D texture, std::optional<Material>& material, std::optional<PBRMaterial>& pbrMaterial)
+	{
+		if (!IsValid(texture)) return;
+
+		if (material)
+		{
+			std::vector<Texture2D>* texs{ nullptr };
+			switch (slot)
+			{
+			case MaterialTextureSlot::Diffuse:   texs = &material->diffuseTextures; break;
+			case MaterialTextureSlot::Specular:  texs = &material->specularTextures; break;
+			case MaterialTextureSlot::Normal:    texs = &material->normalTextures; break;
+			case MaterialTextureSlot::Shininess: texs = &material->shininessTextures; break;
+			case MaterialTextureSlot::Emission:  texs = &material->emissionTextures; break;
+			case MaterialTextureSlot::Opacity:   texs = &material->opacityTextures; break;
+			default: break;
+			}
+			if (texs && std::find(texs->begin(), texs->end(), texture) == texs->end())
+				texs->push_back(texture);
+		}
+		if (pbrMaterial)
+		{
+			switch (slot)
+			{
+			case MaterialTextureSlot::Albedo:            if (!IsValid(pbrMaterial->albedoTexture)) pbrMaterial->albedoTexture = texture; break;
+			case MaterialTextureSlot::PBRNormal:         if (!IsValid(pbrMaterial->normalTexture)) pbrMaterial->normalTexture = texture; break;
+			case MaterialTextureSlot::MetallicRoughness: if (!IsValid(pbrMaterial->metallicRoughnessTexture)) pbrMaterial->metallicRoughnessTexture = texture; break;
+			case MaterialTextureSlot::AO:                if (!IsValid(pbrMaterial->AOTexture)) pbrMaterial->AOTexture = texture; break;
+			case MaterialTextureSlot::Emissive:          if (!IsValid(pbrMaterial->emissiveTexture)) pbrMaterial->emissiveTexture = texture; break;
+			default: break;
+			}
+		}
+	}
+
+	Mesh createMesh(const MeshSourceView& source, const aiScene* scene, const std::string& modelName)
+	{
+		std::optional<Material> material = source.material->params;
+		std::optional<PBRMaterial> pbrMaterial{};
+		if (source.material->pbr) pbrMaterial = PBRMaterial();
+
+		std::vector<Texture2D> loaded;
+		loaded.reserve(source.material->textures.size());
+		for (const MaterialTextureSource& texture : source.material->textures)
+		{
+			loaded.push_back(loadTexture(texture, scene, modelName));
+			setMaterialTexture(texture.slot, loaded.back(), material, pbrMaterial);
+		}
+
+		Mesh mesh = source.vertexFormat == MeshVertexFormat::Packed
+			? Mesh(source.packedVertices, source.indices, source.aabb, std::move(material), std::move(pbrMaterial))
+			: Mesh(source.vertices, source.indices, source.aabb, std::move(material), std::move(pbrMaterial));
+		// the material of the mesh holds the textures now
+		for (const Texture2D& texture : loaded)
+			textures::Release(texture);
+		mesh.SetLods(source.lods);
+		mesh.SetMeshlets(source.meshlets);
+		return mesh;
+	}
+
+	MeshOptimizeStats sumStats(std::span<const MeshOptimizeStats> stats)
+	{
+		MeshOptimizeStats sum{};
+		for (const MeshOptimizeStats& s : stats)
+			sum.Add(s);
+		return sum;
+	}
+
+	// CPU stage of loading, safe to call from a worker thread
+	bool decodeModel(const std::string& fileName, ModelMaterialType materialType, const ModelLoadInfo& loadInfo, ModelSourceData& data)
+	{
+		const std::string cachePath = modelcache::GetCachePath(fileName);
+		const modelcache::CookedModelKey cacheKey{ materialType, ASSIMP_LOAD_FLAGS, loadInfo.GetProcessFlags() };
+		if (io::IsNewerThan(cachePath, fileName) && data.cooked.Open(cachePath, cacheKey))
+		{
+			data.meshes.reserve(data.cooked.GetNumMeshes());
+			for (size_t i = 0; i < data.cooked.GetNumMeshes(); i++)
+			{
+				const modelcache::CookedMesh& mesh = data.cooked.GetMesh(i);
+				data.meshes.push_back({ mesh.vertexFormat, mesh.vertices, mesh.packedVertices, mesh.indices, mesh.lods, mesh.meshlets, mesh.aabb, &mesh.material });
+			}
+			Debug("Load cooked model: " + cachePath);
+			return true;
+		}
+
+		data.importer = std::make_unique<Assimp::Importer>();
+		data.scene = data.importer->ReadFile(fileName.c_str(), ASSIMP_LOAD_FLAGS);
+		if (!data.scene || !data.scene->HasMeshes() || data.scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !data.scene->mRootNode)
+		{
+			Error("Not load mesh: " + fileName + "\n\tError: " + data.importer->GetErrorString());
+			return false;
+		}
+
+		std::vector<aiMesh*> aiMeshes;
+		processNode(data.scene, data.scene->mRootNode, aiMeshes);
+
+		// the aiScene is only read, every job writes its own MeshSource
+		const std::string directory = io::GetFileDirectory(fileName);
+		data.sources.resize(aiMeshes.size());
+		std::vector<MeshOptimizeStats> stats(aiMeshes.size());
+		jobs::ParallelFor(aiMeshes.size(), [&](size_t i)
+			{
+				processMesh(data.scene, aiMeshes[i], directory, materialType, loadInfo, data.sources[i], stats[i]);
+			});
+		if (loadInfo.optimize && loadInfo.optimizeOptions.collectStats)
+			MeshOptimizer::PrintStats(fileName, sumStats(stats));
+
+		data.meshes.reserve(data.sources.size());
+		for (const MeshSource& source : data.sources)
+		{
+			data.meshes.push_back({ source.vertexFormat, source.vertices, source.packedVertices, source.indices, source.lods, source.meshlets, source.aabb, &source.material });
+		}
+
+		modelcache::Save(cachePath, cacheKey, data.sources);
+		return true;
+	}
+
+	void consumeBudget(size_t& budget, size_t size)
+	{
+		budget -= std::min(budget, size);
+	}
+
+	// Uploads the next part of a decoded model. Every step takes at least one texture, vertex or index so a small budget still makes progress
+	void uploadModel(ModelLoadState& state, size_t& budget)
+	{
+		const std::vector<MeshSourceView>& meshes = state.data.meshes;
+		while (budget > 0 && state.currentMesh < meshes.size())
+		{
+			const MeshSourceView& source = meshes[state.currentMesh];
+			if (source.GetVertexCount() == 0)
+			{
+				state.currentMesh++;
+				continue;
+			}
+
+			if (!state.mesh)
+			{
+				if (state.currentTexture == 0)
+				{
+					state.material = source.material->params;
+					state.pbrMaterial.reset();
+					if (source.material->pbr) state.pbrMaterial = PBRMaterial();
+				}
+				while (state.currentTexture < source.material->textures.size())
+				{
+					if (budget == 0) return;
+
+					const MaterialTextureSource& textureSource = source.material->textures[state.currentTexture];
+					Texture2D texture = loadTexture(textureSource, state.data.scene, state.name);
+					setMaterialTexture(textureSource.slot, texture, state.material, state.pbrMaterial);
+					// pixels are uploaded by textures::UpdateUploads() under its own budget
+					state.currentTexture++;
+				}
+				state.mesh.emplace(static_cast<uint32_t>(source.GetVertexCount()), static_cast<uint32_t>(source.indices.size()), source.aabb, std::move(state.material), std::move(state.pbrMaterial), source.vertexFormat);
+				state.mesh->SetLods(source.lods);
+				state.mesh->SetMeshlets(source.meshlets);
+			}
+
+			if (state.uploadedVertices < source.GetVertexCount())
+			{
+				const bool packed = source.vertexFormat == MeshVertexFormat::Packed;
+				const size_t vertexSize = packed ? sizeof(MeshVertexPacked) : sizeof(MeshVertex);
+				const size_t count = std::min(source.GetVertexCount() - state.uploadedVertices, std::max<size_t>(budget / vertexSize, 1));
+				if (packed)
+					state.mesh->SetVertexData(state.uploadedVertices, source.packedVertices.subspan(state.uploadedVertices, count));
+				else
+					state.mesh->SetVertexData(state.uploadedVertices, source.vertices.subspan(state.uploadedVertices, count));
+				state.uploadedVertices += count;
+				consumeBudget(budget, count * vertexSize);
+				continue;
+			}
+
+			if (state.uploadedIndices < source.indices.size())
+			{
+				const size_t count = std::min(source.indices.size() - state.uploadedIndices, std::max<size_t>(budget / sizeof(uint32_t), 1));
+				state.mesh->SetIndexData(state.uploadedIndices, source.indices.subspan(state.uploadedIndices, count));
+				state.uploadedIndices += count;
+				consumeBudget(budget, count * sizeof(uint32_t));
+				continue;
+			}
+
+			state.meshes.emplace_back(std::move(*state.mesh));
+			state.mesh.reset();
+			state.currentMesh++;
+			state.currentTexture = 0;
+			state.uploadedVertices = 0;
+			state.uploadedIndices = 0;
+		}
+	}
+
+	// GL objects of a dropped load are destroyed here so that they never die on a worker thread
+	void releaseLoadState(ModelLoadState& state)
+	{
+		state.cancelled = true;
+		state.mesh.reset();
+		state.meshes.clear();
+	}
+
+	void finishUpload(ModelLoadState& state)
+	{
+		if (!state.failed) Debug("Model uploaded: " + state.name);
+		state.data.Release();
+		state.finished = true;
+	}
+
+	// Load() of a file that is still in LoadAsync: the rest is done on this thread
+	void completeLoad(ModelLoadState& state)
+	{
+		if (state.finished) return;
+		while (!state.decoded.load(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		size_t budget = std::numeric_limits<size_t>::max();
+		if (!state.failed)
+			uploadModel(state, budget);
+		finishUpload(state);
+		std::erase_if(pendingLoads, [&](const std::shared_ptr<ModelLoadState>& load) { return load.get() == &state; });
+	}
+
+	ModelRegistryKey makeRegistryKey(const std::string& fileName, ModelMaterialType materialType, const ModelLoadInfo& loadInfo)
+	{
+		return { std::filesystem::path(fileName).lexically_normal().generic_string(), materialType, loadInfo.GetProcessFlags() };
+	}
+
+	void removeFromRegistry(const ModelResource* resource)
+	{
+		std::erase_if(registry, [&](const auto& entry) { return entry.second.get() == resource; });
+	}
+
+	void computeAABB(ModelResource& resource)
+	{
+		resource.aabb = AABB();
+		for (const Mesh& mesh : resource.meshes)
+		{
+			resource.aabb.CombineAABB(mesh.GetAABB());
+		}
+	}
+
+	size_t getTextureBytes(const ModelResource& resource)
+	{
+		std::set<GLuint> textures;
+		size_t bytes = 0;
+		auto add = [&](const Texture2D& texture)
+			{
+				if (texture.id.handle && textures.insert(texture.id.handle).second)
+					bytes += size_t(texture.width) * texture.height * 4;
+			};
+		for (const Mesh& mesh : resource.meshes)
+		{
+			if (const auto& material = mesh.GetMaterial())
+			{
+				for (const auto* list : { &material->diffuseTextures, &material->specularTextures, &material->normalTextures, &material->shininessTextures, &material->emissionTextures, &material->opacityTextures })
+				{
+					for (const Texture2D& texture : *list)
+						add(texture);
+				}
+			}
+			if (const auto& pbr = mesh.GetPbrMaterial())
+			{
+				add(pbr->albedoTexture);
+				add(pbr->normalTexture);
+				add(pbr->metallicRoughnessTexture);
+				add(pbr->AOTexture);
+				add(pbr->emissiveTexture);
+			}
+		}
+		return bytes;
+	}
+}
+//=============================================================================
+Model::~Model()
+{
+	Free();
+}
+//=============================================================================
+Model& Model::operator=(Model&& other) noexcept
+{
+	if (this != &other)
+	{
+		Free();
+		m_resource = std::move(other.m_resource);
+	}
+	return *this;
+}
+//=============================================================================
+uint64_t ModelLoadInfo::GetProcessFlags() const
+{
+	uint64_t flags = 0;
+	if (optimize)
+	{
+		flags |= 1u << 0;
+		if (optimizeOptions.removeDuplicates) flags |= 1u << 1;
+		if (optimizeOptions.vertexCache)      flags |= 1u << 2;
+		if (optimizeOptions.overdraw)         flags |= 1u << 3;
+		if (optimizeOptions.vertexFetch)      flags |= 1u << 4;
+		flags |= (static_cast<uint32_t>(optimizeOptions.overdrawThreshold * 100.0f) & 0xFFu) << 8;
+	}
+	if (generateLods)
+	{
+		// lod options are quantized, small changes keep the cache
+		flags |= 1u << 5;
+		flags |= (lodOptions.levels & 0xFu) << 16;
+		flags |= (static_cast<uint32_t>(lodOptions.reduction * 16.0f) & 0xFu) << 20;
+		flags |= (static_cast<uint32_t>(lodOptions.targetError * 256.0f) & 0xFFu) << 24;
+	}
+	if (vertexFormat == MeshVertexFormat::Packed)
+		flags |= 1u << 6;
+	if (buildMeshlets)
+	{
+		flags |= 1u << 7;
+		flags |= uint64_t((meshletOptions.maxVertices - 1) & 0xFFu) << 32;
+		flags |= uint64_t((meshletOptions.maxTriangles - 1) & 0x1FFu) << 40;
+		flags |= uint64_t(static_cast<uint32_t>(meshletOptions.coneWeight * 15.0f) & 0xFu) << 49;
+		flags |= uint64_t(std::min(meshletOptions.minTriangles / 64u, 0x7FFu)) << 53;
+	}
+	return flags;
+}
+//=============================================================================
+bool Model::Load(const std::string& fileName, ModelMaterialType materialType, const ModelLoadInfo& loadInfo)
+{
+	Free();
+
+	const ModelRegistryKey key = makeRegistryKey(fileName, materialType, loadInfo);
+	if (auto it = registry.find(key); it != registry.end())
+	{
+		m_resource = it->second;
+		if (m_resource->loadState)
+			completeLoad(*m_resource->loadState);
+		return IsReady();
+	}
+
+	ModelSourceData data;
+	if (!decodeModel(fileName, materialType, loadInfo, data))
+		return false;
+
+	auto resource = std::make_shared<ModelResource>();
+	resource->name = fileName;
+	resource->meshes.reserve(data.meshes.size());
+	for (const MeshSourceView& source : data.meshes)
+	{
+		if (source.GetVertexCount() == 0) continue;
+		resource->meshes.emplace_back(createMesh(source, data.scene, resource->name));
+	}
+	computeAABB(*resource);
+	if (resource->meshes.empty())
+		return false;
 
 	// TODO: центрировать модель, так как бывают не от центра
 
+	registry.emplace(key, resource);
+	m_resource = std::move(resource);
+	return true;
+}
+//=============================================================================
+bool Model::LoadAsync(const std::string& fileName, ModelMaterialType materialType, const ModelLoadInfo& loadInfo)
+{
+	Free();
+
+	const ModelRegistryKey key = makeRegistryKey(fileName, materialType, loadInfo);
+	if (auto it = registry.find(key); it != registry.end())
+	{
+		m_resource = it->second;
+		return true;
+	}
+
+	auto state = std::make_shared<ModelLoadState>();
+	state->name = fileName;
+	state->materialType = materialType;
+	state->loadInfo = loadInfo;
+	pendingLoads.push_back(state);
+
+	jobs::Submit([state]
+		{
+			if (!state->cancelled)
+				state->failed = !decodeModel(state->name, state->materialType, state->loadInfo, state->data);
+			state->decoded.store(true, std::memory_order_release);
+		});
+
+	m_resource = std::make_shared<ModelResource>();
+	m_resource->name = fileName;
+	m_resource->loadState = std::move(state);
+	registry.emplace(key, m_resource);
 	return true;
 }
 //=============================================================================
-void Model::Create(const MeshInfo& ci)
+bool Model::IsReady()
+{
+	if (m_resource && m_resource->loadState && m_resource->loadState->finished)
+	{
+		ModelResource& resource = *m_resource;
+		resource.meshes = std::move(resource.loadState->meshes);
+		resource.loadState.reset();
+		computeAABB(resource);
+		// failed loads are not cached, the next Load tries again
+		resource.failed = resource.meshes.empty();
+		if (resource.failed)
+			removeFromRegistry(&resource);
+	}
+	return m_resource && !m_resource->loadState && Valid();
+}
+//=============================================================================
+bool Model::IsFailed()
 {
+	IsReady();
+	return m_resource && m_resource->failed;
+}
+//=============================================================================
+void Model::Create(const MeshInfo& ci, const ModelLoadInfo& loadInfo)
+{
+	if (loadInfo.optimize || loadInfo.generateLods || loadInfo.buildMeshlets || loadInfo.vertexFormat != MeshVertexFormat::Full)
+	{
+		Create(std::vector<MeshInfo>{ ci }, loadInfo);
+		return;
+	}
+
 	Free();
+	m_resource = std::make_shared<ModelResource>();
 	Mesh mesh(ci.vertices, ci.indices, ci.material, ci.pbrMaterial);
-	m_meshes.emplace_back(std::move(mesh));
-	computeAABB();
+	m_resource->meshes.emplace_back(std::move(mesh));
+	computeAABB(*m_resource);
 
 	// TODO: центрировать модель, так как бывают не от центра
 }
 //=============================================================================
-void Model::Create(const std::vector<MeshInfo>& meshes)
+void Model::Create(const std::vector<MeshInfo>& meshes, const ModelLoadInfo& loadInfo)
 {
 	Free();
-	for (size_t i = 0; i < meshes.size(); i++)
+	m_resource = std::make_shared<ModelResource>();
+	std::vector<Mesh>& outMeshes = m_resource->meshes;
+
+	if (loadInfo.optimize || loadInfo.generateLods || loadInfo.buildMeshlets || loadInfo.vertexFormat != MeshVertexFormat::Full)
 	{
-		if (meshes[i].vertices.empty()) continue;
+		std::vector<MeshSource> sources(meshes.size());
+		std::vector<MeshOptimizeStats> stats(meshes.size());
+		jobs::ParallelFor(meshes.size(), [&](size_t i)
+			{
+				if (meshes[i].vertices.empty()) return;
+				sources[i].vertices = meshes[i].vertices;
+				sources[i].indices = meshes[i].indices;
+				postProcessMesh(loadInfo, sources[i], stats[i]);
+			});
+		if (loadInfo.optimize && loadInfo.optimizeOptions.collectStats)
+			MeshOptimizer::PrintStats("generated model", sumStats(stats));
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			const MeshSource& source = sources[i];
+			if (source.GetVertexCount() == 0) continue;
+
+			if (source.vertexFormat == MeshVertexFormat::Packed)
+				outMeshes.emplace_back(Mesh(source.packedVertices, source.indices, source.aabb, meshes[i].material, meshes[i].pbrMaterial));
+			else
+				outMeshes.emplace_back(Mesh(source.vertices, source.indices, source.aabb, meshes[i].material, meshes[i].pbrMaterial));
+			outMeshes.back().SetLods(source.lods);
+			outMeshes.back().SetMeshlets(source.meshlets);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i].vertices.empty()) continue;
 
-		m_meshes.emplace_back(Mesh(meshes[i].vertices, meshes[i].indices, meshes[i].material, meshes[i].pbrMaterial));
+			outMeshes.emplace_back(Mesh(meshes[i].vertices, meshes[i].indices, meshes[i].material, meshes[i].pbrMaterial));
+		}
 	}
-	computeAABB();
+	computeAABB(*m_resource);
 
 	// TODO: центрировать модель, так как бывают не от центра
 }
 //=============================================================================
 void Model::Free()
 {
-	m_meshes.clear();
+	// the registry holds one reference, the other one is this Model
+	if (m_resource && m_resource.use_count() == 2)
+	{
+		const auto it = std::find_if(registry.begin(), registry.end(), [&](const auto& entry) { return entry.second == m_resource; });
+		if (it != registry.end())
+		{
+			// nobody waits for it, the upload queue drops the load on the next update
+			if (m_resource->loadState) m_resource->loadState->cancelled = true;
+			registry.erase(it);
+		}
+	}
+	m_resource.reset();
+}
+//=============================================================================
+const std::vector<Mesh>& Model::GetMeshes() const noexcept
+{
+	return m_resource ? m_resource->meshes : emptyMeshes;
+}
+//=============================================================================
+const AABB& Model::GetAABB() const noexcept
+{
+	return m_resource ? m_resource->aabb : emptyAABB;
 }
 //=============================================================================
 void Model::DrawSubMesh(size_t id, GLenum mode)
 {
-	if (id < m_meshes.size())
-		m_meshes[id].tDraw(mode);
+	if (m_resource && id < m_resource->meshes.size())
+		m_resource->meshes[id].tDraw(mode);
 }
 //=============================================================================
 void Model::tDraw(GLenum mode)
 {
-	for (size_t i = 0; i < m_meshes.size(); i++)
+	if (!m_resource) return;
+	for (Mesh& mesh : m_resource->meshes)
 	{
-		m_meshes[i].tDraw(mode);
+		mesh.tDraw(mode);
 	}
 }
 //=============================================================================
 void Model::tDraw(const ModelDrawInfo& drawInfo)
 {
-	for (size_t i = 0; i < m_meshes.size(); i++)
+	if (!m_resource) return;
+	for (Mesh& mesh : m_resource->meshes)
 	{
-		m_meshes[i].tDraw(drawInfo.mode, drawInfo.shaderProgram, drawInfo.bindMaterials);
+		mesh.tDraw(drawInfo.mode, drawInfo.shaderProgram, drawInfo.bindMaterials);
 	}
 }
 //=============================================================================
-void Model::processNode(const aiScene* scene, aiNode* node, std::string_view directory)
+void models::SetUploadBudget(size_t bytesPerFrame)
 {
-	for (unsigned i = 0; i < node->mNumMeshes; i++)
-	{
-		aiMesh* aimesh = scene->mMeshes[node->mMeshes[i]];
-		m_meshes.emplace_back(processMesh(scene, aimesh, directory));
-	}
-
-	for (unsigned i = 0; i < node->mNumChildren; i++)
-	{
-		processNode(scene, node->mChildren[i], directory);
-	}
+	uploadBudget = bytesPerFrame;
+}
+//=============================================================================
+size_t models::GetUploadBudget()
+{
+	return uploadBudget;
 }
 //=============================================================================
-Mesh Model::processMesh(const aiScene* scene, struct aiMesh* mesh, std::string_view directory)
+void models::UpdateUploads()
 {
-	// Process vertices
-	std::vector<MeshVertex> vertices(mesh->mNumVertices);
-	for (unsigned i = 0; i < mesh->mNumVertices; i++)
+	size_t budget = uploadBudget;
+	for (size_t i = 0; i < pendingLoads.size();)
 	{
-		MeshVertex& v = vertices[i];
-
-		v.position.x = mesh->mVertices[i].x;
-		v.position.y = mesh->mVertices[i].y;
-		v.position.z = mesh->mVertices[i].z;
-
-		if (mesh->HasVertexColors(0))
+		ModelLoadState& state = *pendingLoads[i];
+		if (state.cancelled)
 		{
-			v.color.x = mesh->mColors[0][i].r;
-			v.color.y = mesh->mColors[0][i].g;
-			v.color.z = mesh->mColors[0][i].b;
+			releaseLoadState(state);
+			pendingLoads.erase(pendingLoads.begin() + static_cast<ptrdiff_t>(i));
+			continue;
 		}
-
-		if (mesh->HasNormals())
+		if (!state.decoded.load(std::memory_order_acquire) || budget == 0)
 		{
-			v.normal.x = mesh->mNormals[i].x;
-			v.normal.y = mesh->mNormals[i].y;
-			v.normal.z = mesh->mNormals[i].z;
+			i++;
+			continue;
 		}
 
-		if (mesh->HasTextureCoords(0))
-		{
-			v.texCoord.x = mesh->mTextureCoords[0][i].x;
-			v.texCoord.y = mesh->mTextureCoords[0][i].y;
-		}
+		if (!state.failed)
+			uploadModel(state, budget);
 
-		if (mesh->HasTangentsAndBitangents())
+		if (state.failed || state.currentMesh == state.data.meshes.size())
 		{
-			v.tangent.x = mesh->mTangents[i].x;
-			v.tangent.y = mesh->mTangents[i].y;
-			v.tangent.z = mesh->mTangents[i].z;
-
-			v.bitangent.x = mesh->mBitangents[i].x;
-			v.bitangent.y = mesh->mBitangents[i].y;
-			v.bitangent.z = mesh->mBitangents[i].z;
+			finishUpload(state);
+			pendingLoads.erase(pendingLoads.begin() + static_cast<ptrdiff_t>(i));
+			continue;
 		}
+		i++;
 	}
-
-	// Process indices
-	std::vector<uint32_t> indices;
-	indices.reserve(mesh->mNumFaces * 3);
-	for (size_t i = 0; i < mesh->mNumFaces; i++)
-	{
-		const aiFace& face = mesh->mFaces[i];
-
-		// Assume the model has only triangles.
-		indices.emplace_back(face.mIndices[0]);
-		indices.emplace_back(face.mIndices[1]);
-		indices.emplace_back(face.mIndices[2]);
-	}
-
-	// Process material
-	std::optional<Material> material{};
-	std::optional<PBRMaterial> pbrMaterial{};
-
-	if (m_materialType == ModelMaterialType::BlinnPhong)
-	{
-		// TODO: по одной текстуре грузится, а тут есть возможность нескольих текстур
-		aiMaterial* mesh_material = scene->mMaterials[mesh->mMaterialIndex];
-
-		aiColor3D colorDiffuse;
-		mesh_material->Get(AI_MATKEY_COLOR_DIFFUSE, colorDiffuse);
-		aiColor3D colorSpecular;
-		mesh_material->Get(AI_MATKEY_COLOR_SPECULAR, colorSpecular);
-		aiColor3D colorAmbient;
-		mesh_material->Get(AI_MATKEY_COLOR_AMBIENT, colorAmbient);
-		float opacity{ 0.0f };
-		mesh_material->Get(AI_MATKEY_OPACITY, opacity);
-		float shininess{ 0.0f };
-		mesh_material->Get(AI_MATKEY_SHININESS, shininess);
-		float roughness{ 0.0f };
-		//mesh_material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_ROUGHNESS_FACTOR, roughness);
-		float metallic{ 0.0f };
-		//mesh_material->Get(AI_MATKEY_GLTF_PBRMETALLICROUGHNESS_METALLIC_FACTOR, metallic);
-
-		material = Material();
-		material->diffuseColor = glm::vec3(colorDiffuse.r, colorDiffuse.g, colorDiffuse.b);
-		material->specularColor = glm::vec3(colorSpecular.r, colorSpecular.g, colorSpecular.b);
-		material->ambientColor = glm::vec3(colorAmbient.r, colorAmbient.g, colorAmbient.b);
-
-		material->opacity = opacity;
-		//material.shininess = shininess; // TODO: не работает
-		material->roughness = roughness;
-		material->metallic = metallic;
-
-		// DIFFUSE TEXTURES
-		material->diffuseTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_DIFFUSE, ColorSpace::sRGB);
-		if (material->diffuseTextures.size() > 1)
-			Warning("More than one diffuse texture loaded. Engine does not support multiple diffuse textures");
-
-		// SPECULAR TEXTURES
-		material->specularTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_SPECULAR, ColorSpace::Linear);
-		if (material->specularTextures.size() > 1)
-			Warning("More than one specular texture loaded. Engine does not support multiple specular textures");
-
-		// NORMAL TEXTURES
-		material->normalTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_NORMALS, ColorSpace::Linear);
-		if (material->normalTextures.empty())
-			material->normalTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_HEIGHT, ColorSpace::Linear);
-		if (material->normalTextures.size() > 1)
-			Warning("More than one normal texture loaded. Engine does not support multiple normal textures");
-
-		// SHININESS TEXTURES
-		material->shininessTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_SHININESS, ColorSpace::Linear);
-		if (material->shininessTextures.size() > 1)
-			Warning("More than one shininess texture loaded. Engine does not support multiple shininessMaps textures");
-
-		// EMISSIVE TEXTURES
-		material->emissionTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_EMISSIVE, ColorSpace::Linear);
-		if (material->emissionTextures.size() > 1)
-			Warning("More than one emission texture loaded. Engine does not support multiple emissionMaps textures");
-
-		// OPACITY TEXTURES
-		material->opacityTextures = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_OPACITY, ColorSpace::Linear);
-		if (material->opacityTextures.size() > 1)
-			Warning("More than one opacity texture loaded. Engine does not support multiple opacityMaps textures");
-	}
-	else if (m_materialType == ModelMaterialType::PBR)
-	{
-		pbrMaterial = PBRMaterial();
-
-		aiMaterial* mesh_material = scene->mMaterials[mesh->mMaterialIndex];
-
-		std::vector<Texture2D> albedoMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_BASE_COLOR, ColorSpace::sRGB);
-		if (albedoMap.empty())
-		{
-			albedoMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_DIFFUSE, ColorSpace::sRGB);
-		}
-
-		std::vector<Texture2D> normalMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_NORMALS, ColorSpace::Linear);
-		if (normalMap.empty())
-		{
-			normalMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_HEIGHT, ColorSpace::Linear);
-		}
-
-		std::vector<Texture2D> metallicRoughnessMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_METALNESS, ColorSpace::Linear);
-
-		std::vector<Texture2D> aoMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_AMBIENT_OCCLUSION, ColorSpace::Linear);
-		if (aoMap.empty())
+}
+//=============================================================================
+size_t models::EvictUnused()
+{
+	return std::erase_if(registry, [](const auto& entry)
 		{
-			aoMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_AMBIENT, ColorSpace::Linear);
-		}
-		if (aoMap.empty())
+			if (entry.second.use_count() > 1) return false;
+			// nobody waits for it, the upload queue drops the load on the next update
+			if (entry.second->loadState) entry.second->loadState->cancelled = true;
+			return true;
+		});
+}
+//=============================================================================
+size_t models::Evict(const std::string& fileName)
+{
+	const std::string path = std::filesystem::path(fileName).lexically_normal().generic_string();
+	return std::erase_if(registry, [&](const auto& entry)
 		{
-			aoMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_LIGHTMAP, ColorSpace::Linear);
-		}
-
-		std::vector<Texture2D> emissiveMap = loadMaterialTextures(directory, scene, mesh_material, aiTextureType_EMISSIVE, ColorSpace::sRGB);
-
-		if (!albedoMap.empty())            pbrMaterial->albedoTexture = albedoMap[0];
-		if (!normalMap.empty())            pbrMaterial->normalTexture = normalMap[0];
-		if (!metallicRoughnessMap.empty()) pbrMaterial->metallicRoughnessTexture = metallicRoughnessMap[0];
-		if (!aoMap.empty())                pbrMaterial->AOTexture = aoMap[0];
-		if (!emissiveMap.empty())          pbrMaterial->emissiveTexture = emissiveMap[0];
-	}
-
-	return Mesh(vertices, indices, material, pbrMaterial);
+			if (entry.first.path != path) return false;
+			if (entry.second.use_count() == 1 && entry.second->loadState) entry.second->loadState->cancelled = true;
+			return true;
+		});
 }
 //=============================================================================
-std::vector<Texture2D> Model::loadMaterialTextures(std::string_view directory, const aiScene* scene, aiMaterial* mat, aiTextureType type, ColorSpace colorSpace)
+std::vector<ModelCacheStats> models::GetCacheStats()
 {
-	std::vector<Texture2D> texs;
-
-	for (unsigned i{ 0 }; i < mat->GetTextureCount(type); ++i)
+	std::vector<ModelCacheStats> stats;
+	stats.reserve(registry.size());
+	for (const auto& [key, resource] : registry)
 	{
-		aiString path;
-		mat->GetTexture(type, i, &path);
-
-		size_t index = std::string(path.C_Str()).find_last_of("/");
-		std::string texName = std::string(path.C_Str()).substr(index + 1);
-
-		Texture2D texture;
-		if (texName.at(0) == '*' && index == std::string::npos)
+		ModelCacheStats& entry = stats.emplace_back();
+		entry.name = resource->name;
+		entry.materialType = key.materialType;
+		entry.users = resource.use_count() - 1;
+		entry.loading = resource->loadState != nullptr;
+		entry.meshCount = resource->meshes.size();
+		for (const Mesh& mesh : resource->meshes)
 		{
-			int embedded{ static_cast<int>(texName.at(1) - '0') };
-			aiTexture* embTex = scene->mTextures[embedded];
-			//aiTexel* texData = embTex->pcData;
-			std::string name = m_name + " --- " + std::string(embTex->mFilename.C_Str()) + " --- " + texName;
-			texture = textures::CreateTextureFromData(name, embTex, colorSpace, false);
+			entry.vertexBytes += size_t(mesh.GetVertexCount()) * GetVertexSize(mesh.GetVertexFormat());
+			entry.indexBytes += size_t(mesh.GetIndexCount()) * sizeof(uint32_t);
 		}
-		else
-		{
-			std::string texPath = std::string(directory) + texName;
-			texture = textures::LoadTexture2D(texPath, colorSpace);
-		}
-		bool isFind{ false };
-		for (size_t j = 0; j < texs.size(); j++)
-		{
-			if (texs[j] == texture)
-			{
-				isFind = true;
-				break;
-			}
-		}
-		if (!isFind)
-			texs.push_back(texture);
+		entry.textureBytes = getTextureBytes(*resource);
 	}
-
-	return texs;
+	return stats;
 }
 //=============================================================================
-void Model::computeAABB()
+void models::Close()
 {
-	for (size_t i = 0; i < m_meshes.size(); i++)
+	registry.clear();
+	for (auto& state : pendingLoads)
 	{
-		m_aabb.CombineAABB(m_meshes[i].GetAABB());
+		releaseLoadState(*state);
 	}
+	pendingLoads.clear();
 }
 //=============================================================================
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "NanoRenderMesh.h"
+#include "NanoRenderMeshOptimizer.h"
 
 struct ModelDrawInfo final
 {
@@ -16,34 +17,146 @@ enum class ModelMaterialType : uint8_t
 	PBR
 };
 
+struct ModelLoadInfo final
+{
+	// bits stored in cooked files, changing options rebuilds the cache
+	uint64_t GetProcessFlags() const;
+
+	bool                optimize{ false };
+	MeshOptimizeOptions optimizeOptions{};
+	bool                generateLods{ false };
+	MeshLodOptions      lodOptions{};
+	bool                buildMeshlets{ false }; // clusters of level 0 for Mesh::DrawCulled()
+	MeshletOptions      meshletOptions{};
+	// Packed is used for every mesh that passes CanPackMeshVertices(), the rest stay Full
+	MeshVertexFormat    vertexFormat{ MeshVertexFormat::Full };
+};
+
+// Texture reference of a mesh material, resolved to Texture2D on the render thread
+enum class MaterialTextureSlot : uint8_t
+{
+	// BlinnPhong
+	Diffuse,
+	Specular,
+	Normal,
+	Shininess,
+	Emission,
+	Opacity,
+	// PBR
+	Albedo,
+	PBRNormal,
+	MetallicRoughness,
+	AO,
+	Emissive
+};
+
+struct MaterialTextureSource final
+{
+	MaterialTextureSlot slot{ MaterialTextureSlot::Diffuse };
+	ColorSpace          colorSpace{ ColorSpace::Linear };
+	int                 embeddedIndex{ -1 }; // index in aiScene::mTextures or -1
+	std::string         path;                // file path or embedded texture name
+};
+
+struct MeshMaterialSource final
+{
+	std::optional<Material>            params{};  // BlinnPhong parameters without textures
+	bool                               pbr{ false };
+	std::vector<MaterialTextureSource> textures;
+};
+
+// Result of the CPU stage of mesh loading (no GL calls)
+struct MeshSource final
+{
+	size_t GetVertexCount() const noexcept { return vertexFormat == MeshVertexFormat::Packed ? packedVertices.size() : vertices.size(); }
+
+	MeshVertexFormat              vertexFormat{ MeshVertexFormat::Full };
+	std::vector<MeshVertex>       vertices;       // Full
+	std::vector<MeshVertexPacked> packedVertices; // Packed, quantized inside aabb
+	std::vector<uint32_t>         indices;        // all levels of detail
+	std::vector<MeshLod>          lods;           // empty - single level
+	std::vector<Meshlet>          meshlets;       // empty - drawn whole
+	AABB                          aabb;
+	MeshMaterialSource            material;
+};
+
+struct ModelLoadState;
+
+// GPU data of a model. Load/LoadAsync share one resource between every Model of the same file and options
+struct ModelResource final
+{
+	std::vector<Mesh>               meshes;
+	AABB                            aabb;
+	std::string                     name;
+	std::shared_ptr<ModelLoadState> loadState; // LoadAsync in progress
+	bool                            failed{ false }; // LoadAsync finished without meshes
+};
+
+struct ModelCacheStats final
+{
+	std::string       name;
+	ModelMaterialType materialType{ ModelMaterialType::None };
+	long              users{ 0 }; // Models holding the entry
+	bool              loading{ false };
+	size_t            meshCount{ 0 };
+	size_t            vertexBytes{ 0 };
+	size_t            indexBytes{ 0 };
+	size_t            textureBytes{ 0 }; // approximate (RGBA8 without mips), textures are also shared between entries
+};
+
 class Model final
 {
 public:
-	bool Load(const std::string& fileName, ModelMaterialType materialType);
-	void Create(const MeshInfo& meshCreateInfo);
-	void Create(const std::vector<MeshInfo>& meshes);
+	Model() = default;
+	Model(Model&&) noexcept = default;
+	Model& operator=(Model&& other) noexcept;
+	~Model();
 
+	// Load and LoadAsync take the model from the cache when it was already loaded with the same material type and options
+	bool Load(const std::string& fileName, ModelMaterialType materialType, const ModelLoadInfo& loadInfo = {});
+	// Returns at once: decoding runs on the job system, GPU upload in models::UpdateUploads() under the frame budget
+	bool LoadAsync(const std::string& fileName, ModelMaterialType materialType, const ModelLoadInfo& loadInfo = {});
+	// created models are not cached
+	void Create(const MeshInfo& meshCreateInfo, const ModelLoadInfo& loadInfo = {});
+	void Create(const std::vector<MeshInfo>& meshes, const ModelLoadInfo& loadInfo = {});
+
+	// the last Model of a cached entry drops it, the meshes and their texture references are released at once
 	void Free();
 
 	void DrawSubMesh(size_t id, GLenum mode = GL_TRIANGLES);
 	void tDraw(GLenum mode = GL_TRIANGLES);
 	void tDraw(const ModelDrawInfo& drawInfo);
 
-	size_t GetNumMeshes() const noexcept { return m_meshes.size(); }
-	const std::vector<Mesh>& GetMeshes() const noexcept { return m_meshes; }
-	const Mesh& GetMesh(size_t id) const noexcept { return m_meshes[id]; }
-	const AABB& GetAABB() const noexcept { return m_aabb; }
+	size_t GetNumMeshes() const noexcept { return GetMeshes().size(); }
+	const std::vector<Mesh>& GetMeshes() const noexcept;
+	const Mesh& GetMesh(size_t id) const noexcept { return GetMeshes()[id]; }
+	const AABB& GetAABB() const noexcept;
 
-	bool Valid() const noexcept { return !m_meshes.empty(); }
+	bool Valid() const noexcept { return !GetMeshes().empty(); }
+	// Takes the meshes of a finished LoadAsync. false while the model is still loading
+	bool IsReady();
+	bool IsLoading() const noexcept { return m_resource && m_resource->loadState != nullptr; }
+	// LoadAsync finished with an error or without meshes, IsReady() stays false. The next load reads the file again
+	bool IsFailed();
 
 private:
-	void processNode(const aiScene* scene, aiNode* node, std::string_view directory);
-	Mesh processMesh(const aiScene* scene, struct aiMesh* mesh, std::string_view directory);
-	std::vector<Texture2D> loadMaterialTextures(std::string_view directory, const aiScene* scene, aiMaterial* mat, aiTextureType type, ColorSpace colorSpace);
-	void computeAABB();
-
-	std::vector<Mesh> m_meshes;
-	ModelMaterialType m_materialType;
-	AABB              m_aabb;
-	std::string       m_name;
-};
\ No newline at end of file
+	std::shared_ptr<ModelResource> m_resource;
+};
+
+namespace models
+{
+	void SetUploadBudget(size_t bytesPerFrame);
+	size_t GetUploadBudget();
+
+	// GL thread, called every frame by the engine
+	void UpdateUploads();
+
+	// Drops the entries no Model holds, Model::Free already drops an entry with its last Model. Returns the number of
+	// dropped entries
+	size_t EvictUnused();
+	// Models that hold the entry keep their meshes, the next Load reads the file again
+	size_t Evict(const std::string& fileName);
+	std::vector<ModelCacheStats> GetCacheStats();
+
+	void Close();
+} // namespace models
\ No newline at end of file
@@ -0,0 +1,338 @@
+﻿#include "stdafx.h"
+#include "NanoRenderModelCache.h"
+#include "NanoLog.h"
+//=============================================================================
+namespace
+{
+#pragma pack(push, 1)
+	struct CookedHeader final
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexSize;
+		uint32_t importFlags;
+		uint64_t processFlags;
+		uint32_t materialType;
+		uint32_t meshCount;
+	};
+
+	struct CookedMeshHeader final
+	{
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		float    aabbMin[3];
+		float    aabbMax[3];
+		uint8_t  hasParams;
+		uint8_t  pbr;
+		uint16_t textureCount;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint8_t  vertexFormat;
+		uint8_t  reserved[3];
+	};
+
+	struct CookedMaterialParams final
+	{
+		float    opacity;
+		float    diffuseColor[3];
+		float    specularColor[3];
+		float    ambientColor[3];
+		float    shininess;
+		float    roughness;
+		float    metallic;
+		uint32_t noLighing;
+	};
+
+	struct CookedTexture final
+	{
+		uint8_t  slot;
+		uint8_t  colorSpace;
+		uint16_t pathLength;
+	};
+#pragma pack(pop)
+
+	// vertex/index data is aligned to 4 bytes inside the file
+	constexpr size_t alignSize(size_t size) { return (size + 3u) & ~size_t(3u); }
+
+	class CookedReader final
+	{
+	public:
+		CookedReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		template<typename T>
+		bool Read(T& out)
+		{
+			if (m_offset + sizeof(T) > m_size) return false;
+			std::memcpy(&out, m_data + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return true;
+		}
+
+		const uint8_t* Skip(size_t size)
+		{
+			if (m_offset + size > m_size) return nullptr;
+			const uint8_t* ptr = m_data + m_offset;
+			m_offset += size;
+			return ptr;
+		}
+
+		bool Align() { return Skip(alignSize(m_offset) - m_offset) != nullptr; }
+
+	private:
+		const uint8_t* m_data{ nullptr };
+		size_t         m_size{ 0 };
+		size_t         m_offset{ 0 };
+	};
+
+	void writePadding(std::ofstream& file)
+	{
+		const size_t offset = static_cast<size_t>(file.tellp());
+		const char zeros[4]{};
+		file.write(zeros, static_cast<std::streamsize>(alignSize(offset) - offset));
+	}
+
+	bool readMesh(CookedReader& reader, modelcache::CookedMesh& mesh)
+	{
+		CookedMeshHeader meshHeader{};
+		if (!reader.Read(meshHeader))
+			return false;
+
+		mesh.aabb.min = glm::vec3(meshHeader.aabbMin[0], meshHeader.aabbMin[1], meshHeader.aabbMin[2]);
+		mesh.aabb.max = glm::vec3(meshHeader.aabbMax[0], meshHeader.aabbMax[1], meshHeader.aabbMax[2]);
+		mesh.material.pbr = meshHeader.pbr != 0;
+
+		if (meshHeader.hasParams)
+		{
+			CookedMaterialParams params{};
+			if (!reader.Read(params))
+				return false;
+
+			Material& m = mesh.material.params.emplace();
+			m.opacity = params.opacity;
+			std::memcpy(&m.diffuseColor, params.diffuseColor, sizeof(params.diffuseColor));
+			std::memcpy(&m.specularColor, params.specularColor, sizeof(params.specularColor));
+			std::memcpy(&m.ambientColor, params.ambientColor, sizeof(params.ambientColor));
+			m.shininess = params.shininess;
+			m.roughness = params.roughness;
+			m.metallic  = params.metallic;
+			m.noLighing = params.noLighing != 0;
+		}
+
+		mesh.material.textures.resize(meshHeader.textureCount);
+		for (MaterialTextureSource& texture : mesh.material.textures)
+		{
+			CookedTexture cookedTexture{};
+			if (!reader.Read(cookedTexture))
+				return false;
+			const uint8_t* path = reader.Skip(cookedTexture.pathLength);
+			if (!path)
+				return false;
+
+			texture.slot       = static_cast<MaterialTextureSlot>(cookedTexture.slot);
+			texture.colorSpace = static_cast<ColorSpace>(cookedTexture.colorSpace);
+			texture.path.assign(reinterpret_cast<const char*>(path), cookedTexture.pathLength);
+		}
+		if (!reader.Align())
+			return false;
+
+		const uint8_t* lods = reader.Skip(size_t(meshHeader.lodCount) * sizeof(MeshLod));
+		if (!lods)
+			return false;
+		const uint8_t* meshlets = reader.Skip(size_t(meshHeader.meshletCount) * sizeof(Meshlet));
+		if (!meshlets)
+			return false;
+		if (meshHeader.vertexFormat > static_cast<uint8_t>(MeshVertexFormat::Packed))
+			return false;
+		mesh.vertexFormat = static_cast<MeshVertexFormat>(meshHeader.vertexFormat);
+		const size_t vertexSize = mesh.vertexFormat == MeshVertexFormat::Packed ? sizeof(MeshVertexPacked) : sizeof(MeshVertex);
+		const uint8_t* vertices = reader.Skip(size_t(meshHeader.vertexCount) * vertexSize);
+		if (!vertices)
+			return false;
+		const uint8_t* indices = reader.Skip(size_t(meshHeader.indexCount) * sizeof(uint32_t));
+		if (!indices)
+			return false;
+
+		if (mesh.vertexFormat == MeshVertexFormat::Packed)
+			mesh.packedVertices = { reinterpret_cast<const MeshVertexPacked*>(vertices), meshHeader.vertexCount };
+		else
+			mesh.vertices = { reinterpret_cast<const MeshVertex*>(vertices), meshHeader.vertexCount };
+		mesh.indices = { reinterpret_cast<const uint32_t*>(indices), meshHeader.indexCount };
+		mesh.lods = { reinterpret_cast<const MeshLod*>(lods), meshHeader.lodCount };
+		mesh.meshlets = { reinterpret_cast<const Meshlet*>(meshlets), meshHeader.meshletCount };
+		for (const MeshLod& lod : mesh.lods)
+		{
+			if (size_t(lod.indexOffset) + lod.indexCount > meshHeader.indexCount)
+				return false;
+		}
+		const size_t baseIndexCount = mesh.lods.empty() ? meshHeader.indexCount : mesh.lods[0].indexCount;
+		for (const Meshlet& meshlet : mesh.meshlets)
+		{
+			if (size_t(meshlet.indexOffset) + meshlet.indexCount > baseIndexCount)
+				return false;
+		}
+		for (uint32_t index : mesh.indices)
+		{
+			if (index >= meshHeader.vertexCount)
+				return false;
+		}
+		return true;
+	}
+}
+//=============================================================================
+std::string modelcache::GetCachePath(const std::string& fileName)
+{
+	return fileName + ".nmesh";
+}
+//=============================================================================
+bool modelcache::Save(const std::string& cachePath, const CookedModelKey& key, std::span<const MeshSource> meshes)
+{
+	for (const MeshSource& mesh : meshes)
+	{
+		for (const MaterialTextureSource& texture : mesh.material.textures)
+		{
+			if (texture.embeddedIndex >= 0)
+			{
+				Debug("Model has embedded textures, cooked file is not created: " + cachePath);
+				return false;
+			}
+		}
+	}
+
+	// write into temp file and rename it so that a broken write never looks like a valid cache
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			Warning("Fail to create cooked model file: " + cachePath);
+			return false;
+		}
+
+		CookedHeader header{};
+		header.magic        = CookedMagic;
+		header.version      = CookedVersion;
+		header.vertexSize   = sizeof(MeshVertex);
+		header.importFlags  = key.importFlags;
+		header.processFlags = key.processFlags;
+		header.materialType = static_cast<uint32_t>(key.materialType);
+		header.meshCount    = static_cast<uint32_t>(meshes.size());
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		for (const MeshSource& mesh : meshes)
+		{
+			CookedMeshHeader meshHeader{};
+			meshHeader.vertexCount  = static_cast<uint32_t>(mesh.GetVertexCount());
+			meshHeader.indexCount   = static_cast<uint32_t>(mesh.indices.size());
+			meshHeader.aabbMin[0]   = mesh.aabb.min.x;
+			meshHeader.aabbMin[1]   = mesh.aabb.min.y;
+			meshHeader.aabbMin[2]   = mesh.aabb.min.z;
+			meshHeader.aabbMax[0]   = mesh.aabb.max.x;
+			meshHeader.aabbMax[1]   = mesh.aabb.max.y;
+			meshHeader.aabbMax[2]   = mesh.aabb.max.z;
+			meshHeader.hasParams    = mesh.material.params.has_value() ? 1 : 0;
+			meshHeader.pbr          = mesh.material.pbr ? 1 : 0;
+			meshHeader.textureCount = static_cast<uint16_t>(mesh.material.textures.size());
+			meshHeader.lodCount     = static_cast<uint32_t>(mesh.lods.size());
+			meshHeader.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+			meshHeader.vertexFormat = static_cast<uint8_t>(mesh.vertexFormat);
+			file.write(reinterpret_cast<const char*>(&meshHeader), sizeof(meshHeader));
+
+			if (mesh.material.params)
+			{
+				const Material& m = *mesh.material.params;
+				CookedMaterialParams params{};
+				params.opacity = m.opacity;
+				std::memcpy(params.diffuseColor, &m.diffuseColor, sizeof(params.diffuseColor));
+				std::memcpy(params.specularColor, &m.specularColor, sizeof(params.specularColor));
+				std::memcpy(params.ambientColor, &m.ambientColor, sizeof(params.ambientColor));
+				params.shininess = m.shininess;
+				params.roughness = m.roughness;
+				params.metallic  = m.metallic;
+				params.noLighing = m.noLighing ? 1u : 0u;
+				file.write(reinterpret_cast<const char*>(&params), sizeof(params));
+			}
+
+			for (const MaterialTextureSource& texture : mesh.material.textures)
+			{
+				CookedTexture cookedTexture{};
+				cookedTexture.slot       = static_cast<uint8_t>(texture.slot);
+				cookedTexture.colorSpace = static_cast<uint8_t>(texture.colorSpace);
+				cookedTexture.pathLength = static_cast<uint16_t>(texture.path.size());
+				file.write(reinterpret_cast<const char*>(&cookedTexture), sizeof(cookedTexture));
+				file.write(texture.path.data(), static_cast<std::streamsize>(texture.path.size()));
+			}
+
+			writePadding(file);
+			file.write(reinterpret_cast<const char*>(mesh.lods.data()), static_cast<std::streamsize>(mesh.lods.size() * sizeof(MeshLod)));
+			file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), static_cast<std::streamsize>(mesh.meshlets.size() * sizeof(Meshlet)));
+			if (mesh.vertexFormat == MeshVertexFormat::Packed)
+				file.write(reinterpret_cast<const char*>(mesh.packedVertices.data()), static_cast<std::streamsize>(mesh.packedVertices.size() * sizeof(MeshVertexPacked)));
+			else
+				file.write(reinterpret_cast<const char*>(mesh.vertices.data()), static_cast<std::streamsize>(mesh.vertices.size() * sizeof(MeshVertex)));
+			file.write(reinterpret_cast<const char*>(mesh.indices.data()), static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
+		}
+
+		if (!file.good())
+		{
+			file.close();
+			std::filesystem::remove(tempPath);
+			Warning("Fail to write cooked model file: " + cachePath);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		Warning("Fail to write cooked model file: " + cachePath);
+		return false;
+	}
+
+	Debug("Save cooked model: " + cachePath);
+	return true;
+}
+//=============================================================================
+bool modelcache::CookedModel::Open(const std::string& cachePath, const CookedModelKey& key)
+{
+	Close();
+
+	if (!m_file.Open(cachePath))
+		return false;
+
+	CookedReader reader(m_file.GetData(), m_file.GetSize());
+
+	CookedHeader header{};
+	if (!reader.Read(header)
+		|| header.magic != CookedMagic
+		|| header.version != CookedVersion
+		|| header.vertexSize != sizeof(MeshVertex)
+		|| header.importFlags != key.importFlags
+		|| header.processFlags != key.processFlags
+		|| header.materialType != static_cast<uint32_t>(key.materialType))
+	{
+		Debug("Cooked model file is outdated: " + cachePath);
+		Close();
+		return false;
+	}
+
+	m_meshes.resize(header.meshCount);
+	for (CookedMesh& mesh : m_meshes)
+	{
+		if (!readMesh(reader, mesh))
+		{
+			Warning("Cooked model file is corrupted: " + cachePath);
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+//=============================================================================
+void modelcache::CookedModel::Close()
+{
+	m_meshes.clear();
+	m_file.Close();
+}
+//=============================================================================
\ No newline at end of file
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "NanoRenderModel.h"
+#include "NanoIO.h"
+
+// Cooked model file: engine-ready vertices/indices + material description stored next to the source model ("<source>.nmesh").
+// Used instead of Assimp while it is newer than the source file and matches the current format version.
+namespace modelcache
+{
+	constexpr uint32_t CookedMagic   = 0x48534D4E; // "NMSH"
+	constexpr uint32_t CookedVersion = 5;
+
+	// everything that changes the cooked data besides the source file
+	struct CookedModelKey final
+	{
+		ModelMaterialType materialType{ ModelMaterialType::None };
+		uint32_t          importFlags{ 0 };  // Assimp aiProcess_* flags
+		uint64_t          processFlags{ 0 }; // engine post-processing, see ModelLoadInfo::GetProcessFlags()
+	};
+
+	std::string GetCachePath(const std::string& fileName);
+
+	bool Save(const std::string& cachePath, const CookedModelKey& key, std::span<const MeshSource> meshes);
+
+	struct CookedMesh final
+	{
+		MeshVertexFormat                  vertexFormat{ MeshVertexFormat::Full };
+		std::span<const MeshVertex>       vertices;
+		std::span<const MeshVertexPacked> packedVertices;
+		std::span<const uint32_t>         indices;
+		std::span<const MeshLod>          lods;
+		std::span<const Meshlet>          meshlets;
+		AABB                              aabb;
+		MeshMaterialSource                material;
+	};
+
+	// Mapped view of a cooked model. Vertex and index spans point into the mapping and live until Close()
+	class CookedModel final
+	{
+	public:
+		bool Open(const std::string& cachePath, const CookedModelKey& key);
+		void Close();
+
+		size_t GetNumMeshes() const noexcept { return m_meshes.size(); }
+		const CookedMesh& GetMesh(size_t id) const noexcept { return m_meshes[id]; }
+
+	private:
+		io::MappedFile          m_file;
+		std::vector<CookedMesh> m_meshes;
+	};
+} // namespace modelcache
\ No newline at end of file
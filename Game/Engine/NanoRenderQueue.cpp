@@ -0,0 +1,118 @@
+﻿#include "stdafx.h"
+#include "NanoRenderQueue.h"
+#include "NanoCore.h"
+#include "NanoJobs.h"
+//=============================================================================
+namespace
+{
+	constexpr uint64_t getField(uint32_t value, unsigned bits) noexcept
+	{
+		return static_cast<uint64_t>(value) & ((uint64_t{ 1 } << bits) - 1);
+	}
+}
+//=============================================================================
+uint64_t MakeDrawSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertexArray, float depth) noexcept
+{
+	static_assert(DrawKeyDepthBits + DrawKeyVertexArrayBits + DrawKeyMaterialBits + DrawKeyProgramBits + DrawKeyPassBits == 64);
+
+	constexpr uint32_t MaxDepth = (1u << DrawKeyDepthBits) - 1;
+	const uint32_t quantizedDepth = static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(MaxDepth));
+
+	uint64_t key = getField(pass, DrawKeyPassBits);
+	key = (key << DrawKeyProgramBits) | getField(program, DrawKeyProgramBits);
+	key = (key << DrawKeyMaterialBits) | getField(material, DrawKeyMaterialBits);
+	key = (key << DrawKeyVertexArrayBits) | getField(vertexArray, DrawKeyVertexArrayBits);
+	key = (key << DrawKeyDepthBits) | quantizedDepth;
+	return key;
+}
+//=============================================================================
+std::size_t std::hash<DrawMaterial>::operator()(const DrawMaterial& k) const noexcept
+{
+	return static_cast<std::size_t>(HashBytes(k.textures.data(), sizeof(k.textures)));
+}
+//=============================================================================
+uint32_t RenderQueue::GetMaterialId(const DrawMaterial& material)
+{
+	// the materials of a scene are known after the first frame, later lookups only take the shared lock
+	{
+		std::shared_lock lock(m_materialMutex);
+		auto it = m_materialIds.find(material);
+		if (it != m_materialIds.end())
+			return it->second;
+	}
+
+	std::unique_lock lock(m_materialMutex);
+	auto [it, inserted] = m_materialIds.try_emplace(material, static_cast<uint32_t>(m_materials.size()));
+	if (inserted)
+		m_materials.push_back(material);
+	return it->second;
+}
+//=============================================================================
+void RenderQueue::Build(size_t count, const std::function<void(size_t, std::vector<DrawPacket>&)>& build)
+{
+	// a few chunks per thread even out objects with many meshes, small scenes stay on the calling thread
+	constexpr size_t MinChunkSize = 64;
+	constexpr size_t ChunksPerThread = 4;
+
+	if (count == 0) return;
+
+	const size_t numThreads = static_cast<size_t>(jobs::GetNumThreads()) + 1;
+	const size_t numChunks = std::clamp(count / MinChunkSize, size_t{ 1 }, numThreads * ChunksPerThread);
+	const size_t chunkSize = (count + numChunks - 1) / numChunks;
+	if (m_chunks.size() < numChunks)
+		m_chunks.resize(numChunks);
+
+	jobs::ParallelFor(numChunks, [&](size_t chunk)
+		{
+			std::vector<DrawPacket>& packets = m_chunks[chunk];
+			packets.clear();
+			const size_t end = std::min(count, (chunk + 1) * chunkSize);
+			for (size_t i = chunk * chunkSize; i < end; i++)
+				build(i, packets);
+		});
+
+	size_t numPackets = m_packets.size();
+	for (size_t chunk = 0; chunk < numChunks; chunk++)
+		numPackets += m_chunks[chunk].size();
+	m_packets.reserve(numPackets);
+	for (size_t chunk = 0; chunk < numChunks; chunk++)
+		m_packets.insert(m_packets.end(), m_chunks[chunk].begin(), m_chunks[chunk].end());
+}
+//=============================================================================
+void RenderQueue::Sort()
+{
+	constexpr unsigned DigitBits = 8;
+	constexpr size_t   NumDigits = 64 / DigitBits;
+	constexpr size_t   NumBuckets = size_t{ 1 } << DigitBits;
+
+	if (m_packets.size() < 2) return;
+
+	// one read of the keys counts all digits
+	std::array<std::array<uint32_t, NumBuckets>, NumDigits> counts{};
+	for (const DrawPacket& packet : m_packets)
+	{
+		for (size_t digit = 0; digit < NumDigits; digit++)
+			counts[digit][(packet.sortKey >> (digit * DigitBits)) & (NumBuckets - 1)]++;
+	}
+
+	m_sorted.resize(m_packets.size());
+	for (size_t digit = 0; digit < NumDigits; digit++)
+	{
+		auto& count = counts[digit];
+		const uint64_t first = (m_packets.front().sortKey >> (digit * DigitBits)) & (NumBuckets - 1);
+		if (count[first] == m_packets.size())
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& bucket : count)
+		{
+			const uint32_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+		for (const DrawPacket& packet : m_packets)
+			m_sorted[count[(packet.sortKey >> (digit * DigitBits)) & (NumBuckets - 1)]++] = packet;
+		m_packets.swap(m_sorted);
+	}
+}
+//=============================================================================
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "NanoRenderMesh.h"
+
+//=============================================================================
+// Sort key
+//=============================================================================
+
+// Fields from the most significant bits: pass, program, material, vertex array, depth. Sorting by the key groups the
+// draws by state and orders the draws of one state front to back. A field wider than its bits keeps the low bits,
+// this changes only the grouping, the submission compares the ids of the packet
+constexpr unsigned DrawKeyDepthBits       = 20;
+constexpr unsigned DrawKeyVertexArrayBits = 12;
+constexpr unsigned DrawKeyMaterialBits    = 18;
+constexpr unsigned DrawKeyProgramBits     = 10;
+constexpr unsigned DrawKeyPassBits        = 4;
+
+// depth in [0, 1] from the near to the far end of the view, back to front passes give 1 - depth
+uint64_t MakeDrawSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertexArray, float depth) noexcept;
+
+//=============================================================================
+// Render queue
+//=============================================================================
+
+constexpr size_t MaxDrawMaterialTextures = 5;
+
+// Textures of a draw by unit, 0 - nothing bound. Draws with the same textures share one material id
+struct DrawMaterial final
+{
+	bool operator==(const DrawMaterial&) const noexcept = default;
+
+	std::array<GLuint, MaxDrawMaterialTextures> textures{};
+};
+
+template<>
+struct std::hash<DrawMaterial>
+{
+	std::size_t operator()(const DrawMaterial& k) const noexcept;
+};
+
+struct DrawPacket final
+{
+	uint64_t    sortKey{ 0 };
+	const Mesh* mesh{ nullptr };
+	uint32_t    object{ 0 };   // index of the object in the scene, per object uniforms are set when it changes
+	uint32_t    program{ 0 };  // index of the program in the pass
+	uint32_t    material{ 0 }; // RenderQueue::GetMaterialId
+	uint32_t    lod{ 0 };
+};
+
+// Draw packets of one view. The pass submits a packet per visible mesh, sorts the queue and walks the packets,
+// binding only what differs from the previous packet
+class RenderQueue final
+{
+public:
+	// drops the packets, material ids stay valid so that the keys of a static scene do not change
+	void Clear() { m_packets.clear(); }
+
+	// thread safe, Build calls it from the workers. A new material takes the next id, so on the first frames the ids
+	// depend on the thread timing
+	uint32_t GetMaterialId(const DrawMaterial& material);
+	// not during Build, a new material may move the storage
+	const DrawMaterial& GetMaterial(uint32_t id) const noexcept { return m_materials[id]; }
+	size_t GetNumMaterials() const noexcept { return m_materials.size(); }
+
+	void Submit(const DrawPacket& packet) { m_packets.push_back(packet); }
+	// Calls build(i, packets) for i in [0, count) on the job system. The range is split into chunks, each chunk
+	// writes to its own buffer and the buffers are appended in chunk order, so the packets are the same as from a
+	// serial loop. build runs on the workers: no OpenGL, only the state of object i may be changed
+	void Build(size_t count, const std::function<void(size_t, std::vector<DrawPacket>&)>& build);
+	// stable LSD radix sort by sortKey, 8 bit digits. Digits that are equal in all keys cost no pass
+	void Sort();
+
+	std::span<const DrawPacket> GetPackets() const noexcept { return m_packets; }
+	size_t GetNumPackets() const noexcept { return m_packets.size(); }
+
+private:
+	std::vector<DrawPacket>                    m_packets;
+	std::vector<DrawPacket>                    m_sorted;
+	std::vector<std::vector<DrawPacket>>       m_chunks;
+	std::vector<DrawMaterial>                  m_materials;
+	std::unordered_map<DrawMaterial, uint32_t> m_materialIds;
+	std::shared_mutex                          m_materialMutex;
+};
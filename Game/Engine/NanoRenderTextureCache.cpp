@@ -0,0 +1,330 @@
+﻿#include "stdafx.h"
+#include "NanoRenderTextureCache.h"
+#include "NanoLog.h"
+#include "NanoCore.h"
+#include <stb/stb_image_resize2.h>
+//=============================================================================
+namespace
+{
+#pragma pack(push, 1)
+	struct CookedHeader final
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint8_t  format;
+		uint8_t  colorSpace;
+		uint8_t  flipVertical;
+		uint8_t  usage;
+		uint32_t levelCount;
+		uint64_t contentHash; // of the decoded level 0, the same image under another name has the same hash
+	};
+
+	struct CookedLevelHeader final
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t offset; // from the start of the level data
+		uint32_t size;
+	};
+#pragma pack(pop)
+
+	constexpr uint32_t MaxLevels = 16;
+#if VERIFY_TEXTURE_COMPRESSION
+	// photos and painted textures stay above it, noise images fall below, a warning asks to check the result
+	constexpr double MinVerifiedPSNR = 30.0;
+#endif
+
+	// level data starts aligned to 4 bytes inside the file
+	constexpr size_t alignSize(size_t size) { return (size + 3u) & ~size_t(3u); }
+
+	bool getCookedFormat(uint32_t components, texturecache::CookedFormat& format)
+	{
+		switch (components)
+		{
+		case 1: format = texturecache::CookedFormat::R8; return true;
+		case 2: format = texturecache::CookedFormat::RG8; return true;
+		case 3: format = texturecache::CookedFormat::RGB8; return true;
+		case 4: format = texturecache::CookedFormat::RGBA8; return true;
+		default: return false;
+		}
+	}
+
+	texturecache::CookedFormat getCookedFormat(texcompress::BlockFormat format)
+	{
+		switch (format)
+		{
+		case texcompress::BlockFormat::BC1: return texturecache::CookedFormat::BC1;
+		case texcompress::BlockFormat::BC3: return texturecache::CookedFormat::BC3;
+		case texcompress::BlockFormat::BC4: return texturecache::CookedFormat::BC4;
+		case texcompress::BlockFormat::BC5: return texturecache::CookedFormat::BC5;
+		case texcompress::BlockFormat::BC7: return texturecache::CookedFormat::BC7;
+		default: std::unreachable();
+		}
+	}
+
+	// sRGB color is filtered in linear space, alpha and data channels as they are
+	stbir_pixel_layout getResizeLayout(uint32_t components, ColorSpace colorSpace)
+	{
+		switch (components)
+		{
+		case 1: return STBIR_1CHANNEL;
+		case 2: return STBIR_2CHANNEL;
+		case 3: return STBIR_RGB;
+		default: return colorSpace == ColorSpace::sRGB ? STBIR_RGBA : STBIR_4CHANNEL;
+		}
+	}
+}
+//=============================================================================
+std::string texturecache::GetCachePath(const std::string& fileName, const CookedTextureKey& key)
+{
+	// the key is part of the name, variants of one source (color space, flip, usage) are separate files
+	const uint32_t keyCode = static_cast<uint32_t>(key.colorSpace) | (key.flipVertical ? 1u << 8 : 0u) | (static_cast<uint32_t>(key.usage) << 16);
+	char code[9]{};
+	std::to_chars(code, code + sizeof(code) - 1, keyCode, 16);
+	return fileName + "." + code + ".ntex";
+}
+//=============================================================================
+uint32_t texturecache::GetComponents(CookedFormat format)
+{
+	switch (format)
+	{
+	case CookedFormat::R8:
+	case CookedFormat::BC4:  return 1;
+	case CookedFormat::RG8:
+	case CookedFormat::BC5:  return 2;
+	case CookedFormat::RGB8:
+	case CookedFormat::BC1:  return 3;
+	default:                 return 4;
+	}
+}
+//=============================================================================
+size_t texturecache::GetLevelSize(CookedFormat format, uint32_t width, uint32_t height)
+{
+	if (const std::optional<texcompress::BlockFormat> blockFormat = GetBlockFormat(format))
+		return texcompress::GetCompressedSize(*blockFormat, width, height);
+	return size_t(width) * height * GetComponents(format);
+}
+//=============================================================================
+std::optional<texcompress::BlockFormat> texturecache::GetBlockFormat(CookedFormat format)
+{
+	switch (format)
+	{
+	case CookedFormat::BC1: return texcompress::BlockFormat::BC1;
+	case CookedFormat::BC3: return texcompress::BlockFormat::BC3;
+	case CookedFormat::BC4: return texcompress::BlockFormat::BC4;
+	case CookedFormat::BC5: return texcompress::BlockFormat::BC5;
+	case CookedFormat::BC7: return texcompress::BlockFormat::BC7;
+	default:                return std::nullopt;
+	}
+}
+//=============================================================================
+bool texturecache::Save(const std::string& cachePath, const CookedTextureKey& key, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components)
+{
+	CookedFormat format{};
+	if (!pixels || width == 0 || height == 0 || !getCookedFormat(components, format))
+		return false;
+	const std::optional<texcompress::BlockFormat> blockFormat = texcompress::ChooseFormat(key.usage, components, texcompress::HasAlpha(pixels, width, height, components), key.colorSpace);
+
+	// mip chain, every level is filtered from the previous one
+	std::vector<std::vector<uint8_t>> levels;
+	std::vector<CookedLevelHeader> levelHeaders;
+	const stbir_pixel_layout layout = getResizeLayout(components, key.colorSpace);
+	const bool sRGB = key.colorSpace == ColorSpace::sRGB && components >= 3;
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	uint32_t offset = 0;
+	while (levelHeaders.size() < MaxLevels)
+	{
+		const size_t size = GetLevelSize(format, levelWidth, levelHeight);
+		if (levelHeaders.empty())
+		{
+			levels.emplace_back(pixels, pixels + size);
+		}
+		else
+		{
+			const CookedLevelHeader& previous = levelHeaders.back();
+			std::vector<uint8_t>& level = levels.emplace_back(size);
+			const uint8_t* source = levels[levels.size() - 2].data();
+			const int sourceStride = static_cast<int>(previous.width * components);
+			const int stride = static_cast<int>(levelWidth * components);
+			const unsigned char* result = sRGB
+				? stbir_resize_uint8_srgb(source, static_cast<int>(previous.width), static_cast<int>(previous.height), sourceStride, level.data(), static_cast<int>(levelWidth), static_cast<int>(levelHeight), stride, layout)
+				: stbir_resize_uint8_linear(source, static_cast<int>(previous.width), static_cast<int>(previous.height), sourceStride, level.data(), static_cast<int>(levelWidth), static_cast<int>(levelHeight), stride, layout);
+			if (!result)
+			{
+				Warning("Fail to build mipmaps for cooked texture: " + cachePath);
+				return false;
+			}
+		}
+		levelHeaders.push_back({ levelWidth, levelHeight, offset, static_cast<uint32_t>(size) });
+		offset += static_cast<uint32_t>(size);
+
+		if (levelWidth == 1 && levelHeight == 1) break;
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+
+	// every level is filtered from the uncompressed previous one, so the blocks are encoded after the whole chain
+	if (blockFormat)
+	{
+		format = getCookedFormat(*blockFormat);
+		offset = 0;
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			CookedLevelHeader& levelHeader = levelHeaders[i];
+			std::vector<uint8_t> blocks(texcompress::GetCompressedSize(*blockFormat, levelHeader.width, levelHeader.height));
+			texcompress::Encode(*blockFormat, levels[i].data(), levelHeader.width, levelHeader.height, components, blocks.data());
+#if VERIFY_TEXTURE_COMPRESSION
+			if (i == 0)
+			{
+				std::vector<uint8_t> decoded(size_t(levelHeader.width) * levelHeader.height * 4);
+				texcompress::Decode(*blockFormat, blocks.data(), levelHeader.width, levelHeader.height, decoded.data());
+				const double psnr = texcompress::ComputePSNR(*blockFormat, levels[i].data(), levelHeader.width, levelHeader.height, components, decoded.data());
+				const std::string message = "Cooked texture " + cachePath + ": " + std::string(texcompress::GetName(*blockFormat)) + " PSNR " + std::to_string(psnr) + " dB";
+				if (psnr < MinVerifiedPSNR) Warning(message);
+				else                        Info(message);
+			}
+#endif
+			levels[i] = std::move(blocks);
+			levelHeader.offset = offset;
+			levelHeader.size = static_cast<uint32_t>(levels[i].size());
+			offset += levelHeader.size;
+		}
+	}
+
+	// write into temp file and rename it so that a broken write never looks like a valid cache
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			Warning("Fail to create cooked texture file: " + cachePath);
+			return false;
+		}
+
+		CookedHeader header{};
+		header.magic        = CookedMagic;
+		header.version      = CookedVersion;
+		header.format       = static_cast<uint8_t>(format);
+		header.colorSpace   = static_cast<uint8_t>(key.colorSpace);
+		header.flipVertical = key.flipVertical ? 1 : 0;
+		header.usage        = static_cast<uint8_t>(key.usage);
+		header.levelCount   = static_cast<uint32_t>(levelHeaders.size());
+		header.contentHash  = HashBytes(pixels, size_t(width) * height * components);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levelHeaders.data()), static_cast<std::streamsize>(levelHeaders.size() * sizeof(CookedLevelHeader)));
+
+		const size_t headerSize = static_cast<size_t>(file.tellp());
+		const char zeros[4]{};
+		file.write(zeros, static_cast<std::streamsize>(alignSize(headerSize) - headerSize));
+
+		for (const std::vector<uint8_t>& level : levels)
+			file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+
+		if (!file.good())
+		{
+			file.close();
+			std::filesystem::remove(tempPath);
+			Warning("Fail to write cooked texture file: " + cachePath);
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		Warning("Fail to write cooked texture file: " + cachePath);
+		return false;
+	}
+
+	Debug("Save cooked texture: " + cachePath + (blockFormat ? " (" + std::string(texcompress::GetName(*blockFormat)) + ")" : ""));
+	return true;
+}
+//=============================================================================
+bool texturecache::Cook(const std::string& fileName, const CookedTextureKey& key)
+{
+	stbi_set_flip_vertically_on_load_thread(key.flipVertical);
+
+	int width, height, nrComponents;
+	stbi_uc* pixels = stbi_load(fileName.c_str(), &width, &height, &nrComponents, 0);
+	if (!pixels || width <= 0 || height <= 0)
+	{
+		stbi_image_free(pixels);
+		Error("Failed to load texture " + fileName);
+		return false;
+	}
+
+	const bool result = Save(GetCachePath(fileName, key), key, pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(nrComponents));
+	stbi_image_free(pixels);
+	return result;
+}
+//=============================================================================
+bool texturecache::CookedTexture::Open(const std::string& cachePath, const CookedTextureKey& key)
+{
+	Close();
+
+	if (!m_file.Open(cachePath))
+		return false;
+
+	const uint8_t* data = m_file.GetData();
+	const size_t size = m_file.GetSize();
+
+	CookedHeader header{};
+	if (size >= sizeof(header))
+		std::memcpy(&header, data, sizeof(header));
+	if (header.magic != CookedMagic
+		|| header.version != CookedVersion
+		|| header.colorSpace != static_cast<uint8_t>(key.colorSpace)
+		|| header.flipVertical != (key.flipVertical ? 1 : 0)
+		|| header.usage != static_cast<uint8_t>(key.usage))
+	{
+		Debug("Cooked texture file is outdated: " + cachePath);
+		Close();
+		return false;
+	}
+
+	const size_t dataOffset = alignSize(sizeof(header) + size_t(header.levelCount) * sizeof(CookedLevelHeader));
+	if (header.format > static_cast<uint8_t>(CookedFormat::BC7) || header.levelCount == 0 || header.levelCount > MaxLevels || dataOffset > size)
+	{
+		Warning("Cooked texture file is corrupted: " + cachePath);
+		Close();
+		return false;
+	}
+	m_format = static_cast<CookedFormat>(header.format);
+	m_contentHash = header.contentHash;
+	// cooked on a machine with other compression support
+	if (const std::optional<texcompress::BlockFormat> blockFormat = GetBlockFormat(m_format); blockFormat && !texcompress::IsSupported(*blockFormat, key.colorSpace))
+	{
+		Debug("Cooked texture format is not supported: " + cachePath);
+		Close();
+		return false;
+	}
+	m_data = { data + dataOffset, size - dataOffset };
+
+	m_levels.resize(header.levelCount);
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		CookedLevelHeader levelHeader{};
+		std::memcpy(&levelHeader, data + sizeof(header) + i * sizeof(CookedLevelHeader), sizeof(levelHeader));
+		if (levelHeader.width == 0 || levelHeader.height == 0
+			|| levelHeader.size != GetLevelSize(m_format, levelHeader.width, levelHeader.height)
+			|| size_t(levelHeader.offset) + levelHeader.size > m_data.size())
+		{
+			Warning("Cooked texture file is corrupted: " + cachePath);
+			Close();
+			return false;
+		}
+		m_levels[i] = { levelHeader.width, levelHeader.height, m_data.subspan(levelHeader.offset, levelHeader.size) };
+	}
+	return true;
+}
+//=============================================================================
+void texturecache::CookedTexture::Close()
+{
+	m_levels.clear();
+	m_data = {};
+	m_file.Close();
+}
+//=============================================================================
\ No newline at end of file
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "NanoOpenGL3.h"
+#include "NanoRenderTextureCompress.h"
+#include "NanoIO.h"
+
+// Cooked texture file: all mip levels precomputed and tightly packed, stored next to the source image ("<source>.<key>.ntex").
+// Used instead of the image decoder while it is newer than the source file and matches the current format version.
+// Levels are block compressed by the usage of the texture when the GPU supports the format (texcompress::ChooseFormat).
+namespace texturecache
+{
+	constexpr uint32_t CookedMagic   = 0x5845544E; // "NTEX"
+	constexpr uint32_t CookedVersion = 3;
+
+	enum class CookedFormat : uint8_t
+	{
+		R8,
+		RG8,
+		RGB8,
+		RGBA8,
+		BC1,
+		BC3,
+		BC4,
+		BC5,
+		BC7
+	};
+
+	// everything that changes the cooked data besides the source file
+	struct CookedTextureKey final
+	{
+		ColorSpace   colorSpace{ ColorSpace::Linear };
+		bool         flipVertical{ false };
+		TextureUsage usage{ TextureUsage::Uncompressed };
+	};
+
+	// <fileName>.<key>.ntex
+	std::string GetCachePath(const std::string& fileName, const CookedTextureKey& key);
+
+	// channels of the texture, for block formats the ones they store
+	uint32_t GetComponents(CookedFormat format);
+	size_t GetLevelSize(CookedFormat format, uint32_t width, uint32_t height);
+	std::optional<texcompress::BlockFormat> GetBlockFormat(CookedFormat format);
+
+	// Builds the mip chain from level 0 (gamma correct for sRGB color), compresses it and writes the file
+	bool Save(const std::string& cachePath, const CookedTextureKey& key, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components);
+	// decodes the source image and saves it, for cooking asset folders ahead of time
+	bool Cook(const std::string& fileName, const CookedTextureKey& key);
+
+	struct CookedLevel final
+	{
+		uint32_t                 width{ 0 };
+		uint32_t                 height{ 0 };
+		std::span<const uint8_t> data;
+	};
+
+	// Mapped view of a cooked texture. Level data points into the mapping and lives until Close()
+	class CookedTexture final
+	{
+	public:
+		bool Open(const std::string& cachePath, const CookedTextureKey& key);
+		void Close();
+
+		CookedFormat GetFormat() const noexcept { return m_format; }
+		uint32_t GetWidth() const noexcept { return m_levels.empty() ? 0 : m_levels[0].width; }
+		uint32_t GetHeight() const noexcept { return m_levels.empty() ? 0 : m_levels[0].height; }
+		size_t GetNumLevels() const noexcept { return m_levels.size(); }
+		const CookedLevel& GetLevel(size_t level) const noexcept { return m_levels[level]; }
+		// all levels one after another
+		std::span<const uint8_t> GetData() const noexcept { return m_data; }
+		// HashBytes of the decoded source pixels, read from the header
+		uint64_t GetContentHash() const noexcept { return m_contentHash; }
+
+	private:
+		io::MappedFile           m_file;
+		CookedFormat             m_format{ CookedFormat::RGBA8 };
+		std::vector<CookedLevel> m_levels;
+		std::span<const uint8_t> m_data;
+		uint64_t                 m_contentHash{ 0 };
+	};
+} // namespace texturecache
\ No newline at end of file
@@ -0,0 +1,899 @@
+﻿#include "stdafx.h"
+#include "NanoRenderTextureCompress.h"
+#include "NanoJobs.h"
+//=============================================================================
+namespace
+{
+	bool supportS3TC{ false };
+	bool supportS3TCsRGB{ false };
+	bool supportBPTC{ false };
+
+	// one 4x4 block as RGBA, texels in row order
+	using BlockTexels = uint8_t[16][4];
+
+	constexpr int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void fetchBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components, uint32_t blockX, uint32_t blockY, BlockTexels& block)
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			const uint32_t sy = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				const uint32_t sx = std::min(blockX * 4 + x, width - 1);
+				const uint8_t* texel = pixels + (size_t(sy) * width + sx) * components;
+				uint8_t* dst = block[y * 4 + x];
+				dst[0] = texel[0];
+				dst[1] = components > 1 ? texel[1] : 0;
+				dst[2] = components > 2 ? texel[2] : 0;
+				dst[3] = components > 3 ? texel[3] : 255;
+			}
+		}
+	}
+
+	template<typename T>
+	T clampValue(T value, T low, T high) { return value < low ? low : (value > high ? high : value); }
+
+	// Principal axis of the block colors (first 'channels' channels) by power iteration. Returns false for a solid block
+	template<int Channels>
+	bool principalAxis(const BlockTexels& block, float mean[Channels], float axis[Channels])
+	{
+		float minValue[Channels], maxValue[Channels];
+		for (int c = 0; c < Channels; c++)
+		{
+			mean[c] = 0.0f;
+			minValue[c] = 255.0f;
+			maxValue[c] = 0.0f;
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < Channels; c++)
+			{
+				const float v = block[i][c];
+				mean[c] += v;
+				minValue[c] = std::min(minValue[c], v);
+				maxValue[c] = std::max(maxValue[c], v);
+			}
+		}
+
+		bool solid = true;
+		for (int c = 0; c < Channels; c++)
+		{
+			mean[c] /= 16.0f;
+			axis[c] = maxValue[c] - minValue[c];
+			if (axis[c] > 0.0f) solid = false;
+		}
+		if (solid) return false;
+
+		float covariance[Channels][Channels]{};
+		for (int i = 0; i < 16; i++)
+		{
+			float d[Channels];
+			for (int c = 0; c < Channels; c++)
+				d[c] = block[i][c] - mean[c];
+			for (int a = 0; a < Channels; a++)
+				for (int b = 0; b < Channels; b++)
+					covariance[a][b] += d[a] * d[b];
+		}
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[Channels]{};
+			float length = 0.0f;
+			for (int a = 0; a < Channels; a++)
+			{
+				for (int b = 0; b < Channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, std::abs(next[a]));
+			}
+			// the extent axis is orthogonal to the principal one, keep it
+			if (length < 1e-6f) break;
+			for (int c = 0; c < Channels; c++)
+				axis[c] = next[c] / length;
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < Channels; c++)
+			length += axis[c] * axis[c];
+		length = std::sqrt(length);
+		for (int c = 0; c < Channels; c++)
+			axis[c] /= length;
+		return true;
+	}
+
+	// endpoints at the extremes of the projection on the principal axis
+	template<int Channels>
+	void axisEndpoints(const BlockTexels& block, const float mean[Channels], const float axis[Channels], float e0[Channels], float e1[Channels])
+	{
+		float minT = std::numeric_limits<float>::max();
+		float maxT = std::numeric_limits<float>::lowest();
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < Channels; c++)
+				t += (block[i][c] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		for (int c = 0; c < Channels; c++)
+		{
+			e0[c] = clampValue(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+			e1[c] = clampValue(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+		}
+	}
+
+	// Least squares endpoints for fixed indices, 'weights' is the share of endpoint 0 per texel
+	template<int Channels>
+	bool refineEndpoints(const BlockTexels& block, const float weights[16], float e0[Channels], float e1[Channels])
+	{
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[Channels]{}, bx[Channels]{};
+		for (int i = 0; i < 16; i++)
+		{
+			const float a = weights[i];
+			const float b = 1.0f - a;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			for (int c = 0; c < Channels; c++)
+			{
+				ax[c] += a * block[i][c];
+				bx[c] += b * block[i][c];
+			}
+		}
+		const float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f) return false;
+
+		for (int c = 0; c < Channels; c++)
+		{
+			e0[c] = clampValue((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+			e1[c] = clampValue((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	//-------------------------------------------------------------------------
+	// BC1
+	//-------------------------------------------------------------------------
+	uint16_t packRGB565(const float color[3])
+	{
+		const int r = clampValue(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		const int g = clampValue(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		const int b = clampValue(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRGB565(uint16_t value, int color[3])
+	{
+		const int r = (value >> 11) & 31;
+		const int g = (value >> 5) & 63;
+		const int b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// 'fourColors' - c0 > c1 mode, the only one BC3 decodes
+	void getBC1Palette(uint16_t c0, uint16_t c1, bool fourColors, int palette[4][4])
+	{
+		unpackRGB565(c0, palette[0]);
+		unpackRGB565(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		for (int c = 0; c < 3; c++)
+		{
+			if (fourColors)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = fourColors ? 255 : 0;
+	}
+
+	// For every 8 bit value the 5 or 6 bit endpoint pair whose 2/3 + 1/3 interpolation comes closest, solid blocks use index 2
+	struct SolidFit final
+	{
+		uint8_t e0;
+		uint8_t e1;
+	};
+	struct SolidFitTables final
+	{
+		SolidFit fit5[256];
+		SolidFit fit6[256];
+	};
+
+	void buildSolidFit(int bits, SolidFit table[256])
+	{
+		const int maxValue = (1 << bits) - 1;
+		auto expand = [bits](int v) { return (v << (8 - bits)) | (v >> (2 * bits - 8)); };
+		for (int value = 0; value < 256; value++)
+		{
+			int bestError = std::numeric_limits<int>::max();
+			for (int e0 = 0; e0 <= maxValue; e0++)
+			{
+				for (int e1 = 0; e1 <= maxValue; e1++)
+				{
+					const int x0 = expand(e0);
+					const int x1 = expand(e1);
+					// prefer close endpoints, decoders differ in the rounding of wide interpolations
+					const int error = std::abs((2 * x0 + x1) / 3 - value) * 256 + std::abs(x0 - x1);
+					if (error < bestError)
+					{
+						bestError = error;
+						table[value] = { static_cast<uint8_t>(e0), static_cast<uint8_t>(e1) };
+					}
+				}
+			}
+		}
+	}
+
+	const SolidFitTables& getSolidFitTables()
+	{
+		static const SolidFitTables tables = []
+			{
+				SolidFitTables result{};
+				buildSolidFit(5, result.fit5);
+				buildSolidFit(6, result.fit6);
+				return result;
+			}();
+		return tables;
+	}
+
+	int chooseBC1Indices(const BlockTexels& block, uint16_t c0, uint16_t c1, uint8_t indices[16])
+	{
+		int palette[4][4];
+		getBC1Palette(c0, c1, true, palette);
+
+		int error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = std::numeric_limits<int>::max();
+			for (int p = 0; p < 4; p++)
+			{
+				const int dr = block[i][0] - palette[p][0];
+				const int dg = block[i][1] - palette[p][1];
+				const int db = block[i][2] - palette[p][2];
+				const int e = dr * dr + dg * dg + db * db;
+				if (e < bestError)
+				{
+					bestError = e;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+			error += bestError;
+		}
+		return error;
+	}
+
+	void encodeBC1(const BlockTexels& block, uint8_t* output)
+	{
+		float mean[3], axis[3];
+		uint16_t c0, c1;
+		uint8_t indices[16]{};
+		if (!principalAxis<3>(block, mean, axis))
+		{
+			const SolidFitTables& tables = getSolidFitTables();
+			const SolidFit& r = tables.fit5[block[0][0]];
+			const SolidFit& g = tables.fit6[block[0][1]];
+			const SolidFit& b = tables.fit5[block[0][2]];
+			c0 = static_cast<uint16_t>((r.e0 << 11) | (g.e0 << 5) | b.e0);
+			c1 = static_cast<uint16_t>((r.e1 << 11) | (g.e1 << 5) | b.e1);
+			std::fill(std::begin(indices), std::end(indices), uint8_t(2));
+		}
+		else
+		{
+			float e0[3], e1[3];
+			axisEndpoints<3>(block, mean, axis, e0, e1);
+			c0 = packRGB565(e0);
+			c1 = packRGB565(e1);
+			int error = chooseBC1Indices(block, c0, c1, indices);
+
+			// one least squares pass on the chosen indices
+			constexpr float Share[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = Share[indices[i]];
+			if (refineEndpoints<3>(block, weights, e0, e1))
+			{
+				const uint16_t r0 = packRGB565(e0);
+				const uint16_t r1 = packRGB565(e1);
+				uint8_t refined[16];
+				const int refinedError = chooseBC1Indices(block, r0, r1, refined);
+				if (refinedError < error)
+				{
+					c0 = r0;
+					c1 = r1;
+					std::memcpy(indices, refined, sizeof(indices));
+				}
+			}
+		}
+
+		// four color mode needs c0 > c1, swapping the endpoints swaps the index pairs
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			for (uint8_t& index : indices)
+				index ^= 1;
+		}
+		else if (c0 == c1)
+		{
+			std::fill(std::begin(indices), std::end(indices), uint8_t(0));
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= uint32_t(indices[i]) << (i * 2);
+		output[0] = static_cast<uint8_t>(c0 & 0xFF);
+		output[1] = static_cast<uint8_t>(c0 >> 8);
+		output[2] = static_cast<uint8_t>(c1 & 0xFF);
+		output[3] = static_cast<uint8_t>(c1 >> 8);
+		std::memcpy(output + 4, &bits, sizeof(bits));
+	}
+
+	void decodeBC1(const uint8_t* input, bool forceFourColors, BlockTexels& block)
+	{
+		const uint16_t c0 = static_cast<uint16_t>(input[0] | (input[1] << 8));
+		const uint16_t c1 = static_cast<uint16_t>(input[2] | (input[3] << 8));
+		uint32_t bits;
+		std::memcpy(&bits, input + 4, sizeof(bits));
+
+		int palette[4][4];
+		getBC1Palette(c0, c1, forceFourColors || c0 > c1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			const int* color = palette[(bits >> (i * 2)) & 3];
+			for (int c = 0; c < 4; c++)
+				block[i][c] = static_cast<uint8_t>(color[c]);
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	// BC4 (also alpha of BC3 and both channels of BC5)
+	//-------------------------------------------------------------------------
+	void getBC4Palette(int a0, int a1, int palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1)
+		{
+			for (int i = 1; i < 7; i++)
+				palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+				palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	int chooseBC4Indices(const uint8_t values[16], int a0, int a1, uint8_t indices[16])
+	{
+		int palette[8];
+		getBC4Palette(a0, a1, palette);
+
+		int error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = std::numeric_limits<int>::max();
+			for (int p = 0; p < 8; p++)
+			{
+				const int d = values[i] - palette[p];
+				if (d * d < bestError)
+				{
+					bestError = d * d;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+			error += bestError;
+		}
+		return error;
+	}
+
+	// Tries the 8 value mode over the full range and the 6 value mode that has exact 0 and 255
+	void encodeBC4(const BlockTexels& block, int channel, uint8_t* output)
+	{
+		uint8_t values[16];
+		int minValue = 255, maxValue = 0;
+		int minInner = 255, maxInner = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			values[i] = block[i][channel];
+			minValue = std::min(minValue, int(values[i]));
+			maxValue = std::max(maxValue, int(values[i]));
+			if (values[i] != 0 && values[i] != 255)
+			{
+				minInner = std::min(minInner, int(values[i]));
+				maxInner = std::max(maxInner, int(values[i]));
+			}
+		}
+
+		int a0 = maxValue, a1 = minValue;
+		uint8_t indices[16]{};
+		if (a0 != a1)
+		{
+			int error = chooseBC4Indices(values, a0, a1, indices);
+			if (error > 0 && (minValue == 0 || maxValue == 255))
+			{
+				const int b0 = minInner <= maxInner ? minInner : 0;
+				const int b1 = minInner <= maxInner ? maxInner : 255;
+				uint8_t indices6[16];
+				if (chooseBC4Indices(values, b0, b1, indices6) < error)
+				{
+					a0 = b0;
+					a1 = b1;
+					std::memcpy(indices, indices6, sizeof(indices));
+				}
+			}
+		}
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= uint64_t(indices[i]) << (i * 3);
+		output[0] = static_cast<uint8_t>(a0);
+		output[1] = static_cast<uint8_t>(a1);
+		for (int i = 0; i < 6; i++)
+			output[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+
+	void decodeBC4(const uint8_t* input, int channel, BlockTexels& block)
+	{
+		int palette[8];
+		getBC4Palette(input[0], input[1], palette);
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+			bits |= uint64_t(input[2 + i]) << (i * 8);
+		for (int i = 0; i < 16; i++)
+			block[i][channel] = static_cast<uint8_t>(palette[(bits >> (i * 3)) & 7]);
+	}
+
+	//-------------------------------------------------------------------------
+	// BC7 mode 6: one subset, RGBA endpoints 7 bits + unique p-bit, 4 bit indices
+	//-------------------------------------------------------------------------
+	struct BC7Endpoint final
+	{
+		uint8_t value[4]; // 7 bits
+		uint8_t pbit;
+	};
+
+	BC7Endpoint quantizeBC7Endpoint(const float color[4])
+	{
+		BC7Endpoint best{};
+		float bestError = std::numeric_limits<float>::max();
+		for (uint8_t p = 0; p < 2; p++)
+		{
+			BC7Endpoint endpoint{};
+			endpoint.pbit = p;
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				const int v = clampValue(static_cast<int>((color[c] - p) * 0.5f + 0.5f), 0, 127);
+				endpoint.value[c] = static_cast<uint8_t>(v);
+				const float d = float((v << 1) | p) - color[c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				best = endpoint;
+			}
+		}
+		return best;
+	}
+
+	void getBC7Palette(const BC7Endpoint& e0, const BC7Endpoint& e1, int palette[16][4])
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			const int v0 = (e0.value[c] << 1) | e0.pbit;
+			const int v1 = (e1.value[c] << 1) | e1.pbit;
+			for (int i = 0; i < 16; i++)
+				palette[i][c] = ((64 - BC7Weights[i]) * v0 + BC7Weights[i] * v1 + 32) >> 6;
+		}
+	}
+
+	int chooseBC7Indices(const BlockTexels& block, const BC7Endpoint& e0, const BC7Endpoint& e1, uint8_t indices[16])
+	{
+		int palette[16][4];
+		getBC7Palette(e0, e1, palette);
+
+		int error = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = std::numeric_limits<int>::max();
+			for (int p = 0; p < 16; p++)
+			{
+				int e = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					const int d = block[i][c] - palette[p][c];
+					e += d * d;
+				}
+				if (e < bestError)
+				{
+					bestError = e;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+			error += bestError;
+		}
+		return error;
+	}
+
+	struct BitWriter final
+	{
+		void Write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; i++, position++)
+				data[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (position & 7));
+		}
+
+		uint8_t* data;
+		int      position{ 0 };
+	};
+
+	struct BitReader final
+	{
+		uint32_t Read(int count)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < count; i++, position++)
+				value |= uint32_t((data[position >> 3] >> (position & 7)) & 1) << i;
+			return value;
+		}
+
+		const uint8_t* data;
+		int            position{ 0 };
+	};
+
+	void encodeBC7(const BlockTexels& block, uint8_t* output)
+	{
+		float mean[4], axis[4];
+		float e0[4], e1[4];
+		if (principalAxis<4>(block, mean, axis))
+		{
+			axisEndpoints<4>(block, mean, axis, e0, e1);
+		}
+		else
+		{
+			std::copy(mean, mean + 4, e0);
+			std::copy(mean, mean + 4, e1);
+		}
+
+		BC7Endpoint q0 = quantizeBC7Endpoint(e0);
+		BC7Endpoint q1 = quantizeBC7Endpoint(e1);
+		uint8_t indices[16];
+		int error = chooseBC7Indices(block, q0, q1, indices);
+
+		if (error > 0)
+		{
+			float weights[16];
+			for (int i = 0; i < 16; i++)
+				weights[i] = float(64 - BC7Weights[indices[i]]) / 64.0f;
+			if (refineEndpoints<4>(block, weights, e0, e1))
+			{
+				const BC7Endpoint r0 = quantizeBC7Endpoint(e0);
+				const BC7Endpoint r1 = quantizeBC7Endpoint(e1);
+				uint8_t refined[16];
+				const int refinedError = chooseBC7Indices(block, r0, r1, refined);
+				if (refinedError < error)
+				{
+					q0 = r0;
+					q1 = r1;
+					std::memcpy(indices, refined, sizeof(indices));
+				}
+			}
+		}
+
+		// the msb of the first index is implicit zero
+		if (indices[0] >= 8)
+		{
+			std::swap(q0, q1);
+			for (uint8_t& index : indices)
+				index = static_cast<uint8_t>(15 - index);
+		}
+
+		std::memset(output, 0, 16);
+		BitWriter writer{ output };
+		writer.Write(1u << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(q0.value[c], 7);
+			writer.Write(q1.value[c], 7);
+		}
+		writer.Write(q0.pbit, 1);
+		writer.Write(q1.pbit, 1);
+		writer.Write(indices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writer.Write(indices[i], 4);
+	}
+
+	// only mode 6, the one the encoder writes. Other modes decode to magenta
+	void decodeBC7(const uint8_t* input, BlockTexels& block)
+	{
+		BitReader reader{ input };
+		if (reader.Read(7) != (1u << 6))
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				block[i][0] = 255; block[i][1] = 0; block[i][2] = 255; block[i][3] = 255;
+			}
+			return;
+		}
+
+		BC7Endpoint e0{}, e1{};
+		for (int c = 0; c < 4; c++)
+		{
+			e0.value[c] = static_cast<uint8_t>(reader.Read(7));
+			e1.value[c] = static_cast<uint8_t>(reader.Read(7));
+		}
+		e0.pbit = static_cast<uint8_t>(reader.Read(1));
+		e1.pbit = static_cast<uint8_t>(reader.Read(1));
+
+		int palette[16][4];
+		getBC7Palette(e0, e1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			const uint32_t index = reader.Read(i == 0 ? 3 : 4);
+			for (int c = 0; c < 4; c++)
+				block[i][c] = static_cast<uint8_t>(palette[index][c]);
+		}
+	}
+
+	//-------------------------------------------------------------------------
+	void encodeBlock(texcompress::BlockFormat format, const BlockTexels& block, uint8_t* output)
+	{
+		switch (format)
+		{
+		case texcompress::BlockFormat::BC1:
+			encodeBC1(block, output);
+			break;
+		case texcompress::BlockFormat::BC3:
+			encodeBC4(block, 3, output);
+			encodeBC1(block, output + 8);
+			break;
+		case texcompress::BlockFormat::BC4:
+			encodeBC4(block, 0, output);
+			break;
+		case texcompress::BlockFormat::BC5:
+			encodeBC4(block, 0, output);
+			encodeBC4(block, 1, output + 8);
+			break;
+		case texcompress::BlockFormat::BC7:
+			encodeBC7(block, output);
+			break;
+		}
+	}
+
+	void decodeBlock(texcompress::BlockFormat format, const uint8_t* input, BlockTexels& block)
+	{
+		switch (format)
+		{
+		case texcompress::BlockFormat::BC1:
+			decodeBC1(input, false, block);
+			break;
+		case texcompress::BlockFormat::BC3:
+			decodeBC1(input + 8, true, block);
+			decodeBC4(input, 3, block);
+			break;
+		case texcompress::BlockFormat::BC4:
+			std::memset(block, 0, sizeof(BlockTexels));
+			decodeBC4(input, 0, block);
+			for (int i = 0; i < 16; i++) block[i][3] = 255;
+			break;
+		case texcompress::BlockFormat::BC5:
+			std::memset(block, 0, sizeof(BlockTexels));
+			decodeBC4(input, 0, block);
+			decodeBC4(input + 8, 1, block);
+			for (int i = 0; i < 16; i++) block[i][3] = 255;
+			break;
+		case texcompress::BlockFormat::BC7:
+			decodeBC7(input, block);
+			break;
+		}
+	}
+
+	// channels that the format stores and the PSNR compares
+	uint32_t getStoredChannels(texcompress::BlockFormat format)
+	{
+		switch (format)
+		{
+		case texcompress::BlockFormat::BC1: return 3;
+		case texcompress::BlockFormat::BC4: return 1;
+		case texcompress::BlockFormat::BC5: return 2;
+		default:                            return 4;
+		}
+	}
+}
+//=============================================================================
+void texcompress::Init()
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	supportS3TC = IsExtensionSupported("GL_EXT_texture_compression_s3tc");
+	supportS3TCsRGB = supportS3TC && (IsExtensionSupported("GL_EXT_texture_sRGB") || IsExtensionSupported("GL_EXT_texture_compression_s3tc_srgb"));
+	supportBPTC = major > 4 || (major == 4 && minor >= 2) || IsExtensionSupported("GL_ARB_texture_compression_bptc");
+}
+//=============================================================================
+bool texcompress::IsSupported(BlockFormat format, ColorSpace colorSpace)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC3: return colorSpace == ColorSpace::sRGB ? supportS3TCsRGB : supportS3TC;
+	case BlockFormat::BC7: return supportBPTC;
+	default:               return true; // RGTC is core since GL 3.0
+	}
+}
+//=============================================================================
+std::optional<texcompress::BlockFormat> texcompress::ChooseFormat(TextureUsage usage, uint32_t components, bool hasAlpha, ColorSpace colorSpace)
+{
+	if (usage == TextureUsage::Uncompressed || components == 0 || components > 4)
+		return std::nullopt;
+
+	if (usage == TextureUsage::Mask || components == 1)
+		return BlockFormat::BC4;
+	if (usage == TextureUsage::NormalMap || components == 2)
+		return BlockFormat::BC5;
+
+	if (!hasAlpha)
+	{
+		if (IsSupported(BlockFormat::BC1, colorSpace)) return BlockFormat::BC1;
+	}
+	else
+	{
+		if (IsSupported(BlockFormat::BC7, colorSpace)) return BlockFormat::BC7;
+		if (IsSupported(BlockFormat::BC3, colorSpace)) return BlockFormat::BC3;
+	}
+	return std::nullopt;
+}
+//=============================================================================
+bool texcompress::HasAlpha(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components)
+{
+	if (components != 4) return false;
+
+	const size_t count = size_t(width) * height;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (pixels[i * 4 + 3] != 255) return true;
+	}
+	return false;
+}
+//=============================================================================
+InternalFormat texcompress::GetInternalFormat(BlockFormat format, ColorSpace colorSpace)
+{
+	const bool sRGB = colorSpace == ColorSpace::sRGB;
+	switch (format)
+	{
+	case BlockFormat::BC1: return sRGB ? InternalFormat::BC1_SRGB : InternalFormat::BC1;
+	case BlockFormat::BC3: return sRGB ? InternalFormat::BC3_SRGB : InternalFormat::BC3;
+	case BlockFormat::BC4: return InternalFormat::BC4;
+	case BlockFormat::BC5: return InternalFormat::BC5;
+	case BlockFormat::BC7: return sRGB ? InternalFormat::BC7_SRGB : InternalFormat::BC7;
+	default: std::unreachable();
+	}
+}
+//=============================================================================
+PixelFormat texcompress::GetPixelFormat(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return PixelFormat::Rgb;
+	case BlockFormat::BC4: return PixelFormat::Red;
+	case BlockFormat::BC5: return PixelFormat::Rg;
+	default:               return PixelFormat::Rgba;
+	}
+}
+//=============================================================================
+size_t texcompress::GetBlockSize(BlockFormat format)
+{
+	return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+//=============================================================================
+size_t texcompress::GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+{
+	return size_t((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+//=============================================================================
+void texcompress::Encode(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components, uint8_t* output)
+{
+	if (!pixels || width == 0 || height == 0 || components == 0 || components > 4)
+		return;
+
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockSize = GetBlockSize(format);
+	auto encodeRow = [&](size_t blockY)
+		{
+			uint8_t* rowOutput = output + blockY * blocksX * blockSize;
+			for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+			{
+				BlockTexels block;
+				fetchBlock(pixels, width, height, components, blockX, static_cast<uint32_t>(blockY), block);
+				encodeBlock(format, block, rowOutput + blockX * blockSize);
+			}
+		};
+
+	// small mip levels are not worth the job overhead
+	if (size_t(blocksX) * blocksY < 256)
+	{
+		for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+			encodeRow(blockY);
+	}
+	else
+	{
+		jobs::ParallelFor(blocksY, encodeRow);
+	}
+}
+//=============================================================================
+void texcompress::Decode(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba)
+{
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockSize = GetBlockSize(format);
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+		{
+			BlockTexels block;
+			decodeBlock(format, blocks + (size_t(blockY) * blocksX + blockX) * blockSize, block);
+			for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+					std::memcpy(rgba + (size_t(blockY * 4 + y) * width + blockX * 4 + x) * 4, block[y * 4 + x], 4);
+			}
+		}
+	}
+}
+//=============================================================================
+double texcompress::ComputePSNR(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components, const uint8_t* decodedRGBA)
+{
+	const uint32_t channels = getStoredChannels(format);
+	const size_t count = size_t(width) * height;
+	double sum = 0.0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint8_t* source = pixels + i * components;
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			const int expected = c < components ? source[c] : (c == 3 ? 255 : 0);
+			const double d = double(expected) - double(decodedRGBA[i * 4 + c]);
+			sum += d * d;
+		}
+	}
+	const double mse = sum / double(count * channels);
+	if (mse <= 0.0) return std::numeric_limits<double>::infinity();
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+//=============================================================================
+double texcompress::MeasurePSNR(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components)
+{
+	std::vector<uint8_t> blocks(GetCompressedSize(format, width, height));
+	std::vector<uint8_t> decoded(size_t(width) * height * 4);
+	Encode(format, pixels, width, height, components, blocks.data());
+	Decode(format, blocks.data(), width, height, decoded.data());
+	return ComputePSNR(format, pixels, width, height, components, decoded.data());
+}
+//=============================================================================
+std::string_view texcompress::GetName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC4: return "BC4";
+	case BlockFormat::BC5: return "BC5";
+	case BlockFormat::BC7: return "BC7";
+	default: std::unreachable();
+	}
+}
+//=============================================================================
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "NanoOpenGL3.h"
+
+// What a texture holds, selects the block compression of its cooked file
+enum class TextureUsage : uint8_t
+{
+	Color,     // BC1, with alpha BC7 (BC3 without BPTC support)
+	NormalMap, // BC5 from red and green, shaders rebuild z
+	Mask,      // BC4 from red (AO, opacity, shininess)
+	Uncompressed
+};
+
+// CPU block compression of 8 bit images into 4x4 blocks. Block rows are encoded on the job system.
+namespace texcompress
+{
+	enum class BlockFormat : uint8_t
+	{
+		BC1, // RGB, 8 bytes per block
+		BC3, // RGBA, BC1 color + BC4 alpha, 16 bytes
+		BC4, // R, 8 bytes
+		BC5, // RG, two BC4 blocks, 16 bytes
+		BC7  // RGBA, mode 6 only, 16 bytes
+	};
+
+	// GL thread, after the context is created. Reads the S3TC and BPTC extensions
+	void Init();
+	// safe from the job threads after Init. sRGB BC1/BC3 need EXT_texture_sRGB besides S3TC
+	bool IsSupported(BlockFormat format, ColorSpace colorSpace);
+
+	// nullopt - keep the texture uncompressed. 'hasAlpha' is false when every alpha value is 255
+	std::optional<BlockFormat> ChooseFormat(TextureUsage usage, uint32_t components, bool hasAlpha, ColorSpace colorSpace);
+	bool HasAlpha(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components);
+
+	InternalFormat GetInternalFormat(BlockFormat format, ColorSpace colorSpace);
+	PixelFormat GetPixelFormat(BlockFormat format);
+	size_t GetBlockSize(BlockFormat format);
+	size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+	// 'pixels' has 'components' (1..4) bytes per texel, missing channels read as 0 and alpha as 255.
+	// 'output' must hold GetCompressedSize() bytes. Edge blocks repeat the last row and column
+	void Encode(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components, uint8_t* output);
+	// back to RGBA8 (width * height * 4 bytes), BC4 and BC5 return 0 in the channels they do not store
+	void Decode(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba);
+
+	// peak signal to noise ratio over the channels the format stores, for checking the encoder quality
+	double ComputePSNR(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components, const uint8_t* decodedRGBA);
+	// encodes, decodes and compares in one call
+	double MeasurePSNR(BlockFormat format, const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t components);
+
+	std::string_view GetName(BlockFormat format);
+} // namespace texcompress
@@ -1,16 +1,20 @@
 ﻿#include "stdafx.h"
 #include "NanoRenderTextures.h"
+#include "NanoRenderTextureCache.h"
 #include "NanoCore.h"
 #include "NanoLog.h"
 #include "NanoIO.h"
+#include "NanoJobs.h"
+#include "OGLStateCache.h"
 //=============================================================================
 struct TextureCache final
 {
 	bool operator==(const TextureCache&) const noexcept = default;
 
-	std::string name;
-	bool sRGB;
-	bool flipVertical;
+	std::string  name;
+	bool         sRGB;
+	bool         flipVertical;
+	TextureUsage usage;
 };
 //=============================================================================
 namespace std
@@ -23,20 +27,418 @@ namespace std
 			std::size_t h1 = std::hash<std::string>{}(tc.name);
 			std::size_t h2 = std::hash<bool>{}(tc.sRGB);
 			std::size_t h3 = std::hash<bool>{}(tc.flipVertical);
+			std::size_t h4 = std::hash<uint8_t>{}(static_cast<uint8_t>(tc.usage));
 			std::size_t seed = 0;
-			HashCombine(seed, h1, h2, h3);
+			HashCombine(seed, h1, h2, h3, h4);
 			return seed;
 		}
 	};
 }
 //=============================================================================
+// Same image and load flags give the same GL texture, whatever the name. Files are hashed by their decoded pixels
+// (stored in the cooked header), embedded images by their encoded bytes
+struct TextureContent final
+{
+	bool operator==(const TextureContent&) const noexcept = default;
+
+	uint64_t     hash;
+	bool         sRGB;
+	bool         flipVertical;
+	TextureUsage usage;
+};
+//=============================================================================
+namespace std
+{
+	template<>
+	struct hash<TextureContent>
+	{
+		std::size_t operator()(const TextureContent& tc) const noexcept
+		{
+			std::size_t seed = static_cast<std::size_t>(tc.hash);
+			HashCombine(seed, tc.sRGB, tc.flipVertical, static_cast<uint8_t>(tc.usage));
+			return seed;
+		}
+	};
+}
+//=============================================================================
+// Decode job of one texture. The GL texture exists from the start and shows a 1x1 placeholder until the upload
+struct TextureLoadState final
+{
+	std::string          name;
+	Texture2D            texture;
+	InternalFormat       internalFormat{};
+	ColorSpace           colorSpace{ ColorSpace::Linear };
+	bool                 flipVertical{ false };
+	TextureUsage         usage{ TextureUsage::Uncompressed };
+	bool                 cook{ false }; // file loads write a cooked file for the next run
+	std::vector<uint8_t> encoded;       // embedded image, files are read by the job
+
+	// written by the decode job, read by the GL thread after 'decoded'. Cooked textures come with all mips, pixels only with level 0
+	std::unique_ptr<texturecache::CookedTexture> cooked;
+	stbi_uc*                                     pixels{ nullptr };
+	std::optional<uint64_t>                      contentHash; // file loads, HashBytes of the decoded level 0 as in the cooked header
+	std::atomic<bool>                            decoded{ false };
+};
+//=============================================================================
 namespace
 {
+	constexpr size_t PixelBufferCount = 3;
+
 	std::unordered_map<TextureCache, Texture2D> texturesMap;
+	std::unordered_map<TextureContent, GLuint> contentMap;
+	size_t dedupHits{ 0 };
 	Texture2D defaultWhite2D;
 	Texture2D defaultDiffuse2D;
 	Texture2D defaultNormal2D;
 	Texture2D defaultSpecular2D;
+
+	struct TextureResidency final
+	{
+		std::vector<TextureCache> keys; // the first one loaded the texture, others have the same content
+		std::optional<TextureContent> content; // a file without a cooked file is known after its decode job
+		size_t       bytes{ 0 };
+		uint32_t     refCount{ 0 }; // one per returned load and per material, only unreferenced textures are evicted
+		bool         pending{ true };
+		uint64_t     lastUse{ 0 };
+	};
+
+	size_t uploadBudget{ 8 * 1024 * 1024 };
+	std::vector<std::shared_ptr<TextureLoadState>> pendingTextures;
+	std::unordered_map<GLuint, TextureResidency> residency;
+	size_t memoryBudget{ 1024 * 1024 * 1024 };
+	size_t residentBytes{ 0 };
+	uint64_t frameIndex{ 0 };
+	GLuint pixelBuffers[PixelBufferCount]{};
+	size_t nextPixelBuffer{ 0 };
+
+	bool getTextureFormat(int components, ColorSpace colorSpace, InternalFormat& internalFormat, PixelFormat& pixelFormat)
+	{
+		switch (components)
+		{
+		case 1:
+			internalFormat = InternalFormat::R8;
+			pixelFormat = PixelFormat::Red;
+			return true;
+		case 2:
+			internalFormat = InternalFormat::RG8;
+			pixelFormat = PixelFormat::Rg;
+			return true;
+		case 3:
+			internalFormat = (colorSpace == ColorSpace::sRGB) ? InternalFormat::SRGB8 : InternalFormat::RGB8;
+			pixelFormat = PixelFormat::Rgb;
+			return true;
+		case 4:
+			internalFormat = (colorSpace == ColorSpace::sRGB) ? InternalFormat::SRGB8_ALPHA8 : InternalFormat::RGBA8;
+			pixelFormat = PixelFormat::Rgba;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint32_t getComponents(PixelFormat pixelFormat)
+	{
+		switch (pixelFormat)
+		{
+		case PixelFormat::Red:  return 1;
+		case PixelFormat::Rg:   return 2;
+		case PixelFormat::Rgb:  return 3;
+		default:                return 4;
+		}
+	}
+
+	// full mip chain, drivers store RGB8 as RGBA8
+	size_t getTextureMemory(const Texture2D& texture, const texturecache::CookedTexture* cooked = nullptr)
+	{
+		if (cooked && texturecache::GetBlockFormat(cooked->GetFormat()))
+			return cooked->GetData().size();
+
+		const uint32_t components = getComponents(texture.pixelFormat);
+		const size_t texelSize = components == 3 ? 4 : components;
+		size_t bytes = 0;
+		uint32_t width = texture.width;
+		uint32_t height = texture.height;
+		while (true)
+		{
+			bytes += size_t(width) * height * texelSize;
+			if (width == 1 && height == 1) break;
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+		}
+		return bytes;
+	}
+
+	size_t evictTextures(size_t bytesToFree)
+	{
+		std::vector<std::pair<uint64_t, GLuint>> candidates;
+		for (const auto& [handle, entry] : residency)
+		{
+			if (entry.refCount == 0 && !entry.pending)
+				candidates.emplace_back(entry.lastUse, handle);
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		size_t freed = 0;
+		size_t count = 0;
+		for (const auto& [lastUse, handle] : candidates)
+		{
+			if (freed >= bytesToFree) break;
+
+			auto it = residency.find(handle);
+			freed += it->second.bytes;
+			for (const TextureCache& key : it->second.keys)
+				texturesMap.erase(key);
+			if (it->second.content) contentMap.erase(*it->second.content);
+			residency.erase(it);
+
+			Texture2DHandle texture{ handle };
+			Destroy(texture);
+			count++;
+		}
+		residentBytes -= freed;
+		if (count > 0)
+			Debug("Textures evicted: " + std::to_string(count) + " (" + std::to_string(freed / 1024) + " KB)");
+		return count;
+	}
+
+	// The upload replaces the image, possibly with a block compressed format. Immutable storage of the DSA backend
+	// cannot be respecified, so the placeholder always gets glTexImage2D
+	Texture2DHandle createPlaceholder(InternalFormat internalFormat, PixelFormat pixelFormat, const uint8_t* pixels)
+	{
+		const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D);
+
+		Texture2DHandle texture;
+		glGenTextures(1, &texture.handle);
+		glBindTexture(GL_TEXTURE_2D, texture.handle);
+		glTexImage2D(GL_TEXTURE_2D, 0, EnumToValue(internalFormat), 1, 1, 0, EnumToValue(pixelFormat), GL_UNSIGNED_BYTE, pixels);
+		glBindTexture(GL_TEXTURE_2D, currentTexture);
+		return texture;
+	}
+
+	// Creates the texture with its final format and a 1x1 placeholder image. Linear RGB is mostly normal maps, they get a flat normal
+	std::shared_ptr<TextureLoadState> beginLoad(std::string_view name, int width, int height, int components, ColorSpace colorSpace, bool flipVertical)
+	{
+		InternalFormat internalFormat{};
+		PixelFormat pixelFormat{ PixelFormat::None };
+		if (width <= 0 || height <= 0 || !getTextureFormat(components, colorSpace, internalFormat, pixelFormat))
+			return nullptr;
+
+		const uint8_t grey[4] = { 128, 128, 128, 255 };
+		const uint8_t flatNormal[4] = { 128, 128, 255, 255 };
+		const uint8_t* placeholder = (components == 3 && colorSpace == ColorSpace::Linear) ? flatNormal : grey;
+
+		auto state = std::make_shared<TextureLoadState>();
+		state->name = name;
+		state->internalFormat = internalFormat;
+		state->colorSpace = colorSpace;
+		state->flipVertical = flipVertical;
+		state->texture.id = createPlaceholder(internalFormat, pixelFormat, placeholder);
+		state->texture.pixelFormat = pixelFormat;
+		state->texture.width = static_cast<uint32_t>(width);
+		state->texture.height = static_cast<uint32_t>(height);
+
+		TextureConfig texConfig{
+			.minFilter = TextureFilter::LinearMipmapLinear,
+			.magFilter = TextureFilter::Linear,
+			.wrapS = TextureWrap::Repeat,
+			.wrapT = TextureWrap::Repeat,
+			.generateMipmaps = false
+		};
+		SetTextureParameters(state->texture.id, texConfig);
+		return state;
+	}
+
+	// reads one byte per page so that the page faults of the mapping happen on the worker and not in the upload
+	void prefetch(std::span<const uint8_t> data)
+	{
+		uint8_t sum = 0;
+		for (size_t i = 0; i < data.size(); i += 4096)
+			sum ^= data[i];
+		// the store keeps the reads from being optimized away
+		static std::atomic<uint8_t> sink{ 0 };
+		sink.store(sum, std::memory_order_relaxed);
+	}
+
+	void decodeTexture(TextureLoadState& state)
+	{
+		if (state.cooked)
+		{
+			prefetch(state.cooked->GetData());
+			return;
+		}
+
+		// the flip flag of stb_image is global, the thread local one overrides it for this worker
+		stbi_set_flip_vertically_on_load_thread(state.flipVertical);
+
+		const int components = static_cast<int>(getComponents(state.texture.pixelFormat));
+		int width, height, fileComponents;
+		if (state.encoded.empty())
+			state.pixels = stbi_load(state.name.c_str(), &width, &height, &fileComponents, components);
+		else
+			state.pixels = stbi_load_from_memory(state.encoded.data(), static_cast<int>(state.encoded.size()), &width, &height, &fileComponents, components);
+
+		if (state.pixels && (static_cast<uint32_t>(width) != state.texture.width || static_cast<uint32_t>(height) != state.texture.height))
+		{
+			stbi_image_free(state.pixels);
+			state.pixels = nullptr;
+		}
+		state.encoded.clear();
+		state.encoded.shrink_to_fit();
+
+		if (state.pixels && state.cook)
+		{
+			state.contentHash = HashBytes(state.pixels, size_t(state.texture.width) * state.texture.height * components);
+
+			const texturecache::CookedTextureKey cacheKey{ state.colorSpace, state.flipVertical, state.usage };
+			const std::string cachePath = texturecache::GetCachePath(state.name, cacheKey);
+			auto cooked = std::make_unique<texturecache::CookedTexture>();
+			if (texturecache::Save(cachePath, cacheKey, state.pixels, state.texture.width, state.texture.height, static_cast<uint32_t>(components))
+				&& cooked->Open(cachePath, cacheKey))
+			{
+				stbi_image_free(state.pixels);
+				state.pixels = nullptr;
+				state.cooked = std::move(cooked);
+			}
+		}
+	}
+
+	// Copies the pixels into the next buffer of the ring. Buffers are orphaned on reuse, so the copy never waits for the GPU
+	void uploadTexture(const TextureLoadState& state)
+	{
+		const Texture2D& texture = state.texture;
+		const uint8_t* source = state.cooked ? state.cooked->GetData().data() : state.pixels;
+		const size_t size = state.cooked ? state.cooked->GetData().size() : size_t(texture.width) * texture.height * getComponents(texture.pixelFormat);
+
+		GLuint& pixelBuffer = pixelBuffers[nextPixelBuffer];
+		nextPixelBuffer = (nextPixelBuffer + 1) % PixelBufferCount;
+		if (!pixelBuffer) glGenBuffers(1, &pixelBuffer);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+		bool mapped = false;
+		if (void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT))
+		{
+			std::memcpy(dst, source, size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			mapped = true;
+		}
+		else
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		// offset in the pixel buffer or client memory
+		auto getPixels = [&](size_t offset) { return mapped ? reinterpret_cast<const void*>(offset) : static_cast<const void*>(source + offset); };
+
+		const GLint alignment = GetPixelStore(GL_UNPACK_ALIGNMENT);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		const GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D);
+
+		glBindTexture(GL_TEXTURE_2D, texture.id.handle);
+		const std::optional<texcompress::BlockFormat> blockFormat = state.cooked ? texturecache::GetBlockFormat(state.cooked->GetFormat()) : std::nullopt;
+		if (blockFormat)
+		{
+			// the levels replace the uncompressed placeholder
+			const GLint internalFormat = EnumToValue(texcompress::GetInternalFormat(*blockFormat, state.colorSpace));
+			for (size_t level = 0; level < state.cooked->GetNumLevels(); level++)
+			{
+				const texturecache::CookedLevel& mip = state.cooked->GetLevel(level);
+				glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), static_cast<GLenum>(internalFormat), static_cast<GLsizei>(mip.width), static_cast<GLsizei>(mip.height), 0, static_cast<GLsizei>(mip.data.size()), getPixels(static_cast<size_t>(mip.data.data() - source)));
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(state.cooked->GetNumLevels() - 1));
+		}
+		else if (state.cooked)
+		{
+			for (size_t level = 0; level < state.cooked->GetNumLevels(); level++)
+			{
+				const texturecache::CookedLevel& mip = state.cooked->GetLevel(level);
+				glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), EnumToValue(state.internalFormat), static_cast<GLsizei>(mip.width), static_cast<GLsizei>(mip.height), 0, EnumToValue(texture.pixelFormat), GL_UNSIGNED_BYTE, getPixels(static_cast<size_t>(mip.data.data() - source)));
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(state.cooked->GetNumLevels() - 1));
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, EnumToValue(state.internalFormat), static_cast<GLsizei>(texture.width), static_cast<GLsizei>(texture.height), 0, EnumToValue(texture.pixelFormat), GL_UNSIGNED_BYTE, getPixels(0));
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, currentTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	void finishLoad(TextureLoadState& state)
+	{
+		auto it = residency.find(state.texture.id.handle);
+		if (it != residency.end()) it->second.pending = false;
+
+		if (state.pixels || state.cooked)
+		{
+			// a file load without a cooked file knows the content after its decode job, later loads of the same image
+			// share the texture whether or not the cooking succeeded
+			if (it != residency.end() && !it->second.content && state.contentHash)
+			{
+				const TextureContent content = { .hash = *state.contentHash, .sRGB = state.colorSpace == ColorSpace::sRGB, .flipVertical = state.flipVertical, .usage = state.usage };
+				if (contentMap.try_emplace(content, state.texture.id.handle).second)
+					it->second.content = content;
+			}
+			uploadTexture(state);
+			// block compressed textures are known to be smaller only after the decode job
+			if (it != residency.end())
+			{
+				const size_t bytes = getTextureMemory(state.texture, state.cooked.get());
+				residentBytes = residentBytes - it->second.bytes + bytes;
+				it->second.bytes = bytes;
+			}
+			Debug("Load Texture: " + state.name);
+		}
+		else
+		{
+			Error("Failed to load texture " + state.name);
+		}
+		stbi_image_free(state.pixels);
+		state.pixels = nullptr;
+		state.cooked.reset();
+	}
+
+	// an already loaded texture with the same content becomes the texture of 'key' too
+	std::optional<Texture2D> findContent(const TextureCache& key, const TextureContent& content)
+	{
+		auto it = contentMap.find(content);
+		if (it == contentMap.end()) return std::nullopt;
+
+		TextureResidency& entry = residency[it->second];
+		entry.keys.push_back(key);
+		entry.refCount++;
+		entry.lastUse = frameIndex;
+		dedupHits++;
+
+		const Texture2D texture = texturesMap[entry.keys.front()];
+		texturesMap[key] = texture;
+		Debug("Load Texture: " + key.name + " (same content as " + entry.keys.front().name + ")");
+		return texture;
+	}
+
+	Texture2D submitLoad(const TextureCache& key, const std::optional<TextureContent>& content, std::shared_ptr<TextureLoadState> state)
+	{
+		// before the job starts, it may replace 'cooked'
+		TextureResidency& entry = residency[state->texture.id.handle];
+		entry.keys = { key };
+		entry.content = content;
+		entry.bytes = getTextureMemory(state->texture, state->cooked.get());
+		entry.refCount = 1;
+		entry.lastUse = frameIndex;
+		residentBytes += entry.bytes;
+		texturesMap[key] = state->texture;
+		if (content) contentMap[*content] = state->texture.id.handle;
+
+		pendingTextures.push_back(state);
+		jobs::Submit([state]
+			{
+				decodeTexture(*state);
+				state->decoded.store(true, std::memory_order_release);
+			});
+		return state->texture;
+	}
 }
 //=============================================================================
 bool IsValid(Texture2D tex)
@@ -51,9 +453,26 @@ void Destroy(Texture2D& tex)
 	tex.width = tex.height = 0;
 }
 //=============================================================================
+namespace
+{
+	Texture2DHandle createDefaultTexture(InternalFormat internalFormat, unsigned size, const uint8_t* rgb, bool generateMipmaps)
+	{
+		const Texture2DHandle texture = CreateTexture2D(size, size, internalFormat, PixelFormat::Rgb, PixelType::UnsignedByte, rgb);
+		const TextureConfig config{
+			.minFilter = TextureFilter::Nearest,
+			.magFilter = TextureFilter::Nearest,
+			.wrapS = TextureWrap::Repeat,
+			.wrapT = TextureWrap::Repeat,
+			.generateMipmaps = generateMipmaps
+		};
+		SetTextureParameters(texture, config);
+		return texture;
+	}
+}
+//=============================================================================
 bool textures::Init()
 {
-	GLuint currentTexture = GetCurrentTexture(GL_TEXTURE_2D);
+	texcompress::Init();
 
 	// Create white texture
 	{
@@ -72,13 +491,7 @@ bool textures::Init()
 		defaultWhite2D.pixelFormat = PixelFormat::Rgb;
 		defaultWhite2D.width = SizeTexture;
 		defaultWhite2D.height = SizeTexture;
-		glGenTextures(1, &defaultWhite2D.id.handle);
-		glBindTexture(GL_TEXTURE_2D, defaultWhite2D.id.handle);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, SizeTexture, SizeTexture, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		defaultWhite2D.id = createDefaultTexture(InternalFormat::RGB8, SizeTexture, &data[0][0][0], false);
 	}
 
 	// Create default diffuse texture
@@ -107,14 +520,7 @@ bool textures::Init()
 		defaultDiffuse2D.pixelFormat = PixelFormat::Rgb;
 		defaultDiffuse2D.width = SizeTexture;
 		defaultDiffuse2D.height = SizeTexture;
-		glGenTextures(1, &defaultDiffuse2D.id.handle);
-		glBindTexture(GL_TEXTURE_2D, defaultDiffuse2D.id.handle);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, SizeTexture, SizeTexture, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		defaultDiffuse2D.id = createDefaultTexture(InternalFormat::SRGB8, SizeTexture, &data[0][0][0], true);
 	}
 
 	// Create default normal texture
@@ -134,14 +540,7 @@ bool textures::Init()
 		defaultNormal2D.pixelFormat = PixelFormat::Rgb;
 		defaultNormal2D.width = SizeTexture;
 		defaultNormal2D.height = SizeTexture;
-		glGenTextures(1, &defaultNormal2D.id.handle);
-		glBindTexture(GL_TEXTURE_2D, defaultNormal2D.id.handle);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, SizeTexture, SizeTexture, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		defaultNormal2D.id = createDefaultTexture(InternalFormat::RGB8, SizeTexture, &data[0][0][0], true);
 	}
 
 	// Create default specular texture
@@ -161,18 +560,9 @@ bool textures::Init()
 		defaultSpecular2D.pixelFormat = PixelFormat::Rgb;
 		defaultSpecular2D.width = SizeTexture;
 		defaultSpecular2D.height = SizeTexture;
-		glGenTextures(1, &defaultSpecular2D.id.handle);
-		glBindTexture(GL_TEXTURE_2D, defaultSpecular2D.id.handle);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, SizeTexture, SizeTexture, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		defaultSpecular2D.id = createDefaultTexture(InternalFormat::RGB8, SizeTexture, &data[0][0][0], true);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, currentTexture);
-
 	return true;
 }
 //=============================================================================
@@ -183,11 +573,26 @@ void textures::Close()
 	Destroy(defaultNormal2D.id);
 	Destroy(defaultSpecular2D.id);
 
-	for (auto& it : texturesMap)
+	// jobs are stopped before, loads that are not decoded never will be
+	for (auto& state : pendingTextures)
 	{
-		Destroy(it.second.id);
+		if (state->decoded.load(std::memory_order_acquire))
+			stbi_image_free(state->pixels);
 	}
+	pendingTextures.clear();
+	glDeleteBuffers(PixelBufferCount, pixelBuffers);
+	std::fill(std::begin(pixelBuffers), std::end(pixelBuffers), 0u);
+	// textures with the same content are in 'texturesMap' under several names
+	for (auto& it : residency)
+	{
+		Texture2DHandle texture{ it.first };
+		Destroy(texture);
+	}
+	residency.clear();
+	residentBytes = 0;
 	texturesMap.clear();
+	contentMap.clear();
+	dedupHits = 0;
 }
 //=============================================================================
 Texture2D textures::GetWhiteTexture2D()
@@ -210,12 +615,13 @@ Texture2D textures::GetDefaultSpecular2D()
 	return defaultSpecular2D;
 }
 //=============================================================================
-Texture2D textures::LoadTexture2D(const std::string& fileName, ColorSpace colorSpace, bool flipVertical)
+Texture2D textures::LoadTexture2D(const std::string& fileName, ColorSpace colorSpace, bool flipVertical, TextureUsage usage)
 {
-	TextureCache keyMap = { .name = fileName, .sRGB = colorSpace == ColorSpace::sRGB, .flipVertical = flipVertical};
+	TextureCache keyMap = { .name = fileName, .sRGB = colorSpace == ColorSpace::sRGB, .flipVertical = flipVertical, .usage = usage };
 	auto it = texturesMap.find(keyMap);
 	if (it != texturesMap.end() && IsValid(it->second))
 	{
+		AddRef(it->second);
 		return it->second;
 	}
 	else
@@ -227,135 +633,175 @@ Texture2D textures::LoadTexture2D(const std::string& fileName, ColorSpace colorS
 			return GetDefaultDiffuse2D();
 		}
 
-		stbi_set_flip_vertically_on_load(flipVertical);
-
+		// Only the header is read here, the job maps the cooked file or decodes the image and cooks it. The content
+		// hash comes from the cooked header, so the same image under another name is found without reading the source
+		const texturecache::CookedTextureKey cacheKey{ colorSpace, flipVertical, usage };
+		const std::string cachePath = texturecache::GetCachePath(fileName, cacheKey);
+		auto cooked = std::make_unique<texturecache::CookedTexture>();
 		int width, height, nrComponents;
-		stbi_uc* pixels = stbi_load(fileName.c_str(), &width, &height, &nrComponents, 0);
-		if (!pixels || nrComponents < 1 || nrComponents > 4 || width <= 0 || height <= 0)
+		std::shared_ptr<TextureLoadState> state;
+		std::optional<TextureContent> content;
+		if (io::IsNewerThan(cachePath, fileName) && cooked->Open(cachePath, cacheKey))
 		{
-			stbi_image_free(pixels);
-			Error("Failed to load texture " + fileName);
-			return GetDefaultDiffuse2D();
+			content = TextureContent{ .hash = cooked->GetContentHash(), .sRGB = keyMap.sRGB, .flipVertical = flipVertical, .usage = usage };
+			if (auto texture = findContent(keyMap, *content))
+				return *texture;
+			state = beginLoad(fileName, static_cast<int>(cooked->GetWidth()), static_cast<int>(cooked->GetHeight()), static_cast<int>(texturecache::GetComponents(cooked->GetFormat())), colorSpace, flipVertical);
 		}
-
-		InternalFormat internalFormat{};
-		PixelFormat pixelFormat{ PixelFormat::None };
-		if (nrComponents == 1)
+		else if (stbi_info(fileName.c_str(), &width, &height, &nrComponents))
 		{
-			internalFormat = InternalFormat::R8;
-			pixelFormat = PixelFormat::Red;
+			cooked.reset();
+			state = beginLoad(fileName, width, height, nrComponents, colorSpace, flipVertical);
 		}
-		else if (nrComponents == 2)
+		if (!state)
 		{
-			internalFormat = InternalFormat::RG8;
-			pixelFormat = PixelFormat::Rg;
-		}
-		else if (nrComponents == 3)
-		{
-			internalFormat = (colorSpace == ColorSpace::sRGB) ? InternalFormat::SRGB8 : InternalFormat::RGB8;
-			pixelFormat = PixelFormat::Rgb;
-		}
-		else if (nrComponents == 4)
-		{
-			internalFormat = (colorSpace == ColorSpace::sRGB) ? InternalFormat::SRGB8_ALPHA8 : InternalFormat::RGBA8;
-			pixelFormat = PixelFormat::Rgba;
-		}
-		else
-		{
-			std::unreachable();
+			Error("Failed to load texture " + fileName);
+			return GetDefaultDiffuse2D();
 		}
-
-		Texture2DHandle textureID = CreateTexture2D(static_cast<uint32_t>(width), static_cast<uint32_t>(height), internalFormat, pixelFormat, PixelType::UnsignedByte, pixels);
-		TextureConfig texConfig{
-			.minFilter = TextureFilter::LinearMipmapLinear,
-			.magFilter = TextureFilter::Linear,
-			.wrapS = TextureWrap::Repeat,
-			.wrapT = TextureWrap::Repeat,
-			.generateMipmaps = true
-		};
-		SetTextureParameters(textureID, texConfig);
-
-		stbi_image_free(pixels);
-
-		Debug("Load Texture: " + fileName);
-
-		texturesMap[keyMap] = Texture2D{ 
-			.id = textureID, 
-			.pixelFormat = pixelFormat,
-			.width = static_cast<uint32_t>(width), 
-			.height = static_cast<uint32_t>(height)
-		};
-		return texturesMap[keyMap];
+		state->cooked = std::move(cooked);
+		state->usage = usage;
+		state->cook = true;
+		return submitLoad(keyMap, content, std::move(state));
 	}
 }
 //=============================================================================
 Texture2D textures::CreateTextureFromData(std::string_view name, aiTexture* embTex, ColorSpace colorSpace, bool flipVertical)
 {
-	TextureCache keyMap = { .name = name.data(), .sRGB = colorSpace == ColorSpace::sRGB, .flipVertical = flipVertical };
+	TextureCache keyMap = { .name = name.data(), .sRGB = colorSpace == ColorSpace::sRGB, .flipVertical = flipVertical, .usage = TextureUsage::Uncompressed };
 	auto it = texturesMap.find(keyMap);
 	if (it != texturesMap.end())
 	{
+		AddRef(it->second);
 		return it->second;
 	}
 	else
 	{
-		stbi_set_flip_vertically_on_load(flipVertical);
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(embTex->pcData);
+		const size_t size = (embTex->mHeight == 0) ? embTex->mWidth : size_t(embTex->mWidth) * embTex->mHeight;
+		const TextureContent content = { .hash = HashBytes(data, size), .sRGB = keyMap.sRGB, .flipVertical = flipVertical, .usage = keyMap.usage };
+		if (auto texture = findContent(keyMap, content))
+			return *texture;
 
 		int width, height, nrComponents;
-		stbi_uc* data{ nullptr };
-		if (embTex->mHeight == 0)
-			data = stbi_load_from_memory(reinterpret_cast<unsigned char*>(embTex->pcData), static_cast<int>(embTex->mWidth), &width, &height, &nrComponents, 0);
-		else
-			data = stbi_load_from_memory(reinterpret_cast<unsigned char*>(embTex->pcData), static_cast<int>(embTex->mWidth * embTex->mHeight), &width, &height, &nrComponents, 0);
-		if (!data || nrComponents < 1 || nrComponents > 4 || width <= 0 || height <= 0)
+		std::shared_ptr<TextureLoadState> state;
+		if (stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &nrComponents))
+			state = beginLoad(name, width, height, nrComponents, colorSpace, flipVertical);
+		if (!state)
 		{
-			stbi_image_free(data);
 			Error("Error while trying to load embedded texture!");
 			return GetDefaultDiffuse2D();
 		}
+		// the scene is released after the model upload, the job gets its own copy
+		state->encoded.assign(data, data + size);
+		return submitLoad(keyMap, content, std::move(state));
+	}
+}
+//=============================================================================
+void textures::SetUploadBudget(size_t bytesPerFrame)
+{
+	uploadBudget = bytesPerFrame;
+}
+//=============================================================================
+size_t textures::GetUploadBudget()
+{
+	return uploadBudget;
+}
+//=============================================================================
+void textures::UpdateUploads()
+{
+	frameIndex++;
 
-		InternalFormat internalFormat{};
-		PixelFormat pixelFormat{ PixelFormat::None };
-		if (nrComponents == 1)
-		{
-			internalFormat = InternalFormat::R8;
-			pixelFormat = PixelFormat::Red;
-		}
-		else if (nrComponents == 2)
-		{
-			internalFormat = InternalFormat::RG8;
-			pixelFormat = PixelFormat::Rg;
-		}
-		else if (nrComponents == 3)
-		{
-			internalFormat = (colorSpace == ColorSpace::sRGB) ? InternalFormat::SRGB8 : InternalFormat::RGB8;
-			pixelFormat = PixelFormat::Rgb;
-		}
-		else if (nrComponents == 4)
-		{
-			internalFormat = (colorSpace == ColorSpace::sRGB) ? InternalFormat::SRGB8_ALPHA8 : InternalFormat::RGBA8;
-			pixelFormat = PixelFormat::Rgba;
-		}
-		else
+	// at least one texture per frame so a small budget still makes progress
+	size_t budget = uploadBudget;
+	for (size_t i = 0; i < pendingTextures.size() && budget > 0;)
+	{
+		TextureLoadState& state = *pendingTextures[i];
+		if (!state.decoded.load(std::memory_order_acquire))
 		{
-			std::unreachable();
+			i++;
+			continue;
 		}
 
-		Texture2DHandle textureID = CreateTexture2D(static_cast<uint32_t>(width), static_cast<uint32_t>(height), internalFormat, pixelFormat, PixelType::UnsignedByte, data);
-		TextureConfig texConfig{
-			.minFilter = TextureFilter::LinearMipmapLinear,
-			.magFilter = TextureFilter::Linear,
-			.wrapS = TextureWrap::Repeat,
-			.wrapT = TextureWrap::Repeat,
-			.generateMipmaps = true
-		};
-		SetTextureParameters(textureID, texConfig);
-		
-		stbi_image_free(data);
+		finishLoad(state);
+		budget -= std::min(budget, size_t(state.texture.width) * state.texture.height * getComponents(state.texture.pixelFormat));
+		pendingTextures.erase(pendingTextures.begin() + static_cast<ptrdiff_t>(i));
+	}
 
-		Debug("Load Texture: " + std::string(name));
-		texturesMap[keyMap] = Texture2D{ .id = textureID, .width = (uint32_t)width, .height = (uint32_t)height };
-		return texturesMap[keyMap];
+	if (residentBytes > memoryBudget)
+		evictTextures(residentBytes - memoryBudget);
+}
+//=============================================================================
+void textures::FinishUploads()
+{
+	for (auto& state : pendingTextures)
+	{
+		while (!state->decoded.load(std::memory_order_acquire))
+			std::this_thread::yield();
+		finishLoad(*state);
+	}
+	pendingTextures.clear();
+}
+//=============================================================================
+size_t textures::GetNumPendingUploads()
+{
+	return pendingTextures.size();
+}
+//=============================================================================
+void textures::AddRef(const Texture2D& texture)
+{
+	auto it = residency.find(texture.id.handle);
+	if (it == residency.end()) return; // default textures
+
+	it->second.refCount++;
+	it->second.lastUse = frameIndex;
+}
+//=============================================================================
+void textures::Touch(Texture2DHandle texture)
+{
+	auto it = residency.find(texture.handle);
+	if (it != residency.end()) it->second.lastUse = frameIndex;
+}
+//=============================================================================
+void textures::Release(const Texture2D& texture)
+{
+	// also called for materials that outlive Close()
+	auto it = residency.find(texture.id.handle);
+	if (it == residency.end() || it->second.refCount == 0) return;
+
+	it->second.refCount--;
+	it->second.lastUse = frameIndex;
+}
+//=============================================================================
+void textures::SetMemoryBudget(size_t bytes)
+{
+	memoryBudget = bytes;
+}
+//=============================================================================
+size_t textures::GetMemoryBudget()
+{
+	return memoryBudget;
+}
+//=============================================================================
+size_t textures::GetResidentBytes()
+{
+	return residentBytes;
+}
+//=============================================================================
+size_t textures::EvictUnused()
+{
+	return evictTextures(std::numeric_limits<size_t>::max());
+}
+//=============================================================================
+TextureDedupStats textures::GetDedupStats()
+{
+	TextureDedupStats stats{};
+	stats.hits = dedupHits;
+	for (const auto& [handle, entry] : residency)
+	{
+		if (entry.keys.size() < 2) continue;
+		stats.sharedTextures++;
+		stats.savedBytes += entry.bytes * (entry.keys.size() - 1);
 	}
+	return stats;
 }
 //=============================================================================
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "NanoOpenGL3Advance.h"
+#include "NanoRenderTextureCompress.h"
 
 struct Texture2D final
 {
@@ -22,6 +23,13 @@ struct Texture2D final
 bool IsValid(Texture2D tex);
 void Destroy(Texture2D& tex);
 
+struct TextureDedupStats final
+{
+	size_t hits{ 0 };           // loads answered by a texture with the same content under another name
+	size_t sharedTextures{ 0 }; // resident textures that serve more than one name
+	size_t savedBytes{ 0 };     // GPU memory the resident duplicates would take
+};
+
 namespace textures
 {
 	bool Init();
@@ -31,6 +39,39 @@ namespace textures
 	Texture2D GetDefaultDiffuse2D();
 	Texture2D GetDefaultNormal2D();
 	Texture2D GetDefaultSpecular2D();
-	Texture2D LoadTexture2D(const std::string& fileName, ColorSpace colorSpace = ColorSpace::Linear, bool flipVertical = false);
+
+	// Returns at once with the final size and format. Pixels are decoded on the job system and uploaded
+	// in UpdateUploads(), until then the texture shows a 1x1 placeholder. 'usage' selects the block compression
+	// of the cooked file, only material textures ask for one (UI, lookup and data textures must stay exact).
+	// Embedded textures (CreateTextureFromData) stay uncompressed
+	Texture2D LoadTexture2D(const std::string& fileName, ColorSpace colorSpace = ColorSpace::Linear, bool flipVertical = false, TextureUsage usage = TextureUsage::Uncompressed);
 	Texture2D CreateTextureFromData(std::string_view name, aiTexture* embTex, ColorSpace colorSpace = ColorSpace::Linear, bool flipVertical = false);
+
+	void SetUploadBudget(size_t bytesPerFrame);
+	size_t GetUploadBudget();
+
+	// GL thread, called every frame by the engine
+	void UpdateUploads();
+	// waits for all pending textures (loading screens)
+	void FinishUploads();
+	size_t GetNumPendingUploads();
+
+	// Residency. Loaded textures count their GPU memory with mips. Every LoadTexture2D/CreateTextureFromData result
+	// holds a reference the caller gives back with Release, materials hold one more while a mesh uses them.
+	// Unreferenced textures are evicted (least recently bound first) once the budget is exceeded, the next Load
+	// reloads them
+	void AddRef(const Texture2D& texture);
+	void Release(const Texture2D& texture);
+	// marks the texture used this frame, BindTexture2D calls it
+	void Touch(Texture2DHandle texture);
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget();
+	size_t GetResidentBytes();
+	// drops every unreferenced texture, ignoring the budget. Returns the number of evicted textures
+	size_t EvictUnused();
+
+	// Loads of another name share the texture when the content and the load flags match. The content of a file is the
+	// hash of its decoded pixels, read from the cooked header or computed by the decode job (a file is found once its
+	// first load has finished decoding). Embedded images hash their encoded bytes
+	TextureDedupStats GetDedupStats();
 } // namespace textures
\ No newline at end of file
@@ -109,8 +109,13 @@ bool window::Init(uint16_t width, uint16_t height, std::string_view title, bool
 #else
 	hints->noError = true;
 #endif
+#if USE_OPENGL == VERSION_OPENGL46
+	hints->major = 4;
+	hints->minor = 6;
+#else
 	hints->major = 3;
 	hints->minor = 3;
+#endif
 
 	RGFW_setGlobalHints_OpenGL(hints);
 
@@ -1,5 +1,7 @@
 ﻿#include "stdafx.h"
 #include "OGLBuffer.h"
+#include "OGLDirectState.h"
+#include "OGLStateCache.h"
 //=============================================================================
 inline GLenum EnumToValue(BufferUsage mode) noexcept
 {
@@ -29,23 +31,18 @@ inline GLenum EnumToValue(BufferTarget type) noexcept
 //=============================================================================
 GLuint GetCurrentBuffer(BufferTarget target)
 {
-	GLenum glTarget = EnumToValue(target);
-	GLenum targetBinding{ 0 };
-	switch (glTarget)
-	{
-	case GL_ARRAY_BUFFER:         targetBinding = GL_ARRAY_BUFFER_BINDING; break;
-	case GL_ELEMENT_ARRAY_BUFFER: targetBinding = GL_ELEMENT_ARRAY_BUFFER_BINDING; break;
-	case GL_UNIFORM_BUFFER:       targetBinding = GL_UNIFORM_BUFFER_BINDING; break;
-	default: std::unreachable(); break;
-	}
-	GLuint currentBuffer{ 0 };
-	glGetIntegerv(targetBinding, (GLint*)&currentBuffer);
-
-	return currentBuffer;
+	return GetBoundBuffer(EnumToValue(target));
 }
 //=============================================================================
 BufferHandle CreateBuffer(BufferTarget target, BufferUsage usage, size_t size, const void* data)
 {
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)target;
+	BufferHandle buffer{};
+	dsa::CreateBuffers(1, &buffer.handle);
+	dsa::NamedBufferData(buffer.handle, static_cast<GLsizeiptr>(size), data, EnumToValue(usage));
+	return buffer;
+#else
 	GLuint currentBuffer = GetCurrentBuffer(target);
 	GLenum glTarget = EnumToValue(target);
 
@@ -56,15 +53,21 @@ BufferHandle CreateBuffer(BufferTarget target, BufferUsage usage, size_t size, c
 	glBindBuffer(glTarget, currentBuffer);
 
 	return buffer;
+#endif
 }
 //=============================================================================
 void BufferSubData(BufferHandle bufferId, BufferTarget target, GLintptr offset, GLsizeiptr size, const void* data)
 {
+#if USE_OPENGL == VERSION_OPENGL46
+	(void)target;
+	dsa::NamedBufferSubData(bufferId.handle, offset, size, data);
+#else
 	GLuint currentBuffer = GetCurrentBuffer(target);
 	GLenum glTarget = EnumToValue(target);
 
 	glBindBuffer(glTarget, bufferId.handle);
 	glBufferSubData(glTarget, offset, size, data);
 	glBindBuffer(glTarget, currentBuffer);
+#endif
 }
 //=============================================================================
\ No newline at end of file
@@ -20,6 +20,7 @@ enum class BufferUsage : uint8_t
 	StreamCopy
 };
 
+// read from the state cache, no glGet
 GLuint GetCurrentBuffer(BufferTarget target);
 
 //=============================================================================
@@ -31,6 +32,8 @@ struct BufferHandle final { GLuint handle{ 0u }; };
 // Buffer
 //=============================================================================
 
+// With USE_OPENGL == VERSION_OPENGL46 the buffer is created and filled by name, the bindings are not touched.
+// Otherwise the buffer is bound to 'target' and the previous binding is restored
 BufferHandle CreateBuffer(BufferTarget target, BufferUsage usage, size_t size, const void* data);
 
 void BufferSubData(BufferHandle bufferId, BufferTarget target, GLintptr offset, GLsizeiptr size, const void* data);
\ No newline at end of file
@@ -1,5 +1,9 @@
 ﻿#include "stdafx.h"
 #include "OGLContext.h"
+#include "OGLDirectState.h"
+#include "OGLShaderCache.h"
+#include "OGLShaderVariants.h"
+#include "OGLStateCache.h"
 #include "NanoLog.h"
 #include "NanoOpenGL3.h"
 //=============================================================================
@@ -87,6 +91,17 @@ bool OGLContextInit()
 		return false;
 	}
 
+	// before any state is set, the hooks see every call
+	InitStateCache();
+
+#if USE_OPENGL == VERSION_OPENGL46
+	if (openGLVersion < GLAD_MAKE_VERSION(4, 5) || !dsa::Init())
+	{
+		Fatal("Direct state access requires OpenGL 4.5");
+		return false;
+	}
+#endif
+
 	const char* renderer = (const char*)glGetString(GL_RENDERER);
 	const char* version = (const char*)glGetString(GL_VERSION);
 	Print("Renderer: " + std::string(renderer));
@@ -108,6 +123,9 @@ bool OGLContextInit()
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glCullFace(GL_BACK);
 
+	shadercache::Init();
+	InitShaderCompiler();
+
 	// TODO: reset opengl state
 
 	return true;
@@ -115,6 +133,8 @@ bool OGLContextInit()
 //=============================================================================
 void OGLContextClose()
 {
+	shadervariants::Close();
+
 	for (const auto& [_, sampler] : SamplerCache)
 	{
 		glDeleteSamplers(1, &sampler.handle);
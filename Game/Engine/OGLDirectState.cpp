@@ -0,0 +1,57 @@
+﻿#include "stdafx.h"
+#include "OGLDirectState.h"
+#include "NanoLog.h"
+#if USE_OPENGL == VERSION_OPENGL46
+//=============================================================================
+namespace dsa
+{
+	PFNCreateBuffers         CreateBuffers{ nullptr };
+	PFNNamedBufferData       NamedBufferData{ nullptr };
+	PFNNamedBufferSubData    NamedBufferSubData{ nullptr };
+	PFNCreateTextures        CreateTextures{ nullptr };
+	PFNTextureStorage1D      TextureStorage1D{ nullptr };
+	PFNTextureStorage2D      TextureStorage2D{ nullptr };
+	PFNTextureStorage3D      TextureStorage3D{ nullptr };
+	PFNTextureSubImage1D     TextureSubImage1D{ nullptr };
+	PFNTextureSubImage2D     TextureSubImage2D{ nullptr };
+	PFNTextureSubImage3D     TextureSubImage3D{ nullptr };
+	PFNTextureParameteri     TextureParameteri{ nullptr };
+	PFNGenerateTextureMipmap GenerateTextureMipmap{ nullptr };
+}
+//=============================================================================
+namespace
+{
+	template<typename Proc>
+	bool loadProc(Proc& proc, const char* name)
+	{
+		proc = reinterpret_cast<Proc>(RGFW_getProcAddress_OpenGL(name));
+		if (!proc) Error(std::string("OpenGL function not found: ") + name);
+		return proc != nullptr;
+	}
+}
+//=============================================================================
+bool dsa::Init()
+{
+	bool result = true;
+	result &= loadProc(CreateBuffers, "glCreateBuffers");
+	result &= loadProc(NamedBufferData, "glNamedBufferData");
+	result &= loadProc(NamedBufferSubData, "glNamedBufferSubData");
+	result &= loadProc(CreateTextures, "glCreateTextures");
+	result &= loadProc(TextureStorage1D, "glTextureStorage1D");
+	result &= loadProc(TextureStorage2D, "glTextureStorage2D");
+	result &= loadProc(TextureStorage3D, "glTextureStorage3D");
+	result &= loadProc(TextureSubImage1D, "glTextureSubImage1D");
+	result &= loadProc(TextureSubImage2D, "glTextureSubImage2D");
+	result &= loadProc(TextureSubImage3D, "glTextureSubImage3D");
+	result &= loadProc(TextureParameteri, "glTextureParameteri");
+	result &= loadProc(GenerateTextureMipmap, "glGenerateTextureMipmap");
+	return result;
+}
+//=============================================================================
+GLsizei dsa::GetMipLevels(unsigned width, unsigned height, unsigned depth) noexcept
+{
+	const unsigned size = std::max({ width, height, depth, 1u });
+	return static_cast<GLsizei>(std::bit_width(size));
+}
+//=============================================================================
+#endif // USE_OPENGL == VERSION_OPENGL46
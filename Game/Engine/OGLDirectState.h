@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#if USE_OPENGL == VERSION_OPENGL46
+
+// GL 4.5 direct state access. glad is generated for 3.3, the entry points are loaded by OGLContextInit. Objects are
+// created and filled by name, nothing is bound, so the create and upload paths neither query nor restore bindings
+namespace dsa
+{
+	using PFNCreateBuffers        = void (GLAD_API_PTR*)(GLsizei n, GLuint* buffers);
+	using PFNNamedBufferData      = void (GLAD_API_PTR*)(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage);
+	using PFNNamedBufferSubData   = void (GLAD_API_PTR*)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+	using PFNCreateTextures       = void (GLAD_API_PTR*)(GLenum target, GLsizei n, GLuint* textures);
+	using PFNTextureStorage1D     = void (GLAD_API_PTR*)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width);
+	using PFNTextureStorage2D     = void (GLAD_API_PTR*)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+	using PFNTextureStorage3D     = void (GLAD_API_PTR*)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth);
+	using PFNTextureSubImage1D    = void (GLAD_API_PTR*)(GLuint texture, GLint level, GLint xoffset, GLsizei width, GLenum format, GLenum type, const void* pixels);
+	using PFNTextureSubImage2D    = void (GLAD_API_PTR*)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+	using PFNTextureSubImage3D    = void (GLAD_API_PTR*)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels);
+	using PFNTextureParameteri    = void (GLAD_API_PTR*)(GLuint texture, GLenum pname, GLint param);
+	using PFNGenerateTextureMipmap = void (GLAD_API_PTR*)(GLuint texture);
+
+	extern PFNCreateBuffers         CreateBuffers;
+	extern PFNNamedBufferData       NamedBufferData;
+	extern PFNNamedBufferSubData    NamedBufferSubData;
+	extern PFNCreateTextures        CreateTextures;
+	extern PFNTextureStorage1D      TextureStorage1D;
+	extern PFNTextureStorage2D      TextureStorage2D;
+	extern PFNTextureStorage3D      TextureStorage3D;
+	extern PFNTextureSubImage1D     TextureSubImage1D;
+	extern PFNTextureSubImage2D     TextureSubImage2D;
+	extern PFNTextureSubImage3D     TextureSubImage3D;
+	extern PFNTextureParameteri     TextureParameteri;
+	extern PFNGenerateTextureMipmap GenerateTextureMipmap;
+
+	// false when the context lacks any of the entry points
+	bool Init();
+
+	// storage is immutable, it holds the whole mip chain so that mipmaps can be generated later
+	GLsizei GetMipLevels(unsigned width, unsigned height = 1, unsigned depth = 1) noexcept;
+} // namespace dsa
+
+#endif // USE_OPENGL == VERSION_OPENGL46
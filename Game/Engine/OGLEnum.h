@@ -1,5 +1,28 @@
 ﻿#pragma once
 
+// Extension enums that the GL 3.3 core loader does not define
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#	define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#	define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#	define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#	define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#	define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#	define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#	define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#	define GL_PROGRAM_BINARY_LENGTH 0x8741
+#	define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#	define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#	define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 //=============================================================================
 // Enum
 //=============================================================================
@@ -11,6 +34,7 @@ enum class DataType : uint8_t
 	UnsignedShort,
 	Int,
 	UnsignedInt,
+	HalfFloat,
 	Float,
 	Double
 };
@@ -51,6 +75,12 @@ enum class InternalFormat : uint8_t
 	// Integer formats
 	//R11F_G11F_B10F,
 
+	// Block compressed (BC1/BC3 - EXT_texture_compression_s3tc, BC7 - ARB_texture_compression_bptc)
+	BC1, BC1_SRGB,
+	BC3, BC3_SRGB,
+	BC4, BC5,
+	BC7, BC7_SRGB,
+
 	// Depth/stencil
 	//DepthComponent16, DepthComponent24, DepthComponent32F,
 	//Depth24Stencil8
@@ -11,6 +11,7 @@ inline GLenum EnumToValue(DataType type) noexcept
 	case DataType::UnsignedShort: return GL_UNSIGNED_SHORT;
 	case DataType::Int:           return GL_INT;
 	case DataType::UnsignedInt:   return GL_UNSIGNED_INT;
+	case DataType::HalfFloat:     return GL_HALF_FLOAT;
 	case DataType::Float:         return GL_FLOAT;
 	case DataType::Double:        return GL_DOUBLE;
 	default: std::unreachable();
@@ -70,6 +71,14 @@ inline GLint EnumToValue(InternalFormat format) noexcept
 	//case InternalFormat::RGBA16F:           return GL_RGBA16F;
 	//case InternalFormat::RGBA32F:           return GL_RGBA32F;
 	//case InternalFormat::R11F_G11F_B10F:    return GL_R11F_G11F_B10F;
+	case InternalFormat::BC1:               return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case InternalFormat::BC1_SRGB:          return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+	case InternalFormat::BC3:               return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case InternalFormat::BC3_SRGB:          return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+	case InternalFormat::BC4:               return GL_COMPRESSED_RED_RGTC1;
+	case InternalFormat::BC5:               return GL_COMPRESSED_RG_RGTC2;
+	case InternalFormat::BC7:               return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case InternalFormat::BC7_SRGB:          return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
 	//case InternalFormat::DepthComponent16:  return GL_DEPTH_COMPONENT16;
 	//case InternalFormat::DepthComponent24:  return GL_DEPTH_COMPONENT24;
 	//case InternalFormat::DepthComponent32F: return GL_DEPTH_COMPONENT32F;
@@ -1,85 +1,104 @@
 ﻿#include "stdafx.h"
 #include "OGLShader.h"
+#include "OGLShaderCache.h"
+#include "OGLShaderSource.h"
 #include "NanoLog.h"
+#include "NanoOpenGL3.h"
 //=============================================================================
-std::string loadShaderCode(const std::string& path, unsigned int level);
-//=============================================================================
-inline std::string preprocessShaderCode(const std::string& line, const std::string& directory, unsigned int level)
+namespace
 {
-	static const std::regex re("^[ ]*#[ ]*include[ ]+[\"<](.*)[\">].*");
-	std::smatch matches;
+	// uniform name hash -> location, per linked program
+	std::unordered_map<GLuint, std::unordered_map<uint64_t, int>> programUniforms;
 
-	if (regex_search(line, matches, re))
-	{
-		std::string path = matches[1].str();
-		return loadShaderCode(directory + "/" + path, level);
-	}
-	else
+	// array elements are registered one by one ("lights[2].color", "weights[3]"), the bare array name gives element 0
+	void buildUniformTable(GLuint program)
 	{
-		return line;
-	}
-}
-//=============================================================================
-inline std::string loadShaderCode(const std::string& path, unsigned int level)
-{
-	Debug("Load Shader file: " + path);
+		auto& table = programUniforms[program];
+		table.clear();
 
-	if (level > 32)
-	{
-		Error("Header inclusion depth limit reached, might be caused by cyclic header inclusion");
-		return {};
-	}
+		GLint count = 0;
+		GLint maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
 
-	std::stringstream shaderStream;
-	std::string directory = path.substr(0, path.find_last_of('/'));
+		std::string name(static_cast<size_t>(std::max(maxLength, 1)), '\0');
+		for (GLint i = 0; i < count; i++)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(program, static_cast<GLuint>(i), maxLength, &length, &size, &type, name.data());
+			const std::string_view uniformName(name.data(), static_cast<size_t>(length));
 
-	std::ifstream shaderFile(path);
-	if (!shaderFile.is_open())
-	{
-		Error("Fail to open file: " + path);
-		return {};
-	}
+			const int location = glGetUniformLocation(program, name.c_str());
+			if (location < 0) continue; // uniform blocks
 
-	std::string line;
-	while (std::getline(shaderFile, line))
-	{
-		shaderStream << preprocessShaderCode(line, directory, level + 1) << std::endl;
-	}
+			table[HashUniformName(uniformName)] = location;
+			if (!uniformName.ends_with("[0]")) continue;
 
-	return shaderStream.str();
-}
-//=============================================================================
-std::string LoadShaderCode(const std::string& path, const std::vector<std::string>& defines)
-{
-	Debug("Load Shader file: " + path);
-
-	std::stringstream shaderStream;
-	std::string directory = path.substr(0, path.find_last_of('/'));
-
-	std::ifstream shaderFile(path);
-	if (!shaderFile.is_open())
-	{
-		Error("Fail to open file: " + path);
-		return {};
+			const std::string baseName(uniformName.substr(0, uniformName.size() - 3));
+			table[HashUniformName(baseName)] = location;
+			for (GLint element = 1; element < size; element++)
+			{
+				const std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				table[HashUniformName(elementName)] = glGetUniformLocation(program, elementName.c_str());
+			}
+		}
 	}
 
-	std::string line;
-	unsigned int lineNumber = 0;
-	while (std::getline(shaderFile, line))
+	// programs submitted with CreateShaderProgramAsync, the stages stay alive until the link status is read
+	struct PendingProgram final
 	{
-		if (lineNumber == 1)
+		void release(GLuint program)
 		{
-			for (auto itr = defines.begin(); itr != defines.end(); itr++)
+			for (GLuint& shader : shaders)
 			{
-				shaderStream << "#define " << *itr << std::endl;
+				if (!shader) continue;
+				if (program) glDetachShader(program, shader);
+				glDeleteShader(shader);
+				shader = 0;
 			}
 		}
 
-		shaderStream << preprocessShaderCode(line, directory, 1) << std::endl;
-		lineNumber++;
+		GLuint   shaders[3]{ 0, 0, 0 }; // vertex, geometry, fragment
+		uint64_t cacheKey{ 0 };
+	};
+	constexpr GLenum ShaderStages[3] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+
+	std::unordered_map<GLuint, PendingProgram> pendingPrograms;
+	bool                                       parallelCompile{ false };
+
+	std::vector<void (*)(GLuint)> deleteCallbacks;
+	PFNGLDELETEPROGRAMPROC        deleteProgram{ nullptr }; // the state cache hook
+
+	void GLAD_API_PTR hookDeleteProgram(GLuint program)
+	{
+		// deleted before FinishShaderProgram (a pass closed after a failed Init), the stages would leak
+		if (auto pending = pendingPrograms.find(program); pending != pendingPrograms.end())
+		{
+			pending->second.release(program);
+			pendingPrograms.erase(pending);
+		}
+		programUniforms.erase(program);
+		for (const auto callback : deleteCallbacks)
+			callback(program);
+		deleteProgram(program);
 	}
 
-	return shaderStream.str();
+	int findUniformLocation(ProgramHandle program, uint64_t hash, auto&& buildName)
+	{
+		auto it = programUniforms.find(program.handle);
+		if (it == programUniforms.end())
+			return glGetUniformLocation(program.handle, buildName().c_str());
+
+		auto location = it->second.find(hash);
+		return location != it->second.end() ? location->second : -1;
+	}
+}
+//=============================================================================
+std::string LoadShaderCode(const std::string& path, const std::vector<std::string>& defines)
+{
+	return shadersource::Load(path, defines);
 }
 //=============================================================================
 [[nodiscard]] inline std::string shaderStageToString(GLenum stage)
@@ -118,14 +137,8 @@ std::string LoadShaderCode(const std::string& path, const std::vector<std::strin
 	return oss.str();
 }
 //=============================================================================
-[[nodiscard]] inline GLuint compileShaderGLSL(GLenum stage, std::string_view sourceGLSL)
+[[nodiscard]] inline GLuint submitShaderGLSL(GLenum stage, std::string_view sourceGLSL)
 {
-	if (sourceGLSL.empty())
-	{
-		Error("Failed to create OpenGL shader object for stage: " + std::string(shaderStageToString(stage)) + ". Source code Empty.");
-		return { 0 };
-	}
-
 	GLuint shader = glCreateShader(stage);
 	if (!shader)
 	{
@@ -133,10 +146,15 @@ std::string LoadShaderCode(const std::string& path, const std::vector<std::strin
 		return { 0 };
 	}
 	const GLchar* strings = sourceGLSL.data();
-	glShaderSource(shader, 1, &strings, nullptr);
-	
-	glCompileShader(shader);
+	const GLint length = static_cast<GLint>(sourceGLSL.size());
+	glShaderSource(shader, 1, &strings, &length);
 
+	glCompileShader(shader);
+	return shader;
+}
+//=============================================================================
+[[nodiscard]] inline bool checkShaderGLSL(GLenum stage, GLuint shader)
+{
 	GLint compileStatus{ 0 };
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus);
 	if (compileStatus == GL_FALSE)
@@ -155,104 +173,229 @@ std::string LoadShaderCode(const std::string& path, const std::vector<std::strin
 			infoLog = "<no info log>";
 		}
 
+		// the source is kept by GL until the shader is deleted, no copy is held while the driver compiles
+		GLint sourceLength{ 0 };
+		glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &sourceLength);
+		std::string source(static_cast<size_t>(std::max(sourceLength, 1)), '\0');
+		glGetShaderSource(shader, sourceLength, nullptr, source.data());
+
 		std::string logError = "OPENGL " + shaderStageToString(stage) + ": Shader compilation failed: " + infoLog;
-		if (strings != nullptr) logError += ", Source: \n" + printShaderSource(strings);
+		logError += ", Source: \n" + printShaderSource(source.c_str());
 		Error(logError);
-		return 0;
+		return false;
 	}
-
-	return shader;
+	return true;
 }
 //=============================================================================
-ProgramHandle CreateShaderProgram(std::string_view vertexShader)
+void InitShaderCompiler()
 {
-	return CreateShaderProgram(vertexShader, "", "");
-}
-//=============================================================================
-ProgramHandle CreateShaderProgram(std::string_view vertexShader, std::string_view fragmentShader)
-{
-	return CreateShaderProgram(vertexShader, "", fragmentShader);
+	// after InitStateCache, glad reloaded for a new context points to the state cache hook again
+	if (glad_glDeleteProgram != hookDeleteProgram)
+	{
+		deleteProgram = glad_glDeleteProgram;
+		glad_glDeleteProgram = hookDeleteProgram;
+	}
+
+	parallelCompile = false;
+	if (!IsExtensionSupported("GL_KHR_parallel_shader_compile") && !IsExtensionSupported("GL_ARB_parallel_shader_compile"))
+		return;
+
+	// glad is generated for GL 3.3 core, the entry point has a KHR or ARB suffix depending on the driver
+	using PFNMaxShaderCompilerThreads = void (GLAD_API_PTR*)(GLuint count);
+	auto maxShaderCompilerThreads = reinterpret_cast<PFNMaxShaderCompilerThreads>(RGFW_getProcAddress_OpenGL("glMaxShaderCompilerThreadsKHR"));
+	if (!maxShaderCompilerThreads)
+		maxShaderCompilerThreads = reinterpret_cast<PFNMaxShaderCompilerThreads>(RGFW_getProcAddress_OpenGL("glMaxShaderCompilerThreadsARB"));
+	if (maxShaderCompilerThreads)
+		maxShaderCompilerThreads(0xFFFFFFFF); // implementation chooses
+
+	parallelCompile = true;
+	Print("Parallel shader compile enabled");
 }
 //=============================================================================
-ProgramHandle CreateShaderProgram(std::string_view vertexShader, std::string_view geometryShader, std::string_view fragmentShader)
+ProgramHandle CreateShaderProgramAsync(std::string_view vertexShader, std::string_view geometryShader, std::string_view fragmentShader)
 {
-	struct LocalShader final
-	{
-		~LocalShader() { if (id) glDeleteShader(id); }
-		GLuint id{ 0 };
-	};
-
-	LocalShader vs;
-	if (!vertexShader.empty())
+	const uint64_t cacheKey = shadercache::GetKey(vertexShader, geometryShader, fragmentShader);
+	if (ProgramHandle cached = shadercache::Load(cacheKey); cached.handle)
 	{
-		vs.id = compileShaderGLSL(GL_VERTEX_SHADER, vertexShader);
-		if (!vs.id) return {};
+		buildUniformTable(cached.handle);
+		return cached;
 	}
-	LocalShader gs;
-	if (!geometryShader.empty())
-	{
-		gs.id = compileShaderGLSL(GL_GEOMETRY_SHADER, geometryShader);
-		if (!gs.id) return {};
-	}
-	LocalShader fs;
-	if (!fragmentShader.empty())
-	{
-		fs.id = compileShaderGLSL(GL_FRAGMENT_SHADER, fragmentShader);
-		if (!fs.id) return {};
-	}
-	if (vs.id == 0 && gs.id == 0 && fs.id == 0)
+
+	if (vertexShader.empty() && geometryShader.empty() && fragmentShader.empty())
 	{
 		Error("Shader not valid");
 		return {};
 	}
 
+	PendingProgram pending{};
+	pending.cacheKey = cacheKey;
+	const std::string_view sources[] = { vertexShader, geometryShader, fragmentShader };
+	for (size_t i = 0; i < std::size(sources); i++)
+	{
+		if (sources[i].empty()) continue;
+		pending.shaders[i] = submitShaderGLSL(ShaderStages[i], sources[i]);
+		if (!pending.shaders[i])
+		{
+			pending.release(0);
+			return {};
+		}
+	}
+
 	ProgramHandle program(glCreateProgram());
 	assert(program.handle);
 
-	if (vs.id) glAttachShader(program.handle, vs.id);
-	if (gs.id) glAttachShader(program.handle, gs.id);
-	if (fs.id) glAttachShader(program.handle, fs.id);
+	for (const GLuint shader : pending.shaders)
+	{
+		if (shader) glAttachShader(program.handle, shader);
+	}
+	shadercache::PrepareLink(program);
+	// linking a program with a failed stage only fails the link, the stage log is read in FinishShaderProgram
 	glLinkProgram(program.handle);
 
+	pendingPrograms[program.handle] = pending;
+	return program;
+}
+//=============================================================================
+bool IsShaderProgramReady(ProgramHandle program)
+{
+	if (!parallelCompile || !pendingPrograms.contains(program.handle))
+		return true;
+
+	GLint completed{ GL_TRUE };
+	glGetProgramiv(program.handle, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+//=============================================================================
+bool FinishShaderProgram(ProgramHandle& program)
+{
+	auto it = pendingPrograms.find(program.handle);
+	if (it == pendingPrograms.end())
+		return program.handle != 0;
+
+	PendingProgram pending = it->second;
+	pendingPrograms.erase(it);
+
 	GLint success{ 0 };
 	glGetProgramiv(program.handle, GL_LINK_STATUS, &success);
 	if (!success)
 	{
-		GLint length = 512;
-		glGetProgramiv(program.handle, GL_INFO_LOG_LENGTH, &length);
-		std::string infoLog;
-		infoLog.resize(static_cast<size_t>(length + 1), '\0');
-		glGetProgramInfoLog(program.handle, length, nullptr, infoLog.data());
+		bool stagesCompiled = true;
+		for (size_t i = 0; i < std::size(pending.shaders); i++)
+		{
+			if (pending.shaders[i] && !checkShaderGLSL(ShaderStages[i], pending.shaders[i]))
+				stagesCompiled = false;
+		}
+		if (stagesCompiled)
+		{
+			GLint length = 512;
+			glGetProgramiv(program.handle, GL_INFO_LOG_LENGTH, &length);
+			std::string infoLog;
+			infoLog.resize(static_cast<size_t>(length + 1), '\0');
+			glGetProgramInfoLog(program.handle, length, nullptr, infoLog.data());
+			Error("Failed to compile graphics pipeline.\n" + infoLog);
+		}
+		pending.release(program.handle);
 		glDeleteProgram(program.handle);
-		Error("Failed to compile graphics pipeline.\n" + infoLog);
 		program.handle = 0;
+		return false;
 	}
 
-	if (vs.id) glDetachShader(program.handle, vs.id);
-	if (gs.id) glDetachShader(program.handle, gs.id);
-	if (fs.id) glDetachShader(program.handle, fs.id);
-
+	// a handle of a deleted program can come back, the table is replaced
+	buildUniformTable(program.handle);
+	shadercache::Save(pending.cacheKey, program);
+	pending.release(program.handle);
+	return true;
+}
+//=============================================================================
+void AddProgramDeleteCallback(void (*callback)(GLuint program))
+{
+	deleteCallbacks.push_back(callback);
+}
+//=============================================================================
+ProgramHandle CreateShaderProgram(std::string_view vertexShader)
+{
+	return CreateShaderProgram(vertexShader, "", "");
+}
+//=============================================================================
+ProgramHandle CreateShaderProgram(std::string_view vertexShader, std::string_view fragmentShader)
+{
+	return CreateShaderProgram(vertexShader, "", fragmentShader);
+}
+//=============================================================================
+ProgramHandle CreateShaderProgram(std::string_view vertexShader, std::string_view geometryShader, std::string_view fragmentShader)
+{
+	ProgramHandle program = CreateShaderProgramAsync(vertexShader, geometryShader, fragmentShader);
+	FinishShaderProgram(program);
+	return program;
+}
+//=============================================================================
+ProgramHandle LoadShaderProgramAsync(const std::string& vsFile, const std::vector<std::string>& defines)
+{
+	ProgramHandle program = CreateShaderProgramAsync(LoadShaderCode(vsFile, defines), "", "");
+	shadersource::RegisterProgram(program, { vsFile });
+	return program;
+}
+//=============================================================================
+ProgramHandle LoadShaderProgramAsync(const std::string& vsFile, const std::string& fsFile, const std::vector<std::string>& defines)
+{
+	ProgramHandle program = CreateShaderProgramAsync(LoadShaderCode(vsFile, defines), "", LoadShaderCode(fsFile, defines));
+	shadersource::RegisterProgram(program, { vsFile, fsFile });
+	return program;
+}
+//=============================================================================
+ProgramHandle LoadShaderProgramAsync(const std::string& vsFile, const std::string& gsFile, const std::string& fsFile, const std::vector<std::string>& defines)
+{
+	ProgramHandle program = CreateShaderProgramAsync(LoadShaderCode(vsFile, defines), LoadShaderCode(gsFile, defines), LoadShaderCode(fsFile, defines));
+	shadersource::RegisterProgram(program, { vsFile, gsFile, fsFile });
 	return program;
 }
 //=============================================================================
 ProgramHandle LoadShaderProgram(const std::string& vsFile, const std::vector<std::string>& defines)
 {
-	return CreateShaderProgram(LoadShaderCode(vsFile, defines));
+	ProgramHandle program = LoadShaderProgramAsync(vsFile, defines);
+	FinishShaderProgram(program);
+	return program;
 }
 //=============================================================================
 ProgramHandle LoadShaderProgram(const std::string& vsFile, const std::string& fsFile, const std::vector<std::string>& defines)
 {
-	return CreateShaderProgram(LoadShaderCode(vsFile, defines), LoadShaderCode(fsFile, defines));
+	ProgramHandle program = LoadShaderProgramAsync(vsFile, fsFile, defines);
+	FinishShaderProgram(program);
+	return program;
 }
 //=============================================================================
 ProgramHandle LoadShaderProgram(const std::string& vsFile, const std::string& gsFile, const std::string& fsFile, const std::vector<std::string>& defines)
 {
-	return CreateShaderProgram(LoadShaderCode(vsFile, defines), LoadShaderCode(gsFile, defines), LoadShaderCode(fsFile, defines));
+	ProgramHandle program = LoadShaderProgramAsync(vsFile, gsFile, fsFile, defines);
+	FinishShaderProgram(program);
+	return program;
+}
+//=============================================================================
+int GetUniformLocation(ProgramHandle program, UniformName name)
+{
+	return findUniformLocation(program, name.hash, [&] { return std::string(name.name); });
 }
 //=============================================================================
-int GetUniformLocation(ProgramHandle program, std::string_view name)
+int GetUniformLocation(ProgramHandle program, UniformName arrayName, size_t index, std::string_view member)
 {
-	return glGetUniformLocation(program.handle, name.data());
+	char digits[24];
+	const char* end = std::to_chars(std::begin(digits), std::end(digits), index).ptr;
+	const std::string_view indexStr(digits, static_cast<size_t>(end - digits));
+
+	uint64_t hash = HashUniformName("[", arrayName.hash);
+	hash = HashUniformName(indexStr, hash);
+	hash = HashUniformName("]", hash);
+	if (!member.empty())
+	{
+		hash = HashUniformName(".", hash);
+		hash = HashUniformName(member, hash);
+	}
+	return findUniformLocation(program, hash, [&]
+		{
+			std::string name = std::string(arrayName.name) + "[" + std::string(indexStr) + "]";
+			if (!member.empty()) name += "." + std::string(member);
+			return name;
+		});
 }
 //=============================================================================
 void SetUniform(int id, bool b)
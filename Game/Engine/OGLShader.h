@@ -18,10 +18,55 @@ ProgramHandle LoadShaderProgram(const std::string& vsFile, const std::vector<std
 ProgramHandle LoadShaderProgram(const std::string& vsFile, const std::string& fsFile, const std::vector<std::string>& defines = {});
 ProgramHandle LoadShaderProgram(const std::string& vsFile, const std::string& gsFile, const std::string& fsFile, const std::vector<std::string>& defines = {});
 
+// Batched compilation: the Async functions submit the stages and the link to the driver and return without reading
+// any status, so the programs of all passes compile together (in parallel with GL_KHR_parallel_shader_compile).
+// FinishShaderProgram reads the link status when the program is first needed, logs the errors and sets the
+// handle to 0 on failure. Uniform locations are only available after it. The sync functions are Async + Finish
+void InitShaderCompiler();
+ProgramHandle CreateShaderProgramAsync(std::string_view vertexShader, std::string_view geometryShader, std::string_view fragmentShader);
+ProgramHandle LoadShaderProgramAsync(const std::string& vsFile, const std::vector<std::string>& defines = {});
+ProgramHandle LoadShaderProgramAsync(const std::string& vsFile, const std::string& fsFile, const std::vector<std::string>& defines = {});
+ProgramHandle LoadShaderProgramAsync(const std::string& vsFile, const std::string& gsFile, const std::string& fsFile, const std::vector<std::string>& defines = {});
+// true once the driver finished, always true without the extension. Never blocks
+bool IsShaderProgramReady(ProgramHandle program);
+bool FinishShaderProgram(ProgramHandle& program);
+// InitShaderCompiler hooks glDeleteProgram, every deleted program drops its uniform table and calls these for the
+// per program caches of other modules. A new program can get the name of a deleted one
+void AddProgramDeleteCallback(void (*callback)(GLuint program));
+
 //=============================================================================
 // Shader Uniforms
 //=============================================================================
-int GetUniformLocation(ProgramHandle program, std::string_view name);
+
+// FNV-1a, 'hash' continues a previous call so "name[3].member" is hashed without building the string
+constexpr uint64_t HashUniformName(std::string_view name, uint64_t hash = 0xcbf29ce484222325ull) noexcept
+{
+	for (const char c : name)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// Uniform name with its hash. Literals are hashed at compile time, strings built at run time once per call
+struct UniformName final
+{
+	template<size_t N>
+	consteval UniformName(const char(&str)[N]) noexcept : name(str, N - 1), hash(HashUniformName(name)) {}
+	UniformName(const std::string& str) noexcept : name(str), hash(HashUniformName(name)) {}
+
+	std::string_view name;
+	uint64_t         hash;
+};
+
+// Locations come from the table of the program filled after linking (glGetActiveUniform), the draw loop
+// makes no GL calls and no allocations. -1 for uniforms the program does not have. Programs not created
+// by CreateShaderProgram fall back to glGetUniformLocation. Passes still resolve the locations they set
+// per draw once at init and keep the ints
+int GetUniformLocation(ProgramHandle program, UniformName name);
+// location of "arrayName[index].member" or "arrayName[index]" with an empty member
+int GetUniformLocation(ProgramHandle program, UniformName arrayName, size_t index, std::string_view member = {});
 
 void SetUniform(int id, bool b);
 void SetUniform(int id, float s);
@@ -0,0 +1,213 @@
+﻿#include "stdafx.h"
+#include "OGLShaderCache.h"
+#include "NanoCore.h"
+#include "NanoLog.h"
+#include "NanoOpenGL3.h"
+//=============================================================================
+namespace
+{
+	using PFNGetProgramBinary = void (GLAD_API_PTR*)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	using PFNProgramBinary = void (GLAD_API_PTR*)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	using PFNProgramParameteri = void (GLAD_API_PTR*)(GLuint program, GLenum pname, GLint value);
+
+	PFNGetProgramBinary  getProgramBinary{ nullptr };
+	PFNProgramBinary     programBinary{ nullptr };
+	PFNProgramParameteri programParameteri{ nullptr };
+
+	bool        supported{ false };
+	bool        enabled{ true };
+	uint64_t    driverHash{ 0 };
+	size_t      numHits{ 0 };
+	size_t      numMisses{ 0 };
+
+	const std::filesystem::path CacheDirectory = "cache/shaders";
+
+	struct ProgramHeader final
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+	};
+
+	std::filesystem::path getCachePath(uint64_t key)
+	{
+		char name[24];
+		std::snprintf(name, sizeof(name), "%016llx.nprg", static_cast<unsigned long long>(key));
+		return CacheDirectory / name;
+	}
+
+	std::string getString(GLenum name)
+	{
+		const char* str = reinterpret_cast<const char*>(glGetString(name));
+		return str ? str : "";
+	}
+}
+//=============================================================================
+void shadercache::Init()
+{
+	supported = false;
+
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major > 4 || (major == 4 && minor >= 1) || IsExtensionSupported("GL_ARB_get_program_binary"))
+	{
+		getProgramBinary = reinterpret_cast<PFNGetProgramBinary>(RGFW_getProcAddress_OpenGL("glGetProgramBinary"));
+		programBinary = reinterpret_cast<PFNProgramBinary>(RGFW_getProcAddress_OpenGL("glProgramBinary"));
+		programParameteri = reinterpret_cast<PFNProgramParameteri>(RGFW_getProcAddress_OpenGL("glProgramParameteri"));
+	}
+
+	// some drivers expose the functions without any binary format, nothing could be stored
+	GLint numFormats = 0;
+	if (getProgramBinary && programBinary && programParameteri)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	supported = numFormats > 0;
+
+	const std::string driver = getString(GL_VENDOR) + '\n' + getString(GL_RENDERER) + '\n' + getString(GL_VERSION);
+	driverHash = HashBytes(driver.data(), driver.size());
+
+	if (supported)
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(CacheDirectory, ec);
+		if (ec)
+		{
+			Warning("Shader cache disabled, cannot create " + CacheDirectory.string());
+			supported = false;
+		}
+	}
+	Print(std::string("Shader program cache: ") + (supported ? "enabled" : "not supported"));
+}
+//=============================================================================
+bool shadercache::IsSupported()
+{
+	return supported && enabled;
+}
+//=============================================================================
+void shadercache::SetEnabled(bool enable)
+{
+	enabled = enable;
+}
+//=============================================================================
+uint64_t shadercache::GetKey(std::string_view vertexShader, std::string_view geometryShader, std::string_view fragmentShader)
+{
+	// the length of each stage goes in too, moving text between stages changes the key
+	uint64_t key = driverHash;
+	for (const std::string_view source : { vertexShader, geometryShader, fragmentShader })
+	{
+		const uint64_t size = source.size();
+		key = HashBytes(&size, sizeof(size), key);
+		key = HashBytes(source.data(), source.size(), key);
+	}
+	return key;
+}
+//=============================================================================
+ProgramHandle shadercache::Load(uint64_t key)
+{
+	if (!IsSupported())
+		return {};
+
+	std::ifstream file(getCachePath(key), std::ios::binary);
+	ProgramHeader header{};
+	if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| header.magic != ProgramMagic || header.version != ProgramVersion || header.key != key || header.binarySize == 0)
+	{
+		numMisses++;
+		return {};
+	}
+	std::vector<char> binary(header.binarySize);
+	if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size())))
+	{
+		numMisses++;
+		return {};
+	}
+
+	ProgramHandle program{ glCreateProgram() };
+	programBinary(program.handle, static_cast<GLenum>(header.binaryFormat), binary.data(), static_cast<GLsizei>(binary.size()));
+
+	// rejected binaries (another driver build with the same version string) fail to link, not an error
+	GLint success{ 0 };
+	glGetProgramiv(program.handle, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program.handle);
+		std::error_code ec;
+		std::filesystem::remove(getCachePath(key), ec);
+		numMisses++;
+		return {};
+	}
+	numHits++;
+	return program;
+}
+//=============================================================================
+void shadercache::PrepareLink(ProgramHandle program)
+{
+	if (IsSupported())
+		programParameteri(program.handle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+//=============================================================================
+void shadercache::Save(uint64_t key, ProgramHandle program)
+{
+	if (!IsSupported())
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program.handle, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(static_cast<size_t>(length));
+	GLenum binaryFormat = 0;
+	GLsizei written = 0;
+	getProgramBinary(program.handle, length, &written, &binaryFormat, binary.data());
+	if (written <= 0)
+		return;
+
+	// write into temp file and rename it so that a broken write never looks like a valid cache
+	const std::filesystem::path cachePath = getCachePath(key);
+	std::filesystem::path tempPath = cachePath;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			Warning("Fail to create shader cache file: " + cachePath.string());
+			return;
+		}
+
+		ProgramHeader header{};
+		header.magic        = ProgramMagic;
+		header.version      = ProgramVersion;
+		header.key          = key;
+		header.binaryFormat = binaryFormat;
+		header.binarySize   = static_cast<uint32_t>(written);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), written);
+		if (!file.good())
+		{
+			file.close();
+			std::error_code ec;
+			std::filesystem::remove(tempPath, ec);
+			Warning("Fail to write shader cache file: " + cachePath.string());
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+		std::filesystem::remove(tempPath, ec);
+}
+//=============================================================================
+size_t shadercache::GetNumHits()
+{
+	return numHits;
+}
+//=============================================================================
+size_t shadercache::GetNumMisses()
+{
+	return numMisses;
+}
+//=============================================================================
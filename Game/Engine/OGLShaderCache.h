@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include "OGLShader.h"
+
+// Linked programs stored with glGetProgramBinary in "cache/shaders/<key>.nprg". The key hashes the preprocessed
+// sources of all stages (defines included) and the vendor, renderer and version strings of the driver, so edited
+// shaders and driver updates compile again. Needs GL 4.1 or ARB_get_program_binary, otherwise every load misses.
+namespace shadercache
+{
+	constexpr uint32_t ProgramMagic   = 0x4752504E; // "NPRG"
+	constexpr uint32_t ProgramVersion = 1;
+
+	// GL thread, after the context is created
+	void Init();
+	bool IsSupported();
+	void SetEnabled(bool enable);
+
+	uint64_t GetKey(std::string_view vertexShader, std::string_view geometryShader, std::string_view fragmentShader);
+
+	// {0} without a file or when the driver rejects the binary, the caller compiles then
+	ProgramHandle Load(uint64_t key);
+	// before glLinkProgram, asks the driver to keep the binary retrievable
+	void PrepareLink(ProgramHandle program);
+	// after a successful link
+	void Save(uint64_t key, ProgramHandle program);
+
+	size_t GetNumHits();
+	size_t GetNumMisses();
+} // namespace shadercache
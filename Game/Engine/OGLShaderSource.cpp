@@ -0,0 +1,275 @@
+﻿#include "stdafx.h"
+#include "OGLShaderSource.h"
+#include "NanoIO.h"
+#include "NanoLog.h"
+//=============================================================================
+namespace
+{
+	struct SourceFile final
+	{
+		std::string              text;         // includes expanded, '\n' line endings
+		size_t                   firstLineEnd; // end of the first line in 'text' (after the expansion of an include on it)
+		std::vector<std::string> includes;     // direct includes, normalized paths
+	};
+
+	std::recursive_mutex                                             sourceMutex;
+	std::unordered_map<std::string, SourceFile>                      sourceFiles;
+	std::unordered_map<std::string, std::unordered_set<std::string>> includedBy;
+	std::unordered_map<GLuint, std::vector<std::string>>             programFiles;
+	shadersource::Stats                                              stats;
+
+	std::string normalizePath(const std::filesystem::path& path)
+	{
+		return path.lexically_normal().generic_string();
+	}
+
+	std::string getDirectory(std::string_view path)
+	{
+		const size_t slash = path.find_last_of("/\\");
+		return slash == std::string_view::npos ? std::string(".") : std::string(path.substr(0, slash));
+	}
+
+	bool isBlank(char c) noexcept { return c == ' ' || c == '\t'; }
+
+	// '#include "file"' or '#include <file>' with optional blanks around '#', anything after the closing quote is ignored
+	bool parseInclude(std::string_view line, std::string_view& includePath) noexcept
+	{
+		size_t i = 0;
+		while (i < line.size() && isBlank(line[i])) i++;
+		if (i == line.size() || line[i] != '#') return false;
+		i++;
+		while (i < line.size() && isBlank(line[i])) i++;
+
+		constexpr std::string_view Keyword = "include";
+		if (line.substr(i, Keyword.size()) != Keyword) return false;
+		i += Keyword.size();
+
+		const size_t blanks = i;
+		while (i < line.size() && isBlank(line[i])) i++;
+		if (i == blanks || i == line.size()) return false;
+
+		const char close = line[i] == '"' ? '"' : (line[i] == '<' ? '>' : '\0');
+		if (close == '\0') return false;
+		const size_t end = line.find(close, i + 1);
+		if (end == std::string_view::npos) return false;
+
+		includePath = line.substr(i + 1, end - i - 1);
+		return true;
+	}
+
+	const SourceFile* loadFile(const std::string& path, unsigned level);
+
+	// single pass over the buffer: lines are copied as they are, include lines are replaced by the cached text
+	SourceFile scanSource(std::string_view source, const std::string& directory, unsigned level)
+	{
+		SourceFile file{};
+		file.text.reserve(source.size() + source.size() / 8);
+		file.firstLineEnd = std::string::npos;
+
+		if (source.starts_with("\xEF\xBB\xBF"))
+			source.remove_prefix(3);
+
+		size_t pos = 0;
+		while (pos < source.size())
+		{
+			const char* lineStart = source.data() + pos;
+			const void* newLine = std::memchr(lineStart, '\n', source.size() - pos);
+			const size_t lineEnd = newLine ? static_cast<size_t>(static_cast<const char*>(newLine) - source.data()) : source.size();
+
+			std::string_view line = source.substr(pos, lineEnd - pos);
+			if (line.ends_with('\r')) line.remove_suffix(1);
+			pos = lineEnd + 1;
+
+			std::string_view includePath;
+			if (parseInclude(line, includePath))
+			{
+				const std::string includeFile = normalizePath(std::filesystem::path(directory) / includePath);
+				if (const SourceFile* include = loadFile(includeFile, level + 1))
+					file.text += include->text;
+				if (std::find(file.includes.begin(), file.includes.end(), includeFile) == file.includes.end())
+					file.includes.push_back(includeFile);
+			}
+			else
+			{
+				file.text += line;
+				file.text += '\n';
+			}
+
+			if (file.firstLineEnd == std::string::npos)
+				file.firstLineEnd = file.text.size();
+		}
+		if (file.firstLineEnd == std::string::npos)
+			file.firstLineEnd = file.text.size();
+		return file;
+	}
+
+	const SourceFile* loadFile(const std::string& path, unsigned level)
+	{
+		if (level > shadersource::MaxIncludeDepth)
+		{
+			Error("Header inclusion depth limit reached, might be caused by cyclic header inclusion");
+			return nullptr;
+		}
+
+		if (auto it = sourceFiles.find(path); it != sourceFiles.end())
+		{
+			stats.cacheHits++;
+			return &it->second;
+		}
+
+		Debug("Load Shader file: " + path);
+		if (!io::Exists(path))
+		{
+			Error("Fail to open file: " + path);
+			return nullptr;
+		}
+		io::MappedFile mappedFile;
+		std::string_view source;
+		if (std::filesystem::file_size(path) > 0)
+		{
+			if (!mappedFile.Open(path))
+				return nullptr;
+			source = std::string_view(reinterpret_cast<const char*>(mappedFile.GetData()), mappedFile.GetSize());
+		}
+		stats.filesLoaded++;
+		stats.bytesLoaded += source.size();
+
+		SourceFile file = scanSource(source, getDirectory(path), level);
+		for (const std::string& include : file.includes)
+			includedBy[include].insert(path);
+
+		// a cyclic include may have stored the file already further down the recursion, the outermost result wins
+		return &(sourceFiles[path] = std::move(file));
+	}
+
+	std::string insertDefines(const SourceFile& file, const std::vector<std::string>& defines)
+	{
+		if (defines.empty())
+			return file.text;
+
+		size_t size = file.text.size();
+		for (const std::string& define : defines)
+			size += define.size() + 9;
+
+		std::string result;
+		result.reserve(size);
+		result.append(file.text, 0, file.firstLineEnd);
+		for (const std::string& define : defines)
+		{
+			result += "#define ";
+			result += define;
+			result += '\n';
+		}
+		result.append(file.text, file.firstLineEnd, std::string::npos);
+		return result;
+	}
+
+	void collectDependentFiles(const std::string& path, std::unordered_set<std::string>& files)
+	{
+		auto it = includedBy.find(path);
+		if (it == includedBy.end()) return;
+		for (const std::string& includer : it->second)
+		{
+			if (files.insert(includer).second)
+				collectDependentFiles(includer, files);
+		}
+	}
+}
+//=============================================================================
+std::string shadersource::Load(const std::string& path, const std::vector<std::string>& defines)
+{
+	std::lock_guard lock(sourceMutex);
+	const SourceFile* file = loadFile(normalizePath(path), 0);
+	return file ? insertDefines(*file, defines) : std::string{};
+}
+//=============================================================================
+std::string shadersource::Preprocess(std::string_view source, const std::string& directory, const std::vector<std::string>& defines)
+{
+	std::lock_guard lock(sourceMutex);
+	return insertDefines(scanSource(source, normalizePath(directory), 0), defines);
+}
+//=============================================================================
+void shadersource::RegisterProgram(ProgramHandle program, std::initializer_list<std::string_view> files)
+{
+	if (!program.handle) return;
+
+	std::lock_guard lock(sourceMutex);
+	auto& programFileList = programFiles[program.handle];
+	programFileList.clear();
+	for (const std::string_view file : files)
+	{
+		if (!file.empty())
+			programFileList.push_back(normalizePath(file));
+	}
+}
+//=============================================================================
+void shadersource::UnregisterProgram(ProgramHandle program)
+{
+	std::lock_guard lock(sourceMutex);
+	programFiles.erase(program.handle);
+}
+//=============================================================================
+std::vector<ProgramHandle> shadersource::GetDependentPrograms(const std::string& path)
+{
+	std::lock_guard lock(sourceMutex);
+	const std::string file = normalizePath(path);
+	std::unordered_set<std::string> files{ file };
+	collectDependentFiles(file, files);
+
+	std::vector<ProgramHandle> programs;
+	for (const auto& [program, programFileList] : programFiles)
+	{
+		for (const std::string& programFile : programFileList)
+		{
+			if (files.contains(programFile))
+			{
+				programs.push_back({ program });
+				break;
+			}
+		}
+	}
+	return programs;
+}
+//=============================================================================
+std::vector<std::string> shadersource::GetDependentFiles(const std::string& path)
+{
+	std::lock_guard lock(sourceMutex);
+	std::unordered_set<std::string> files;
+	collectDependentFiles(normalizePath(path), files);
+	return { files.begin(), files.end() };
+}
+//=============================================================================
+void shadersource::Invalidate(const std::string& path)
+{
+	std::lock_guard lock(sourceMutex);
+	const std::string file = normalizePath(path);
+	std::unordered_set<std::string> files{ file };
+	collectDependentFiles(file, files);
+
+	// the edges of a dropped file are recorded again when it is scanned
+	for (const std::string& dropped : files)
+	{
+		auto it = sourceFiles.find(dropped);
+		if (it == sourceFiles.end()) continue;
+		for (const std::string& include : it->second.includes)
+		{
+			if (auto edges = includedBy.find(include); edges != includedBy.end())
+				edges->second.erase(dropped);
+		}
+		sourceFiles.erase(it);
+	}
+}
+//=============================================================================
+void shadersource::ClearCache()
+{
+	std::lock_guard lock(sourceMutex);
+	sourceFiles.clear();
+	includedBy.clear();
+}
+//=============================================================================
+shadersource::Stats shadersource::GetStats()
+{
+	std::lock_guard lock(sourceMutex);
+	return stats;
+}
+//=============================================================================
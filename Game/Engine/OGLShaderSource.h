@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include "OGLShader.h"
+
+// Shader source preprocessor. Files are memory mapped and scanned once: '#include "file"' lines are replaced by the
+// text of the file (paths relative to the including file). The expanded text of every file is kept and shared by all
+// programs, so "utils.glsl" or "shadow.glsl" is read from disk once per session. The include graph and the files of
+// each program are recorded, a changed file tells which programs have to be rebuilt.
+// Only io and the log are used, no GL calls - the scanner can be timed without a context.
+namespace shadersource
+{
+	constexpr unsigned MaxIncludeDepth = 32;
+
+	struct Stats final
+	{
+		size_t filesLoaded{ 0 }; // mapped from disk
+		size_t bytesLoaded{ 0 };
+		size_t cacheHits{ 0 };   // includes and programs served from the cache
+	};
+
+	// text of the file with includes expanded, "#define <define>" lines are inserted after the first line (#version).
+	// Empty on failure
+	std::string Load(const std::string& path, const std::vector<std::string>& defines = {});
+
+	// expands 'source' as if it were a file in 'directory'. The source itself is not cached, its includes are
+	std::string Preprocess(std::string_view source, const std::string& directory, const std::vector<std::string>& defines = {});
+
+	// records the top-level files of a program. A handle registered again (deleted and reused by the driver) replaces the old entry
+	void RegisterProgram(ProgramHandle program, std::initializer_list<std::string_view> files);
+	void UnregisterProgram(ProgramHandle program);
+
+	// programs with 'path' among their files or includes, directly or through other includes
+	std::vector<ProgramHandle> GetDependentPrograms(const std::string& path);
+	// files that include 'path', directly or through other includes. 'path' itself is not in the list
+	std::vector<std::string> GetDependentFiles(const std::string& path);
+
+	// drops 'path' and every file including it from the cache, the next Load reads them again
+	void Invalidate(const std::string& path);
+	void ClearCache();
+
+	Stats GetStats();
+} // namespace shadersource
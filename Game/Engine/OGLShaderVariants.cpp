@@ -0,0 +1,171 @@
+﻿#include "stdafx.h"
+#include "OGLShaderVariants.h"
+#include "NanoIO.h"
+#include "NanoLog.h"
+//=============================================================================
+namespace
+{
+	enum class VariantState : uint8_t
+	{
+		Submitted,
+		Ready,
+		Failed
+	};
+
+	struct ShaderVariant final
+	{
+		ProgramHandle program{ 0 };
+		VariantState  state{ VariantState::Submitted };
+	};
+
+	std::vector<shadervariants::ShaderDesc>     shaders;
+	std::unordered_map<uint64_t, ShaderVariant> variants;
+
+	uint64_t getVariantKey(shadervariants::ShaderId shader, uint32_t features) noexcept
+	{
+		return (static_cast<uint64_t>(shader) << 32) | features;
+	}
+
+	ShaderVariant& submitVariant(shadervariants::ShaderId shader, uint32_t features)
+	{
+		auto [it, inserted] = variants.try_emplace(getVariantKey(shader, features));
+		if (!inserted) return it->second;
+
+		const shadervariants::ShaderDesc& desc = shaders[shader];
+		std::vector<std::string> defines = desc.defines;
+		for (size_t i = 0; i < desc.features.size(); i++)
+		{
+			if (features & (1u << i))
+				defines.push_back(desc.features[i]);
+		}
+
+		if (desc.gsFile.empty())
+			it->second.program = LoadShaderProgramAsync(desc.vsFile, desc.fsFile, defines);
+		else
+			it->second.program = LoadShaderProgramAsync(desc.vsFile, desc.gsFile, desc.fsFile, defines);
+		if (!it->second.program.handle)
+			it->second.state = VariantState::Failed;
+		return it->second;
+	}
+}
+//=============================================================================
+shadervariants::ShaderId shadervariants::Register(const ShaderDesc& desc)
+{
+	if (const ShaderId shader = Find(desc.name); shader != InvalidShader)
+		return shader;
+
+	if (desc.features.size() > MaxFeatures)
+	{
+		Error("Shader " + desc.name + " has more than " + std::to_string(MaxFeatures) + " features");
+		return InvalidShader;
+	}
+	shaders.push_back(desc);
+	return static_cast<ShaderId>(shaders.size() - 1);
+}
+//=============================================================================
+shadervariants::ShaderId shadervariants::Find(std::string_view name)
+{
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i].name == name)
+			return static_cast<ShaderId>(i);
+	}
+	return InvalidShader;
+}
+//=============================================================================
+uint32_t shadervariants::GetFeatureBit(ShaderId shader, std::string_view feature)
+{
+	if (shader >= shaders.size()) return 0;
+
+	const auto& features = shaders[shader].features;
+	for (size_t i = 0; i < features.size(); i++)
+	{
+		if (features[i] == feature)
+			return 1u << i;
+	}
+	return 0;
+}
+//=============================================================================
+void shadervariants::Request(ShaderId shader, uint32_t features)
+{
+	if (shader >= shaders.size()) return;
+	submitVariant(shader, features);
+}
+//=============================================================================
+bool shadervariants::LoadManifest(ShaderId shader, const std::string& path)
+{
+	if (shader >= shaders.size()) return false;
+
+	io::MappedFile file;
+	if (!file.Open(path))
+		return false;
+	const std::string_view text(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		size_t lineEnd = text.find('\n', pos);
+		if (lineEnd == std::string_view::npos) lineEnd = text.size();
+		std::string_view line = text.substr(pos, lineEnd - pos);
+		pos = lineEnd + 1;
+
+		if (const size_t comment = line.find('#'); comment != std::string_view::npos)
+			line = line.substr(0, comment);
+
+		uint32_t features = 0;
+		bool     hasTokens = false;
+		size_t   tokenPos = 0;
+		while (tokenPos < line.size())
+		{
+			const size_t tokenStart = line.find_first_not_of(" \t\r", tokenPos);
+			if (tokenStart == std::string_view::npos) break;
+			size_t tokenEnd = line.find_first_of(" \t\r", tokenStart);
+			if (tokenEnd == std::string_view::npos) tokenEnd = line.size();
+			const std::string_view token = line.substr(tokenStart, tokenEnd - tokenStart);
+			tokenPos = tokenEnd;
+
+			hasTokens = true;
+			if (token == "none") continue;
+			const uint32_t bit = GetFeatureBit(shader, token);
+			if (!bit)
+				Warning("Unknown feature " + std::string(token) + " of shader " + shaders[shader].name + " in " + path);
+			features |= bit;
+		}
+		if (hasTokens)
+			submitVariant(shader, features);
+	}
+	return true;
+}
+//=============================================================================
+ProgramHandle shadervariants::Get(ShaderId shader, uint32_t features)
+{
+	if (shader >= shaders.size()) return {};
+
+	ShaderVariant& variant = submitVariant(shader, features);
+	if (variant.state == VariantState::Submitted)
+	{
+		if (FinishShaderProgram(variant.program))
+			variant.state = VariantState::Ready;
+		else
+		{
+			Error("Variant " + std::to_string(features) + " of shader " + shaders[shader].name + " failed");
+			variant.state = VariantState::Failed;
+		}
+	}
+	return variant.state == VariantState::Ready ? variant.program : ProgramHandle{};
+}
+//=============================================================================
+void shadervariants::Close()
+{
+	for (auto& [key, variant] : variants)
+	{
+		if (variant.program.handle)
+		{
+			FinishShaderProgram(variant.program); // releases the stages of a variant never used
+			glDeleteProgram(variant.program.handle);
+		}
+	}
+	variants.clear();
+	shaders.clear();
+}
+//=============================================================================
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include "OGLShader.h"
+
+// Shader permutations. A shader declares its feature bits, bit i adds "#define features[i]" to all stages. Variants are
+// looked up by (shader, feature mask): those listed in a manifest are submitted together (CreateShaderProgramAsync),
+// others are compiled the first time they are requested. Materials pick the mask of what they have, so the shader
+// branches on defines instead of uniforms
+namespace shadervariants
+{
+	using ShaderId = uint32_t;
+	constexpr ShaderId InvalidShader = ~0u;
+	constexpr size_t MaxFeatures = 32;
+
+	struct ShaderDesc final
+	{
+		std::string              name;
+		std::string              vsFile;
+		std::string              gsFile;   // optional
+		std::string              fsFile;
+		std::vector<std::string> defines;  // common to all variants
+		std::vector<std::string> features; // bit i of the mask
+	};
+
+	// a registered name returns the existing id
+	ShaderId Register(const ShaderDesc& desc);
+	ShaderId Find(std::string_view name);
+
+	// bit of the feature, 0 for an unknown name
+	uint32_t GetFeatureBit(ShaderId shader, std::string_view feature);
+
+	// submits the variant to the driver without waiting for it
+	void Request(ShaderId shader, uint32_t features);
+	// one variant per line, feature names separated by blanks ("none" for no features, '#' starts a comment)
+	bool LoadManifest(ShaderId shader, const std::string& path);
+
+	// the first call for a variant waits for it (or compiles it). {0} when it failed to build, it is not retried
+	ProgramHandle Get(ShaderId shader, uint32_t features);
+
+	// deletes all programs and shaders
+	void Close();
+} // namespace shadervariants
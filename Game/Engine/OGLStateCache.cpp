@@ -0,0 +1,824 @@
+﻿#include "stdafx.h"
+#include "OGLStateCache.h"
+//=============================================================================
+namespace
+{
+	constexpr GLuint UnknownName = ~0u;
+	constexpr GLenum UnknownEnum = ~0u;
+	constexpr int8_t UnknownFlag = -1;
+
+	enum TextureTarget : uint8_t
+	{
+		Texture1D,
+		Texture2D,
+		Texture3D,
+		Texture1DArray,
+		Texture2DArray,
+		TextureCube,
+		TextureRectangle,
+		TextureBuffer,
+		Texture2DMultisample,
+		Texture2DMultisampleArray,
+
+		TextureTargetCount
+	};
+
+	// generic binding points, the element array buffer is state of the VAO and kept apart
+	struct BufferBindingInfo final
+	{
+		GLenum target;
+		GLenum binding;
+	};
+	constexpr BufferBindingInfo BufferBindings[] = {
+		{ GL_ARRAY_BUFFER,              GL_ARRAY_BUFFER_BINDING },
+		{ GL_UNIFORM_BUFFER,            GL_UNIFORM_BUFFER_BINDING },
+		{ GL_COPY_READ_BUFFER,          GL_COPY_READ_BUFFER },  // the _BINDING aliases are GL 4.2
+		{ GL_COPY_WRITE_BUFFER,         GL_COPY_WRITE_BUFFER },
+		{ GL_PIXEL_PACK_BUFFER,         GL_PIXEL_PACK_BUFFER_BINDING },
+		{ GL_PIXEL_UNPACK_BUFFER,       GL_PIXEL_UNPACK_BUFFER_BINDING },
+		{ GL_TEXTURE_BUFFER,            GL_TEXTURE_BINDING_BUFFER },
+		{ GL_TRANSFORM_FEEDBACK_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER_BINDING }
+	};
+	constexpr size_t BufferBindingCount = std::size(BufferBindings);
+
+	constexpr GLenum Capabilities[] = {
+		GL_DEPTH_TEST, GL_STENCIL_TEST, GL_BLEND, GL_CULL_FACE, GL_MULTISAMPLE, GL_SCISSOR_TEST, GL_FRAMEBUFFER_SRGB, GL_POLYGON_OFFSET_FILL
+	};
+	constexpr size_t CapabilityCount = std::size(Capabilities);
+
+	struct StencilFunc final
+	{
+		bool operator==(const StencilFunc&) const noexcept = default;
+
+		GLenum func{ UnknownEnum };
+		GLint  ref{ 0 };
+		GLuint mask{ 0 };
+	};
+
+	struct ShadowState final
+	{
+		GLuint      program{ UnknownName };
+		GLuint      vertexArray{ UnknownName };
+		GLenum      activeTexture{ UnknownEnum };
+		GLuint      textures[MaxCachedTextureUnits][TextureTargetCount];
+		GLuint      samplers[MaxCachedTextureUnits];
+		GLuint      buffers[BufferBindingCount];
+		GLuint      elementBuffer{ UnknownName }; // of the bound VAO
+		GLint       packAlignment{ -1 };
+		GLint       unpackAlignment{ -1 };
+
+		int8_t      capabilities[CapabilityCount];
+		std::array<GLenum, 4> blendFunc{ UnknownEnum, UnknownEnum, UnknownEnum, UnknownEnum };
+		GLenum      depthFunc{ UnknownEnum };
+		int8_t      depthMask{ UnknownFlag };
+		StencilFunc stencilFunc[2]; // front, back
+		GLenum      cullFace{ UnknownEnum };
+		std::array<int8_t, 4> colorMask{ UnknownFlag, UnknownFlag, UnknownFlag, UnknownFlag };
+		GLenum      polygonMode{ UnknownEnum };
+	};
+
+	// entry points of the driver, glad points to the hooks
+	struct DriverProcs final
+	{
+		PFNGLUSEPROGRAMPROC         useProgram{ nullptr };
+		PFNGLDELETEPROGRAMPROC      deleteProgram{ nullptr };
+		PFNGLBINDVERTEXARRAYPROC    bindVertexArray{ nullptr };
+		PFNGLDELETEVERTEXARRAYSPROC deleteVertexArrays{ nullptr };
+		PFNGLGENVERTEXARRAYSPROC    genVertexArrays{ nullptr };
+		PFNGLBINDBUFFERPROC         bindBuffer{ nullptr };
+		PFNGLBINDBUFFERBASEPROC     bindBufferBase{ nullptr };
+		PFNGLBINDBUFFERRANGEPROC    bindBufferRange{ nullptr };
+		PFNGLDELETEBUFFERSPROC      deleteBuffers{ nullptr };
+		PFNGLPIXELSTOREIPROC        pixelStorei{ nullptr };
+		PFNGLACTIVETEXTUREPROC      activeTexture{ nullptr };
+		PFNGLBINDTEXTUREPROC        bindTexture{ nullptr };
+		PFNGLDELETETEXTURESPROC     deleteTextures{ nullptr };
+		PFNGLBINDSAMPLERPROC        bindSampler{ nullptr };
+		PFNGLDELETESAMPLERSPROC     deleteSamplers{ nullptr };
+		PFNGLENABLEPROC             enable{ nullptr };
+		PFNGLDISABLEPROC            disable{ nullptr };
+		PFNGLBLENDFUNCPROC          blendFunc{ nullptr };
+		PFNGLBLENDFUNCSEPARATEPROC  blendFuncSeparate{ nullptr };
+		PFNGLDEPTHFUNCPROC          depthFunc{ nullptr };
+		PFNGLDEPTHMASKPROC          depthMask{ nullptr };
+		PFNGLSTENCILFUNCPROC        stencilFunc{ nullptr };
+		PFNGLSTENCILFUNCSEPARATEPROC stencilFuncSeparate{ nullptr };
+		PFNGLCULLFACEPROC           cullFace{ nullptr };
+		PFNGLCOLORMASKPROC          colorMask{ nullptr };
+		PFNGLPOLYGONMODEPROC        polygonMode{ nullptr };
+	};
+
+	ShadowState     shadow;
+	DriverProcs     driver;
+	StateCacheStats stats;
+
+	// element array buffer of every VAO created since InitStateCache, a VAO that is not in the map is unknown
+	std::unordered_map<GLuint, GLuint> vertexArrayElements;
+
+	// bumped by every issued change of the pipeline state, a pipeline object is current only while it does not move
+	uint64_t             pipelineVersion{ 0 };
+	PipelineStateHandle  currentPipeline{ 0 };
+	uint64_t             currentPipelineVersion{ 0 };
+	std::vector<GLState> pipelines;
+
+	void invalidateBindings()
+	{
+		shadow.program = UnknownName;
+		shadow.vertexArray = UnknownName;
+		shadow.activeTexture = UnknownEnum;
+		for (auto& unit : shadow.textures)
+			std::fill(std::begin(unit), std::end(unit), UnknownName);
+		std::fill(std::begin(shadow.samplers), std::end(shadow.samplers), UnknownName);
+		std::fill(std::begin(shadow.buffers), std::end(shadow.buffers), UnknownName);
+		shadow.elementBuffer = UnknownName;
+		shadow.packAlignment = -1;
+		shadow.unpackAlignment = -1;
+		vertexArrayElements.clear();
+	}
+
+	// a new context holds the initial values, reading them needs no query
+	void setInitialBindings()
+	{
+		shadow.program = 0;
+		shadow.vertexArray = 0;
+		shadow.activeTexture = GL_TEXTURE0;
+		for (auto& unit : shadow.textures)
+			std::fill(std::begin(unit), std::end(unit), 0);
+		std::fill(std::begin(shadow.samplers), std::end(shadow.samplers), 0);
+		std::fill(std::begin(shadow.buffers), std::end(shadow.buffers), 0);
+		shadow.elementBuffer = 0;
+		shadow.packAlignment = 4;
+		shadow.unpackAlignment = 4;
+		vertexArrayElements = { { 0, 0 } };
+	}
+
+	void invalidateCapability(GLenum cap)
+	{
+		for (size_t i = 0; i < CapabilityCount; i++)
+		{
+			if (Capabilities[i] == cap) shadow.capabilities[i] = UnknownFlag;
+		}
+		currentPipeline.handle = 0;
+	}
+
+	template<typename T>
+	bool changeState(StateCall call, T& current, const T& value) noexcept
+	{
+		if (current == value)
+		{
+			stats.skipped[static_cast<size_t>(call)]++;
+			return false;
+		}
+		current = value;
+		stats.issued[static_cast<size_t>(call)]++;
+		return true;
+	}
+
+	bool changePipelineState(StateCall call, auto& current, const auto& value) noexcept
+	{
+		if (!changeState(call, current, value))
+			return false;
+		pipelineVersion++;
+		return true;
+	}
+
+	void issued(StateCall call) noexcept
+	{
+		stats.issued[static_cast<size_t>(call)]++;
+	}
+
+	int getCapabilityIndex(GLenum cap) noexcept
+	{
+		for (size_t i = 0; i < CapabilityCount; i++)
+		{
+			if (Capabilities[i] == cap) return static_cast<int>(i);
+		}
+		return -1;
+	}
+
+	int getBufferBinding(GLenum target) noexcept
+	{
+		for (size_t i = 0; i < BufferBindingCount; i++)
+		{
+			if (BufferBindings[i].target == target) return static_cast<int>(i);
+		}
+		return -1;
+	}
+
+	GLint* getPixelStore(GLenum pname) noexcept
+	{
+		switch (pname)
+		{
+		case GL_PACK_ALIGNMENT:   return &shadow.packAlignment;
+		case GL_UNPACK_ALIGNMENT: return &shadow.unpackAlignment;
+		default:                  return nullptr;
+		}
+	}
+
+	GLuint queryInteger(GLenum pname)
+	{
+		GLint value{ 0 };
+		glGetIntegerv(pname, &value);
+		return static_cast<GLuint>(value);
+	}
+
+	int getTextureTarget(GLenum target) noexcept
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_1D:                   return Texture1D;
+		case GL_TEXTURE_2D:                   return Texture2D;
+		case GL_TEXTURE_3D:                   return Texture3D;
+		case GL_TEXTURE_1D_ARRAY:             return Texture1DArray;
+		case GL_TEXTURE_2D_ARRAY:             return Texture2DArray;
+		case GL_TEXTURE_CUBE_MAP:             return TextureCube;
+		case GL_TEXTURE_RECTANGLE:            return TextureRectangle;
+		case GL_TEXTURE_BUFFER:               return TextureBuffer;
+		case GL_TEXTURE_2D_MULTISAMPLE:       return Texture2DMultisample;
+		case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return Texture2DMultisampleArray;
+		default:                              return -1;
+		}
+	}
+
+	GLenum getTextureBinding(GLenum target) noexcept
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_1D:                   return GL_TEXTURE_BINDING_1D;
+		case GL_TEXTURE_2D:                   return GL_TEXTURE_BINDING_2D;
+		case GL_TEXTURE_3D:                   return GL_TEXTURE_BINDING_3D;
+		case GL_TEXTURE_1D_ARRAY:             return GL_TEXTURE_BINDING_1D_ARRAY;
+		case GL_TEXTURE_2D_ARRAY:             return GL_TEXTURE_BINDING_2D_ARRAY;
+		case GL_TEXTURE_2D_MULTISAMPLE:       return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+		case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY;
+		case GL_TEXTURE_BUFFER:               return GL_TEXTURE_BINDING_BUFFER;
+		case GL_TEXTURE_CUBE_MAP:             return GL_TEXTURE_BINDING_CUBE_MAP;
+		case GL_TEXTURE_RECTANGLE:            return GL_TEXTURE_BINDING_RECTANGLE;
+		default: std::unreachable();
+		}
+	}
+
+	GLenum getPolygonMode(PolygonMode mode) noexcept
+	{
+		switch (mode) {
+		case PolygonMode::Point: return GL_POINT;
+		case PolygonMode::Line:  return GL_LINE;
+		case PolygonMode::Fill:  return GL_FILL;
+		default: std::unreachable();
+		}
+	}
+
+	bool isSameState(const GLState& a, const GLState& b) noexcept
+	{
+		return a.depthState.enable == b.depthState.enable
+			&& a.depthState.depthFunc == b.depthState.depthFunc
+			&& a.depthState.depthMask == b.depthState.depthMask
+			&& a.stencilState.enable == b.stencilState.enable
+			&& a.stencilState.frontFunc == b.stencilState.frontFunc
+			&& a.stencilState.backFunc == b.stencilState.backFunc
+			&& a.stencilState.frontRef == b.stencilState.frontRef
+			&& a.stencilState.backRef == b.stencilState.backRef
+			&& a.stencilState.frontMask == b.stencilState.frontMask
+			&& a.stencilState.backMask == b.stencilState.backMask
+			&& a.blendState.enable == b.blendState.enable
+			&& a.blendState.srcRGB == b.blendState.srcRGB
+			&& a.blendState.dstRGB == b.blendState.dstRGB
+			&& a.blendState.srcAlpha == b.blendState.srcAlpha
+			&& a.blendState.dstAlpha == b.blendState.dstAlpha
+			&& a.multisampleState.enable == b.multisampleState.enable
+			&& a.colorMaskState.r == b.colorMaskState.r
+			&& a.colorMaskState.g == b.colorMaskState.g
+			&& a.colorMaskState.b == b.colorMaskState.b
+			&& a.colorMaskState.a == b.colorMaskState.a
+			&& a.cullState.enable == b.cullState.enable
+			&& a.cullState.cullFace == b.cullState.cullFace
+			&& a.polygonState.mode == b.polygonState.mode;
+	}
+
+	//-------------------------------------------------------------------------
+	// hooks
+	//-------------------------------------------------------------------------
+	void GLAD_API_PTR hookUseProgram(GLuint program)
+	{
+		if (changeState(StateCall::Program, shadow.program, program))
+			driver.useProgram(program);
+	}
+
+	void GLAD_API_PTR hookDeleteProgram(GLuint program)
+	{
+		// a deleted program stays in use until another one is bound, its name is not reliable anymore
+		if (program && shadow.program == program)
+			shadow.program = UnknownName;
+		driver.deleteProgram(program);
+	}
+
+	GLuint getVertexArrayElements(GLuint vao)
+	{
+		auto it = vertexArrayElements.find(vao);
+		return it != vertexArrayElements.end() ? it->second : UnknownName;
+	}
+
+	void GLAD_API_PTR hookBindVertexArray(GLuint vao)
+	{
+		if (changeState(StateCall::VertexArray, shadow.vertexArray, vao))
+		{
+			driver.bindVertexArray(vao);
+			shadow.elementBuffer = getVertexArrayElements(vao);
+		}
+	}
+
+	void GLAD_API_PTR hookGenVertexArrays(GLsizei n, GLuint* arrays)
+	{
+		driver.genVertexArrays(n, arrays);
+		for (GLsizei i = 0; i < n; i++)
+			vertexArrayElements[arrays[i]] = 0;
+	}
+
+	void GLAD_API_PTR hookDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+	{
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (!arrays[i]) continue;
+			vertexArrayElements.erase(arrays[i]);
+			if (shadow.vertexArray == arrays[i])
+			{
+				shadow.vertexArray = 0;
+				shadow.elementBuffer = getVertexArrayElements(0);
+			}
+		}
+		driver.deleteVertexArrays(n, arrays);
+	}
+
+	void GLAD_API_PTR hookBindBuffer(GLenum target, GLuint buffer)
+	{
+		if (target == GL_ELEMENT_ARRAY_BUFFER)
+		{
+			if (shadow.vertexArray == UnknownName)
+			{
+				issued(StateCall::Buffer);
+				driver.bindBuffer(target, buffer);
+				shadow.elementBuffer = buffer;
+			}
+			else if (changeState(StateCall::Buffer, shadow.elementBuffer, buffer))
+			{
+				driver.bindBuffer(target, buffer);
+				vertexArrayElements[shadow.vertexArray] = buffer;
+			}
+			return;
+		}
+		const int index = getBufferBinding(target);
+		if (index < 0)
+		{
+			issued(StateCall::Buffer);
+			driver.bindBuffer(target, buffer);
+		}
+		else if (changeState(StateCall::Buffer, shadow.buffers[index], buffer))
+			driver.bindBuffer(target, buffer);
+	}
+
+	// an indexed binding sets the generic binding of the target too
+	void GLAD_API_PTR hookBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		if (const int binding = getBufferBinding(target); binding >= 0)
+			shadow.buffers[binding] = buffer;
+		issued(StateCall::Buffer);
+		driver.bindBufferBase(target, index, buffer);
+	}
+
+	void GLAD_API_PTR hookBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+	{
+		if (const int binding = getBufferBinding(target); binding >= 0)
+			shadow.buffers[binding] = buffer;
+		issued(StateCall::Buffer);
+		driver.bindBufferRange(target, index, buffer, offset, size);
+	}
+
+	void GLAD_API_PTR hookDeleteBuffers(GLsizei n, const GLuint* buffers)
+	{
+		// GL binds 0 to the bindings of the context and of the bound VAO, other VAOs keep the name
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (!buffers[i]) continue;
+			for (GLuint& binding : shadow.buffers)
+			{
+				if (binding == buffers[i]) binding = 0;
+			}
+			if (shadow.elementBuffer == buffers[i])
+			{
+				shadow.elementBuffer = 0;
+				if (shadow.vertexArray != UnknownName)
+					vertexArrayElements[shadow.vertexArray] = 0;
+			}
+		}
+		driver.deleteBuffers(n, buffers);
+	}
+
+	void GLAD_API_PTR hookPixelStorei(GLenum pname, GLint param)
+	{
+		GLint* value = getPixelStore(pname);
+		if (!value)
+		{
+			issued(StateCall::PixelStore);
+			driver.pixelStorei(pname, param);
+		}
+		else if (changeState(StateCall::PixelStore, *value, param))
+			driver.pixelStorei(pname, param);
+	}
+
+	void GLAD_API_PTR hookActiveTexture(GLenum texture)
+	{
+		if (changeState(StateCall::ActiveTexture, shadow.activeTexture, texture))
+			driver.activeTexture(texture);
+	}
+
+	void GLAD_API_PTR hookBindTexture(GLenum target, GLuint texture)
+	{
+		const GLuint unit = shadow.activeTexture - GL_TEXTURE0;
+		const int targetIndex = getTextureTarget(target);
+		if (shadow.activeTexture == UnknownEnum || unit >= MaxCachedTextureUnits || targetIndex < 0)
+		{
+			issued(StateCall::Texture);
+			driver.bindTexture(target, texture);
+			return;
+		}
+		if (changeState(StateCall::Texture, shadow.textures[unit][targetIndex], texture))
+			driver.bindTexture(target, texture);
+	}
+
+	void GLAD_API_PTR hookDeleteTextures(GLsizei n, const GLuint* textures)
+	{
+		// GL binds 0 to every unit the texture was bound to
+		for (GLsizei i = 0; i < n; i++)
+		{
+			if (!textures[i]) continue;
+			for (auto& unit : shadow.textures)
+			{
+				for (GLuint& binding : unit)
+				{
+					if (binding == textures[i]) binding = 0;
+				}
+			}
+		}
+		driver.deleteTextures(n, textures);
+	}
+
+	void GLAD_API_PTR hookBindSampler(GLuint unit, GLuint sampler)
+	{
+		if (unit >= MaxCachedTextureUnits)
+		{
+			issued(StateCall::Sampler);
+			driver.bindSampler(unit, sampler);
+			return;
+		}
+		if (changeState(StateCall::Sampler, shadow.samplers[unit], sampler))
+			driver.bindSampler(unit, sampler);
+	}
+
+	void GLAD_API_PTR hookDeleteSamplers(GLsizei count, const GLuint* samplers)
+	{
+		for (GLsizei i = 0; i < count; i++)
+		{
+			if (!samplers[i]) continue;
+			for (GLuint& binding : shadow.samplers)
+			{
+				if (binding == samplers[i]) binding = 0;
+			}
+		}
+		driver.deleteSamplers(count, samplers);
+	}
+
+	void GLAD_API_PTR hookEnable(GLenum cap)
+	{
+		const int index = getCapabilityIndex(cap);
+		if (index < 0)
+		{
+			issued(StateCall::Capability);
+			driver.enable(cap);
+		}
+		else if (changePipelineState(StateCall::Capability, shadow.capabilities[index], int8_t{ 1 }))
+			driver.enable(cap);
+	}
+
+	void GLAD_API_PTR hookDisable(GLenum cap)
+	{
+		const int index = getCapabilityIndex(cap);
+		if (index < 0)
+		{
+			issued(StateCall::Capability);
+			driver.disable(cap);
+		}
+		else if (changePipelineState(StateCall::Capability, shadow.capabilities[index], int8_t{ 0 }))
+			driver.disable(cap);
+	}
+
+	void GLAD_API_PTR hookBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+	{
+		const std::array<GLenum, 4> value = { srcRGB, dstRGB, srcAlpha, dstAlpha };
+		if (changePipelineState(StateCall::BlendFunc, shadow.blendFunc, value))
+			driver.blendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+	}
+
+	void GLAD_API_PTR hookBlendFunc(GLenum sfactor, GLenum dfactor)
+	{
+		hookBlendFuncSeparate(sfactor, dfactor, sfactor, dfactor);
+	}
+
+	void GLAD_API_PTR hookDepthFunc(GLenum func)
+	{
+		if (changePipelineState(StateCall::DepthFunc, shadow.depthFunc, func))
+			driver.depthFunc(func);
+	}
+
+	void GLAD_API_PTR hookDepthMask(GLboolean flag)
+	{
+		if (changePipelineState(StateCall::DepthMask, shadow.depthMask, static_cast<int8_t>(flag ? 1 : 0)))
+			driver.depthMask(flag);
+	}
+
+	void GLAD_API_PTR hookStencilFuncSeparate(GLenum face, GLenum func, GLint ref, GLuint mask)
+	{
+		const StencilFunc value{ func, ref, mask };
+		bool changed = false;
+		if (face == GL_FRONT || face == GL_FRONT_AND_BACK)
+			changed |= changePipelineState(StateCall::StencilFunc, shadow.stencilFunc[0], value);
+		if (face == GL_BACK || face == GL_FRONT_AND_BACK)
+			changed |= changePipelineState(StateCall::StencilFunc, shadow.stencilFunc[1], value);
+		if (changed)
+			driver.stencilFuncSeparate(face, func, ref, mask);
+	}
+
+	void GLAD_API_PTR hookStencilFunc(GLenum func, GLint ref, GLuint mask)
+	{
+		hookStencilFuncSeparate(GL_FRONT_AND_BACK, func, ref, mask);
+	}
+
+	void GLAD_API_PTR hookCullFace(GLenum mode)
+	{
+		if (changePipelineState(StateCall::CullFace, shadow.cullFace, mode))
+			driver.cullFace(mode);
+	}
+
+	void GLAD_API_PTR hookColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+	{
+		const std::array<int8_t, 4> value = { int8_t(red ? 1 : 0), int8_t(green ? 1 : 0), int8_t(blue ? 1 : 0), int8_t(alpha ? 1 : 0) };
+		if (changePipelineState(StateCall::ColorMask, shadow.colorMask, value))
+			driver.colorMask(red, green, blue, alpha);
+	}
+
+	void GLAD_API_PTR hookPolygonMode(GLenum face, GLenum mode)
+	{
+		// core profile accepts only GL_FRONT_AND_BACK
+		if (face != GL_FRONT_AND_BACK)
+		{
+			shadow.polygonMode = UnknownEnum;
+			pipelineVersion++;
+			issued(StateCall::PolygonMode);
+			driver.polygonMode(face, mode);
+		}
+		else if (changePipelineState(StateCall::PolygonMode, shadow.polygonMode, mode))
+			driver.polygonMode(face, mode);
+	}
+
+	template<typename Proc>
+	void installHook(Proc& gladProc, Proc& driverProc, Proc hook)
+	{
+		// glad reloaded for a new context points to the driver again
+		if (gladProc == hook) return;
+		driverProc = gladProc;
+		gladProc = hook;
+	}
+}
+//=============================================================================
+uint64_t StateCacheStats::GetIssued() const noexcept
+{
+	uint64_t count = 0;
+	for (const uint64_t value : issued) count += value;
+	return count;
+}
+//=============================================================================
+uint64_t StateCacheStats::GetSkipped() const noexcept
+{
+	uint64_t count = 0;
+	for (const uint64_t value : skipped) count += value;
+	return count;
+}
+//=============================================================================
+void InitStateCache()
+{
+	installHook(glad_glUseProgram, driver.useProgram, hookUseProgram);
+	installHook(glad_glDeleteProgram, driver.deleteProgram, hookDeleteProgram);
+	installHook(glad_glBindVertexArray, driver.bindVertexArray, hookBindVertexArray);
+	installHook(glad_glDeleteVertexArrays, driver.deleteVertexArrays, hookDeleteVertexArrays);
+	installHook(glad_glGenVertexArrays, driver.genVertexArrays, hookGenVertexArrays);
+	installHook(glad_glBindBuffer, driver.bindBuffer, hookBindBuffer);
+	installHook(glad_glBindBufferBase, driver.bindBufferBase, hookBindBufferBase);
+	installHook(glad_glBindBufferRange, driver.bindBufferRange, hookBindBufferRange);
+	installHook(glad_glDeleteBuffers, driver.deleteBuffers, hookDeleteBuffers);
+	installHook(glad_glPixelStorei, driver.pixelStorei, hookPixelStorei);
+	installHook(glad_glActiveTexture, driver.activeTexture, hookActiveTexture);
+	installHook(glad_glBindTexture, driver.bindTexture, hookBindTexture);
+	installHook(glad_glDeleteTextures, driver.deleteTextures, hookDeleteTextures);
+	installHook(glad_glBindSampler, driver.bindSampler, hookBindSampler);
+	installHook(glad_glDeleteSamplers, driver.deleteSamplers, hookDeleteSamplers);
+	installHook(glad_glEnable, driver.enable, hookEnable);
+	installHook(glad_glDisable, driver.disable, hookDisable);
+	installHook(glad_glBlendFunc, driver.blendFunc, hookBlendFunc);
+	installHook(glad_glBlendFuncSeparate, driver.blendFuncSeparate, hookBlendFuncSeparate);
+	installHook(glad_glDepthFunc, driver.depthFunc, hookDepthFunc);
+	installHook(glad_glDepthMask, driver.depthMask, hookDepthMask);
+	installHook(glad_glStencilFunc, driver.stencilFunc, hookStencilFunc);
+	installHook(glad_glStencilFuncSeparate, driver.stencilFuncSeparate, hookStencilFuncSeparate);
+	installHook(glad_glCullFace, driver.cullFace, hookCullFace);
+	installHook(glad_glColorMask, driver.colorMask, hookColorMask);
+	installHook(glad_glPolygonMode, driver.polygonMode, hookPolygonMode);
+
+	InvalidateStateCache();
+	setInitialBindings();
+	ResetStateCacheStats();
+}
+//=============================================================================
+void InvalidateStateCache()
+{
+	invalidateBindings();
+	std::fill(std::begin(shadow.capabilities), std::end(shadow.capabilities), UnknownFlag);
+	ResetStateAll();
+}
+//=============================================================================
+GLuint GetBoundBuffer(GLenum target)
+{
+	if (target == GL_ELEMENT_ARRAY_BUFFER)
+	{
+		if (shadow.elementBuffer == UnknownName)
+		{
+			shadow.elementBuffer = queryInteger(GL_ELEMENT_ARRAY_BUFFER_BINDING);
+			if (shadow.vertexArray != UnknownName)
+				vertexArrayElements[shadow.vertexArray] = shadow.elementBuffer;
+		}
+		return shadow.elementBuffer;
+	}
+	const int index = getBufferBinding(target);
+	assert(index >= 0);
+	if (shadow.buffers[index] == UnknownName)
+		shadow.buffers[index] = queryInteger(BufferBindings[index].binding);
+	return shadow.buffers[index];
+}
+//=============================================================================
+GLuint GetBoundTexture(GLenum target)
+{
+	if (shadow.activeTexture == UnknownEnum)
+		shadow.activeTexture = queryInteger(GL_ACTIVE_TEXTURE);
+
+	const GLuint unit = shadow.activeTexture - GL_TEXTURE0;
+	const int targetIndex = getTextureTarget(target);
+	assert(targetIndex >= 0);
+	if (unit >= MaxCachedTextureUnits)
+		return queryInteger(getTextureBinding(target));
+
+	GLuint& binding = shadow.textures[unit][targetIndex];
+	if (binding == UnknownName)
+		binding = queryInteger(getTextureBinding(target));
+	return binding;
+}
+//=============================================================================
+GLint GetPixelStore(GLenum pname)
+{
+	GLint* value = getPixelStore(pname);
+	if (!value)
+		return static_cast<GLint>(queryInteger(pname));
+	if (*value < 0)
+		*value = static_cast<GLint>(queryInteger(pname));
+	return *value;
+}
+//=============================================================================
+StateCacheStats GetStateCacheStats()
+{
+	return stats;
+}
+//=============================================================================
+void ResetStateCacheStats()
+{
+	stats = {};
+}
+//=============================================================================
+void ResetStateDepth()
+{
+	invalidateCapability(GL_DEPTH_TEST);
+	shadow.depthFunc = UnknownEnum;
+	shadow.depthMask = UnknownFlag;
+}
+//=============================================================================
+void ResetStateStencil()
+{
+	invalidateCapability(GL_STENCIL_TEST);
+	shadow.stencilFunc[0] = {};
+	shadow.stencilFunc[1] = {};
+}
+//=============================================================================
+void ResetStateBlend()
+{
+	invalidateCapability(GL_BLEND);
+	shadow.blendFunc.fill(UnknownEnum);
+}
+//=============================================================================
+void ResetStateMultisample()
+{
+	invalidateCapability(GL_MULTISAMPLE);
+}
+//=============================================================================
+void ResetStateColorMaskState()
+{
+	shadow.colorMask.fill(UnknownFlag);
+	currentPipeline.handle = 0;
+}
+//=============================================================================
+void ResetStateCullState()
+{
+	invalidateCapability(GL_CULL_FACE);
+	shadow.cullFace = UnknownEnum;
+}
+//=============================================================================
+void ResetStatePolygonState()
+{
+	shadow.polygonMode = UnknownEnum;
+	currentPipeline.handle = 0;
+}
+//=============================================================================
+void ResetStateAll()
+{
+	ResetStateDepth();
+	ResetStateStencil();
+	ResetStateBlend();
+	ResetStateMultisample();
+	ResetStateColorMaskState();
+	ResetStateCullState();
+	ResetStatePolygonState();
+}
+//=============================================================================
+void BindState(const GLState& state)
+{
+	// every call goes through the cache, only the values that differ reach the driver
+	if (state.depthState.enable) glEnable(GL_DEPTH_TEST);
+	else glDisable(GL_DEPTH_TEST);
+	glDepthFunc(EnumToValue(state.depthState.depthFunc));
+	glDepthMask(state.depthState.depthMask ? GL_TRUE : GL_FALSE);
+
+	if (state.stencilState.enable) glEnable(GL_STENCIL_TEST);
+	else glDisable(GL_STENCIL_TEST);
+	glStencilFuncSeparate(GL_FRONT, EnumToValue(state.stencilState.frontFunc), state.stencilState.frontRef, state.stencilState.frontMask);
+	glStencilFuncSeparate(GL_BACK, EnumToValue(state.stencilState.backFunc), state.stencilState.backRef, state.stencilState.backMask);
+
+	if (state.blendState.enable) glEnable(GL_BLEND);
+	else glDisable(GL_BLEND);
+	glBlendFuncSeparate(
+		EnumToValue(state.blendState.srcRGB),
+		EnumToValue(state.blendState.dstRGB),
+		EnumToValue(state.blendState.srcAlpha),
+		EnumToValue(state.blendState.dstAlpha)
+	);
+
+	if (state.multisampleState.enable) glEnable(GL_MULTISAMPLE);
+	else glDisable(GL_MULTISAMPLE);
+
+	glColorMask(state.colorMaskState.r ? GL_TRUE : GL_FALSE,
+		state.colorMaskState.g ? GL_TRUE : GL_FALSE,
+		state.colorMaskState.b ? GL_TRUE : GL_FALSE,
+		state.colorMaskState.a ? GL_TRUE : GL_FALSE);
+
+	if (state.cullState.enable) glEnable(GL_CULL_FACE);
+	else glDisable(GL_CULL_FACE);
+	glCullFace(EnumToValue(state.cullState.cullFace));
+
+	glPolygonMode(GL_FRONT_AND_BACK, getPolygonMode(state.polygonState.mode));
+}
+//=============================================================================
+PipelineStateHandle CreatePipelineState(const GLState& state)
+{
+	for (size_t i = 0; i < pipelines.size(); i++)
+	{
+		if (isSameState(pipelines[i], state))
+			return { static_cast<uint32_t>(i + 1) };
+	}
+	pipelines.push_back(state);
+	return { static_cast<uint32_t>(pipelines.size()) };
+}
+//=============================================================================
+const GLState& GetPipelineState(PipelineStateHandle pipeline)
+{
+	assert(pipeline.handle > 0 && pipeline.handle <= pipelines.size());
+	return pipelines[pipeline.handle - 1];
+}
+//=============================================================================
+void BindPipelineState(PipelineStateHandle pipeline)
+{
+	if (pipeline.handle == currentPipeline.handle && pipelineVersion == currentPipelineVersion)
+	{
+		stats.skipped[static_cast<size_t>(StateCall::PipelineState)]++;
+		return;
+	}
+	stats.issued[static_cast<size_t>(StateCall::PipelineState)]++;
+
+	BindState(GetPipelineState(pipeline));
+	currentPipeline = pipeline;
+	currentPipelineVersion = pipelineVersion;
+}
+//=============================================================================
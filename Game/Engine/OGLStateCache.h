@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "NanoOpenGL3.h"
+
+//=============================================================================
+// State cache
+//=============================================================================
+
+// InitStateCache routes the glad entry points of the shadowed state through the cache, so every call in the engine
+// and the games is tracked and a call that sets the value already current never reaches the driver. Shadowed:
+// program, VAO, active texture unit, texture bindings and samplers of the first MaxCachedTextureUnits units,
+// buffer bindings (the element array buffer per VAO), pack and unpack alignment,
+// glEnable/glDisable of depth, stencil, blend, cull, multisample, scissor, sRGB and polygon offset, blend func,
+// depth func and mask, cull face, color mask, polygon mode. Code that changes state behind glad (a loader of its
+// own, as ImGui) must restore it or call InvalidateStateCache
+constexpr unsigned MaxCachedTextureUnits = 32;
+
+enum class StateCall : uint8_t
+{
+	Program,
+	VertexArray,
+	ActiveTexture,
+	Texture,
+	Sampler,
+	Buffer,
+	PixelStore,
+	Capability,
+	BlendFunc,
+	DepthFunc,
+	DepthMask,
+	StencilFunc,
+	CullFace,
+	ColorMask,
+	PolygonMode,
+	PipelineState,
+
+	Count
+};
+
+struct StateCacheStats final
+{
+	uint64_t issued[static_cast<size_t>(StateCall::Count)]{};
+	uint64_t skipped[static_cast<size_t>(StateCall::Count)]{};
+
+	uint64_t GetIssued() const noexcept;
+	uint64_t GetSkipped() const noexcept;
+};
+
+void InitStateCache();
+// every shadowed value becomes unknown, the next call of each is issued
+void InvalidateStateCache();
+
+// Current bindings read from the shadow. The context starts with known values, so glGetIntegerv is issued only
+// for a value made unknown by InvalidateStateCache, and once
+GLuint GetBoundBuffer(GLenum target);
+// binding of the active texture unit
+GLuint GetBoundTexture(GLenum target);
+// GL_PACK_ALIGNMENT, GL_UNPACK_ALIGNMENT
+GLint GetPixelStore(GLenum pname);
+
+StateCacheStats GetStateCacheStats();
+void ResetStateCacheStats();
+
+//=============================================================================
+// Pipeline state
+//=============================================================================
+
+// Immutable state object built from GLState. Identical states share one handle. Binding applies only the
+// fields that differ from the current GL state, binding the current object again costs nothing
+struct PipelineStateHandle final { uint32_t handle{ 0 }; }; // 0 is invalid
+
+PipelineStateHandle CreatePipelineState(const GLState& state);
+const GLState& GetPipelineState(PipelineStateHandle pipeline);
+void BindPipelineState(PipelineStateHandle pipeline);
@@ -64,4 +64,18 @@ void MeshVertex::SetVertexAttributes()
 	};
 	SpecifyVertexAttributes(vertexSize, attributes);
 }
+//=============================================================================
+void MeshVertexPacked::SetVertexAttributes()
+{
+	const size_t vertexSize = sizeof(MeshVertexPacked);
+	const VertexAttribute attributes[] =
+	{
+		{.type = DataType::UnsignedShort, .count = 4, .offset = (void*)offsetof(MeshVertexPacked, position), .normalized = true},
+		{.type = DataType::UnsignedByte,  .count = 4, .offset = (void*)offsetof(MeshVertexPacked, color),    .normalized = true},
+		{.type = DataType::Short,         .count = 2, .offset = (void*)offsetof(MeshVertexPacked, normal),   .normalized = true},
+		{.type = DataType::HalfFloat,     .count = 2, .offset = (void*)offsetof(MeshVertexPacked, texCoord)},
+		{.type = DataType::Short,         .count = 2, .offset = (void*)offsetof(MeshVertexPacked, tangent),  .normalized = true},
+	};
+	SpecifyVertexAttributes(vertexSize, attributes);
+}
 //=============================================================================
\ No newline at end of file
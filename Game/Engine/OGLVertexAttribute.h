@@ -55,4 +55,17 @@ struct MeshVertex final
 	glm::vec3 bitangent{ 0.0f };
 
 	static void SetVertexAttributes();
-};
\ No newline at end of file
+};
+
+// Quantized MeshVertex (24 bytes instead of 68), same attribute locations. Decoded in the vertex shader (data/shaders/vertexDecode.glsl)
+struct MeshVertexPacked final
+{
+	uint16_t position[4]{}; // unorm16 inside the mesh AABB, w - bitangent sign (0 = -1, 65535 = +1)
+	uint8_t  color[4]{};    // unorm8
+	int16_t  normal[2]{};   // octahedral snorm16
+	uint16_t texCoord[2]{}; // half float
+	int16_t  tangent[2]{};  // octahedral snorm16
+
+	static void SetVertexAttributes();
+};
+static_assert(sizeof(MeshVertexPacked) == 24);
\ No newline at end of file
@@ -26,6 +26,13 @@
 #endif
 
 #include <cmath>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 #include <fstream>
 #include <iostream>
 #include <filesystem>
@@ -38,10 +45,15 @@
 #include <span>
 #include <set>
 #include <array>
+#include <bit>
+#include <charconv>
+#include <cstring>
 #include <stack>
 #include <vector>
 #include <map>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <glad/gl.h>
 
@@ -79,19 +79,19 @@ void RPBlinnPhong::Draw(const RPDirectionalLightsShadowMap& rpShadowMap, const s
 	{
 		auto& l = dirLights[i];
 
-		SetUniform(GetUniformLocation(m_program, std::string("light[" + std::to_string(i) + "].type")), 0);
-		SetUniform(GetUniformLocation(m_program, std::string("light[" + std::to_string(i) + "].position")), l->position);
-		SetUniform(GetUniformLocation(m_program, std::string("light[" + std::to_string(i) + "].direction")), l->direction);
-		SetUniform(GetUniformLocation(m_program, std::string("light[" + std::to_string(i) + "].ambientStrength")), l->ambientStrength);
-		SetUniform(GetUniformLocation(m_program, std::string("light[" + std::to_string(i) + "].diffuseStrength")), l->diffuseStrength);
-		SetUniform(GetUniformLocation(m_program, std::string("light[" + std::to_string(i) + "].specularStrength")), l->specularStrength);
+		SetUniform(GetUniformLocation(m_program, "light", i, "type"), 0);
+		SetUniform(GetUniformLocation(m_program, "light", i, "position"), l->position);
+		SetUniform(GetUniformLocation(m_program, "light", i, "direction"), l->direction);
+		SetUniform(GetUniformLocation(m_program, "light", i, "ambientStrength"), l->ambientStrength);
+		SetUniform(GetUniformLocation(m_program, "light", i, "diffuseStrength"), l->diffuseStrength);
+		SetUniform(GetUniformLocation(m_program, "light", i, "specularStrength"), l->specularStrength);
 
 		glm::vec3 lightPosition = l->position;
 		glm::vec3 lightTarget = lightPosition + l->direction;
 		glm::mat4 lightView = glm::lookAt(lightPosition, lightTarget, glm::vec3(0.0f, 1.0f, 0.0f));
 		rpShadowMap.GetDepthFBO()[depthMapIndex].BindDepthTexture(textureOffset);
-		SetUniform(GetUniformLocation(m_program, "depthMap[" + std::to_string(depthMapIndex) + "]"), textureOffset);
-		SetUniform(GetUniformLocation(m_program, "light[" + std::to_string(i) + "].lightSpaceMatrix"), rpShadowMap.GetProjection() * lightView);
+		SetUniform(GetUniformLocation(m_program, "depthMap", depthMapIndex), textureOffset);
+		SetUniform(GetUniformLocation(m_program, "light", i, "lightSpaceMatrix"), rpShadowMap.GetProjection() * lightView);
 		depthMapIndex++;
 		textureOffset++;
 
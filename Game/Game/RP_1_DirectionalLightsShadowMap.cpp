@@ -107,6 +107,7 @@ void RPDirectionalLightsShadowMap::drawScene(const glm::mat4& lightSpaceMatrix,
 			mesh.Draw(GL_TRIANGLES);
 		}
 	}
+	geometry::ResetBinding();
 }
 //=============================================================================
 void RPDirectionalLightsShadowMap::BindDepthTexture(size_t id, unsigned slot) const
@@ -4,6 +4,11 @@
 #include "NanoLog.h"
 #include "NanoWindow.h"
 //=============================================================================
+namespace
+{
+	constexpr float ViewFarPlane = 1000.0f;
+}
+//=============================================================================
 bool RPMainScene::Init(uint16_t framebufferWidth, uint16_t framebufferHeight)
 {
 	setSize(framebufferWidth, framebufferHeight);
@@ -44,11 +49,10 @@ void RPMainScene::Draw(const RPDirectionalLightsShadowMap& rpShadowMap, const Ga
 	{
 		const auto* light = gameData.dirLights[i];
 
-		std::string prefix = "dirLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "direction"), light->direction);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
-		SetUniform(GetUniformLocation(m_program, prefix + "depthMap"), textureOffset);
-		SetUniform(GetUniformLocation(m_program, prefix + "lightSpaceMatrix"), rpShadowMap.GetLightSpaceMatrix(i));
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "direction"), light->direction);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "depthMap"), textureOffset);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "lightSpaceMatrix"), rpShadowMap.GetLightSpaceMatrix(i));
 
 		rpShadowMap.BindDepthTexture(i, textureOffset);
 
@@ -60,9 +64,8 @@ void RPMainScene::Draw(const RPDirectionalLightsShadowMap& rpShadowMap, const Ga
 	{
 		const auto* light = gameData.pointLights[i];
 
-		std::string prefix = "pointLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "position"), light->position);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "pointLight", i, "position"), light->position);
+		SetUniform(GetUniformLocation(m_program, "pointLight", i, "color"), light->color);
 	}
 	SetUniform(GetUniformLocation(m_program, "pointLightCount"), (int)gameData.numPointLights);
 
@@ -81,50 +84,66 @@ void RPMainScene::Resize(uint16_t framebufferWidth, uint16_t framebufferHeight)
 //=============================================================================
 void RPMainScene::drawScene(const GameWorldDataO& gameData)
 {
-	Texture2DHandle albedoTex{ 0 };
-	Texture2DHandle normalTex{ 0 };
-	Texture2DHandle metallicRoughnessTex{ 0 };
-	Texture2DHandle aoTex{ 0 };
-	Texture2DHandle emissiveTex{ 0 };
-
-	for (size_t i = 0; i < gameData.numGameObject; i++)
-	{
-		if (!gameData.gameObjects[i] || !gameData.gameObjects[i]->visible)
-			continue;
-
-		SetUniform(m_modelMatrixId, gameData.gameObjects[i]->modelMat);
-
-		const auto& meshes = gameData.gameObjects[i]->model.GetMeshes();
-		for (const auto& mesh : meshes)
+	// units: 0 - albedo, 1 - normal, 2 - metallic roughness, 3 - ambient occlusion, 4 - emissive. The materials have
+	// no ambient occlusion and emissive maps yet
+	const glm::vec3 cameraPosition = gameData.camera->Position;
+	m_queue.Clear();
+	m_queue.Build(gameData.numGameObject, [&](size_t i, std::vector<DrawPacket>& packets)
 		{
-			const auto& material = mesh.GetPbrMaterial();
-			albedoTex.handle = 0;
-			normalTex.handle = 0;
-			metallicRoughnessTex.handle = 0;
-			aoTex.handle = 0;
-			emissiveTex.handle = 0;
-			if (material)
+			if (!gameData.gameObjects[i] || !gameData.gameObjects[i]->visible)
+				return;
+
+			const glm::mat4& modelMat = gameData.gameObjects[i]->modelMat;
+			const auto& meshes = gameData.gameObjects[i]->model.GetMeshes();
+			for (const auto& mesh : meshes)
 			{
-				albedoTex = material->albedoTexture.id;
-				normalTex = material->normalTexture.id;
-				metallicRoughnessTex = material->metallicRoughnessTexture.id;
+				DrawMaterial drawMaterial{};
+				const auto& material = mesh.GetPbrMaterial();
+				if (material)
+				{
+					drawMaterial.textures[0] = material->albedoTexture.id.handle;
+					drawMaterial.textures[1] = material->normalTexture.id.handle;
+					drawMaterial.textures[2] = material->metallicRoughnessTexture.id.handle;
+				}
+
+				DrawPacket packet{};
+				packet.mesh = &mesh;
+				packet.object = static_cast<uint32_t>(i);
+				packet.material = m_queue.GetMaterialId(drawMaterial);
+				packet.sortKey = MakeDrawSortKey(0, 0, packet.material, geometry::GetRange(mesh.GetGeometry()).vao, GetLodDistance(mesh.GetAABB(), modelMat, cameraPosition) / ViewFarPlane);
+				packets.push_back(packet);
 			}
+		});
+	m_queue.Sort();
 
-			SetUniform(m_hasAlbedoMapId, IsValid(albedoTex));
-			SetUniform(m_hasNormalMapId, IsValid(normalTex));
-			SetUniform(m_hasMetallicRoughnessMapId, IsValid(metallicRoughnessTex));
-			SetUniform(m_hasAOMapId, IsValid(aoTex));
-			SetUniform(m_hasEmissiveMapId, IsValid(emissiveTex));
+	constexpr uint32_t None = ~0u;
+	uint32_t object = None;
+	uint32_t material = None;
+	for (const DrawPacket& packet : m_queue.GetPackets())
+	{
+		if (object != packet.object)
+		{
+			object = packet.object;
+			SetUniform(m_modelMatrixId, gameData.gameObjects[object]->modelMat);
+		}
+		if (material != packet.material)
+		{
+			material = packet.material;
+			const auto& textures = m_queue.GetMaterial(material).textures;
 
-			BindTexture2D(0, albedoTex);
-			BindTexture2D(1, normalTex);
-			BindTexture2D(2, metallicRoughnessTex);
-			BindTexture2D(3, aoTex);
-			BindTexture2D(4, emissiveTex);
+			SetUniform(m_hasAlbedoMapId, IsValid(Texture2DHandle{ textures[0] }));
+			SetUniform(m_hasNormalMapId, IsValid(Texture2DHandle{ textures[1] }));
+			SetUniform(m_hasMetallicRoughnessMapId, IsValid(Texture2DHandle{ textures[2] }));
+			SetUniform(m_hasAOMapId, IsValid(Texture2DHandle{ textures[3] }));
+			SetUniform(m_hasEmissiveMapId, IsValid(Texture2DHandle{ textures[4] }));
 
-			mesh.Draw(GL_TRIANGLES);
+			for (size_t unit = 0; unit < textures.size(); unit++)
+				BindTexture2D(static_cast<GLenum>(unit), { textures[unit] });
 		}
+
+		packet.mesh->Draw(GL_TRIANGLES);
 	}
+	geometry::ResetBinding();
 }
 //=============================================================================
 bool RPMainScene::initProgram()
@@ -218,6 +237,6 @@ void RPMainScene::setSize(uint16_t framebufferWidth, uint16_t framebufferHeight)
 	m_framebufferWidth = framebufferWidth;
 	m_framebufferHeight = framebufferHeight;
 	const float aspect = (float)m_framebufferWidth / (float)m_framebufferHeight;
-	m_perspective = glm::perspective(glm::radians(60.0f), aspect, 0.01f, 1000.0f);
+	m_perspective = glm::perspective(glm::radians(60.0f), aspect, 0.01f, ViewFarPlane);
 }
 //=============================================================================
\ No newline at end of file
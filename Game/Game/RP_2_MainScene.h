@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "Framebuffer.h"
+#include "NanoRenderQueue.h"
 
 class RPDirectionalLightsShadowMap;
 struct GameWorldDataO;
@@ -44,6 +45,8 @@ private:
 	int       m_hasEmissiveMapId{ -1 };
 	int       m_opacityId{ -1 };
 
+	RenderQueue m_queue;
+
 	Framebuffer m_fbo;
 
 	SamplerHandle m_sampler{ 0 };
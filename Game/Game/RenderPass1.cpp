@@ -110,6 +110,7 @@ void OldRenderPass1::drawScene(const glm::mat4& lightSpaceMatrix, const GameWorl
 			mesh.Draw(GL_TRIANGLES);
 		}
 	}
+	geometry::ResetBinding();
 }
 //=============================================================================
 void OldRenderPass1::BindDepthTexture(size_t id, unsigned slot) const
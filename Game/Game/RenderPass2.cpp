@@ -45,12 +45,11 @@ void OldRenderPass2::Draw(const OldRenderPass1& rpShadowMap, const GameWorldData
 	{
 		const auto* light = gameData.dirLights[i];
 
-		std::string prefix = "dirLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "direction"), light->direction);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
-		SetUniform(GetUniformLocation(m_program, prefix + "luminosity"), light->luminosity);
-		SetUniform(GetUniformLocation(m_program, prefix + "depthMap"), textureOffset);
-		SetUniform(GetUniformLocation(m_program, prefix + "lightSpaceMatrix"), rpShadowMap.GetLightSpaceMatrix(i));
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "direction"), light->direction);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "luminosity"), light->luminosity);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "depthMap"), textureOffset);
+		SetUniform(GetUniformLocation(m_program, "dirLight", i, "lightSpaceMatrix"), rpShadowMap.GetLightSpaceMatrix(i));
 
 		rpShadowMap.BindDepthTexture(i, textureOffset);
 
@@ -62,11 +61,10 @@ void OldRenderPass2::Draw(const OldRenderPass1& rpShadowMap, const GameWorldData
 	{
 		const auto* light = gameData.pointLights[i];
 
-		std::string prefix = "pointLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "position"), light->position);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
-		SetUniform(GetUniformLocation(m_program, prefix + "attenuation"), light->attenuation);
-		SetUniform(GetUniformLocation(m_program, prefix + "intensity"), light->intensity);
+		SetUniform(GetUniformLocation(m_program, "pointLight", i, "position"), light->position);
+		SetUniform(GetUniformLocation(m_program, "pointLight", i, "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "pointLight", i, "attenuation"), light->attenuation);
+		SetUniform(GetUniformLocation(m_program, "pointLight", i, "intensity"), light->intensity);
 	}
 	SetUniform(GetUniformLocation(m_program, "pointLightCount"), (int)gameData.numPointLights);
 
@@ -74,14 +72,13 @@ void OldRenderPass2::Draw(const OldRenderPass1& rpShadowMap, const GameWorldData
 	{
 		const auto* light = gameData.spotLights[i];
 
-		std::string prefix = "spotLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "position"), light->position);
-		SetUniform(GetUniformLocation(m_program, prefix + "direction"), light->direction);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
-		SetUniform(GetUniformLocation(m_program, prefix + "attenuation"), light->attenuation);
-		SetUniform(GetUniformLocation(m_program, prefix + "intensity"), light->intensity);
-		SetUniform(GetUniformLocation(m_program, prefix + "cutOff"), light->cutOff);
-		SetUniform(GetUniformLocation(m_program, prefix + "outerCutOff"), light->outerCutOff);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "position"), light->position);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "direction"), light->direction);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "attenuation"), light->attenuation);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "intensity"), light->intensity);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "cutOff"), light->cutOff);
+		SetUniform(GetUniformLocation(m_program, "spotLight", i, "outerCutOff"), light->outerCutOff);
 
 	}
 	SetUniform(GetUniformLocation(m_program, "spotLightCount"), (int)gameData.numSpotLights);
@@ -90,11 +87,10 @@ void OldRenderPass2::Draw(const OldRenderPass1& rpShadowMap, const GameWorldData
 	{
 		const auto* light = gameData.boxLights[i];
 
-		std::string prefix = "ambientBoxLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "size"), light->size);
-		SetUniform(GetUniformLocation(m_program, prefix + "position"), light->position);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
-		SetUniform(GetUniformLocation(m_program, prefix + "intensity"), light->intensity);
+		SetUniform(GetUniformLocation(m_program, "ambientBoxLight", i, "size"), light->size);
+		SetUniform(GetUniformLocation(m_program, "ambientBoxLight", i, "position"), light->position);
+		SetUniform(GetUniformLocation(m_program, "ambientBoxLight", i, "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "ambientBoxLight", i, "intensity"), light->intensity);
 	}
 	SetUniform(GetUniformLocation(m_program, "ambientBoxLightCount"), (int)gameData.numBoxLights);
 
@@ -102,11 +98,10 @@ void OldRenderPass2::Draw(const OldRenderPass1& rpShadowMap, const GameWorldData
 	{
 		const auto* light = gameData.sphereLights[i];
 
-		std::string prefix = "ambientSphereLight[" + std::to_string(i) + "].";
-		SetUniform(GetUniformLocation(m_program, prefix + "position"), light->position);
-		SetUniform(GetUniformLocation(m_program, prefix + "color"), light->color);
-		SetUniform(GetUniformLocation(m_program, prefix + "intensity"), light->intensity);
-		SetUniform(GetUniformLocation(m_program, prefix + "radius"), light->radius);
+		SetUniform(GetUniformLocation(m_program, "ambientSphereLight", i, "position"), light->position);
+		SetUniform(GetUniformLocation(m_program, "ambientSphereLight", i, "color"), light->color);
+		SetUniform(GetUniformLocation(m_program, "ambientSphereLight", i, "intensity"), light->intensity);
+		SetUniform(GetUniformLocation(m_program, "ambientSphereLight", i, "radius"), light->radius);
 	}
 	SetUniform(GetUniformLocation(m_program, "ambientSphereLightCount"), (int)gameData.numSphereLights);
 
@@ -166,6 +161,7 @@ void OldRenderPass2::drawScene(const GameWorldData& gameData)
 			mesh.Draw(GL_TRIANGLES);
 		}
 	}
+	geometry::ResetBinding();
 }
 //=============================================================================
 bool OldRenderPass2::initProgram()
@@ -174,7 +174,7 @@ bool Scene::initBlinnPhongShader()
 	SetUniform(GetUniformLocation(m_blinnPhong, "normalTexture"), 2);
 	for (size_t i = 0; i < 10; i++)
 	{
-		SetUniform(GetUniformLocation(m_blinnPhong, "depthMap[" + std::to_string(i) + "]"), 4+(int)i);
+		SetUniform(GetUniformLocation(m_blinnPhong, "depthMap", i), 4+(int)i);
 	}
 
 	m_blinnPhongMatrixUBO = CreateBuffer(BufferTarget::Uniform, BufferUsage::DynamicDraw, sizeof(SceneBlinnPhongMatrices), nullptr);
@@ -294,32 +294,32 @@ void Scene::colorMultisamplePass()
 		{
 			auto& l = m_directionalLights[i];
 
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i) + "].type")), static_cast<int>(l.GetType()));
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i) + "].position")), l.GetPosition());
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i) + "].direction")), l.GetDirection());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "type"), static_cast<int>(l.GetType()));
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "position"), l.GetPosition());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "direction"), l.GetDirection());
 			// if BLINN_PHONG
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i) + "].ambientStrength")), l.GetAmbientStrength());
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i) + "].diffuseStrength")), l.GetDiffuseStrength());
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i) + "].specularStrength")), l.GetSpecularStrength());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "ambientStrength"), l.GetAmbientStrength());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "diffuseStrength"), l.GetDiffuseStrength());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "specularStrength"), l.GetSpecularStrength());
 			// elif PBR
-			//SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + dOffset) + "].color")), l.GetDiffuseStrength());
+			//SetUniform(GetUniformLocation(m_blinnPhong, "light", i + dOffset, "color"), l.GetDiffuseStrength());
 			dOffset++;
 		}
 		for (int i{ 0 }; i < m_spotLights.size(); ++i)
 		{
 			auto& l = m_spotLights[i];
 
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].type")), static_cast<int>(l.GetType()));
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].cutOff")), cosf(l.GetCutOff()));
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].outerCutOff")), cosf(l.GetOuterCutOff()));
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].position")), l.GetPosition());
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].direction")), l.GetDirection());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "type"), static_cast<int>(l.GetType()));
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "cutOff"), cosf(l.GetCutOff()));
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "outerCutOff"), cosf(l.GetOuterCutOff()));
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "position"), l.GetPosition());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "direction"), l.GetDirection());
 			// if BLINN_PHONG
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].ambientStrength")), l.GetAmbientStrength());
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].diffuseStrength")), l.GetDiffuseStrength());
-			SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].specularStrength")), l.GetSpecularStrength());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "ambientStrength"), l.GetAmbientStrength());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "diffuseStrength"), l.GetDiffuseStrength());
+			SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "specularStrength"), l.GetSpecularStrength());
 			// elif PBR
-			//SetUniform(GetUniformLocation(m_blinnPhong, std::string("light[" + std::to_string(i + sOffset) + "].color")), sLights.at(i)->getDiffuseStrength());
+			//SetUniform(GetUniformLocation(m_blinnPhong, "light", i + sOffset, "color"), sLights.at(i)->getDiffuseStrength());
 		}
 	}
 
@@ -338,8 +338,8 @@ void Scene::colorMultisamplePass()
 
 		glActiveTexture(GL_TEXTURE0 + textureOffset);
 		glBindTexture(GL_TEXTURE_2D, m_stdDepth[depthMapIndex]->GetAttachments().at(0).id);
-		SetUniform(GetUniformLocation(m_blinnPhong, "depthMap[" + std::to_string(depthMapIndex) + "]"), textureOffset);
-		SetUniform(GetUniformLocation(m_blinnPhong, "light[" + std::to_string(i) + "].lightSpaceMatrix"), m_orthoProjection * lightView);
+		SetUniform(GetUniformLocation(m_blinnPhong, "depthMap", depthMapIndex), textureOffset);
+		SetUniform(GetUniformLocation(m_blinnPhong, "light", i, "lightSpaceMatrix"), m_orthoProjection * lightView);
 		depthMapIndex++;
 		textureOffset++;
 	}
@@ -358,8 +358,8 @@ void Scene::colorMultisamplePass()
 
 		glActiveTexture(GL_TEXTURE0 + textureOffset);
 		glBindTexture(GL_TEXTURE_2D, m_stdDepth[depthMapIndex]->GetAttachments().at(0).id);
-		SetUniform(GetUniformLocation(m_blinnPhong, "depthMap[" + std::to_string(depthMapIndex) + "]"), textureOffset);
-		SetUniform(GetUniformLocation(m_blinnPhong, "light[" + std::to_string(i + nbDLights) + "].lightSpaceMatrix"), spotProj * lightView);
+		SetUniform(GetUniformLocation(m_blinnPhong, "depthMap", depthMapIndex), textureOffset);
+		SetUniform(GetUniformLocation(m_blinnPhong, "light", i + nbDLights, "lightSpaceMatrix"), spotProj * lightView);
 		depthMapIndex++;
 		textureOffset++;
 	}
@@ -1,9 +1,14 @@
-#include "stdafx.h"
+﻿#include "stdafx.h"
 #include "GameModel.h"
 //=============================================================================
 bool GameModel::LoadModel(const std::string& fileName)
 {
-	if (!m_data.model.Load(fileName, ModelMaterialType::BlinnPhong))
+	ModelLoadInfo loadInfo{};
+	loadInfo.optimize = true; // shadow passes draw every mesh once per light
+	loadInfo.generateLods = true;
+	loadInfo.vertexFormat = MeshVertexFormat::Packed;
+	loadInfo.buildMeshlets = true; // large level meshes are culled per cluster in every pass
+	if (!m_data.model.Load(fileName, ModelMaterialType::BlinnPhong, loadInfo))
 		return false;
 
 	return true;
@@ -11,6 +16,8 @@ bool GameModel::LoadModel(const std::string& fileName)
 //=============================================================================
 void GameModel::SetupParameters(ProgramHandle program)
 {
+	// only cull and blend belong to the model, the rest is the state of the pass. The state cache drops the calls
+	// that set the current value
 	switch (m_data.faceVisibility)
 	{
 	case FaceVisibility::Front:
@@ -31,14 +38,8 @@ void GameModel::SetupParameters(ProgramHandle program)
 	if (m_data.transparency)
 	{
 		glEnable(GL_BLEND);
-		if (m_data.blendingType == BlendingType::Normal)
-		{
-			glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
-		}
-		else if (m_data.blendingType == BlendingType::Additive)
-		{
-			glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO); // TODO: Change to additive blending
-		}
+		// TODO: Change to additive blending for BlendingType::Additive
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ZERO);
 	}
 	else
 	{
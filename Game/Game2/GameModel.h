@@ -35,6 +35,8 @@ struct GameModelData final
 	bool           transparency{ false };
 	BlendingType   blendingType{ BlendingType::Normal };
 	FaceVisibility faceVisibility{ FaceVisibility::Front };
+
+	std::vector<uint8_t> meshLods; // per mesh level of detail, selected by the main pass
 };
 
 /*
@@ -16,6 +16,10 @@ bool GameScene::Init()
 	if (!m_rpComposite.Init(wndWidth, wndHeight))
 		return false;
 
+	// all programs are in the driver queue now, the first link status read waits only for the slowest one
+	if (!m_shadowMap.InitProgram() || !m_rpMainScene.InitProgram() || !m_rpComposite.InitProgram())
+		return false;
+
 	return true;
 }
 //=============================================================================
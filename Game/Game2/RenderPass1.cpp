@@ -7,8 +7,9 @@ bool RenderPass1::Init(ShadowQuality shadowQuality)
 	m_shadowQuality = shadowQuality;
 	m_pointLightProj = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, m_shadowFarPlane);
 
-	if (!initProgram())
-		return false;
+	// only submitted, the uniforms are resolved in InitProgram
+	m_programDirLight = LoadShaderProgramAsync("data/shaders2/DirLightShadowVert.shader", "data/shaders2/DirLightShadowFrag.shader");
+	m_programPointLight = LoadShaderProgramAsync("data/shaders2/PointLightShadowVert.shader", "data/shaders2/PointLightShadowGeom.shader", "data/shaders2/PointLightShadowFrag.shader");
 
 	if (!initFBO())
 		return false;
@@ -98,25 +99,15 @@ void RenderPass1::SetShadowQuality(ShadowQuality quality)
 //=============================================================================
 void RenderPass1::drawScene(GameDirectionalLight* currentLight, const GameWorldData& worldData)
 {
-	for (size_t i = 0; i < worldData.countGameModels; i++)
-	{
-		if (!worldData.gameModels[i] || !worldData.gameModels[i]->GetData().visible)
-			continue;
-		if (!worldData.gameModels[i]->IsActive())
-			continue;
-		if (!worldData.gameModels[i]->GetData().castShadows)
-			continue;
-
-		glm::mat4 lightSpaceMatrix = currentLight->GetLightTransformMatrix();
+	const glm::mat4 lightSpaceMatrix = currentLight->GetLightTransformMatrix();
 
-		SetUniform(m_dirLightMvpMatrixId, lightSpaceMatrix * worldData.gameModels[i]->GetTransform()->GetWorldMatrix());
+	MeshletCullInfo cullInfo{};
+	cullInfo.viewProj = lightSpaceMatrix;
+	cullInfo.orthographic = true;
+	cullInfo.viewDirection = glm::normalize(currentLight->GetShadowTarget() - currentLight->GetPosition());
 
-		const auto& meshes = worldData.gameModels[i]->GetData().model.GetMeshes();
-		for (const auto& mesh : meshes)
-		{
-			drawMesh(mesh, m_dirLightHasDiffuseMapId);
-		}
-	}
+	buildQueue(worldData, currentLight->GetPosition(), lightSpaceMatrix);
+	drawQueue(cullInfo, m_dirLightMvpMatrixId, m_dirLightHasDiffuseMapId, m_dirLightVertexDecode);
 }
 //=============================================================================
 void RenderPass1::drawScene(GamePointLight* currentLight, const GameWorldData& worldData)
@@ -139,43 +130,91 @@ void RenderPass1::drawScene(GamePointLight* currentLight, const GameWorldData& w
 	SetUniform(m_pointLightLightPosId, lpos);
 	SetUniform(m_pointLightFarPlaneId, m_shadowFarPlane);
 
-	for (size_t i = 0; i < worldData.countGameModels; i++)
-	{
-		if (!worldData.gameModels[i] || !worldData.gameModels[i]->GetData().visible)
-			continue;
-		if (!worldData.gameModels[i]->IsActive())
-			continue;
-		if (!worldData.gameModels[i]->GetData().castShadows)
-			continue;
-
-		SetUniform(m_pointLightModelMatrixId, worldData.gameModels[i]->GetTransform()->GetWorldMatrix());
+	// the geometry shader draws all six faces at once, cull by the light range only
+	MeshletCullInfo cullInfo{};
+	cullInfo.frustumCulling = false;
+	cullInfo.viewPosition = lpos;
+	cullInfo.maxDistance = m_shadowFarPlane;
 
-		const auto& meshes = worldData.gameModels[i]->GetData().model.GetMeshes();
-		for (const auto& mesh : meshes)
+	// the shader takes the model matrix, the cube matrices are set above
+	buildQueue(worldData, lpos, glm::mat4(1.0f));
+	drawQueue(cullInfo, m_pointLightModelMatrixId, m_pointLightHasDiffuseMapId, m_pointLightVertexDecode);
+}
+//=============================================================================
+void RenderPass1::buildQueue(const GameWorldData& worldData, const glm::vec3& lightPosition, const glm::mat4& viewProj)
+{
+	// one program per light, the key holds the material, the geometry page and the distance to the light. Objects are
+	// split over the job system
+	m_objects.resize(worldData.countGameModels);
+	m_queue.Clear();
+	m_queue.Build(worldData.countGameModels, [&](size_t i, std::vector<DrawPacket>& packets)
 		{
-			drawMesh(mesh, m_pointLightHasDiffuseMapId);
-		}
-	}
+			if (!worldData.gameModels[i] || !worldData.gameModels[i]->GetData().visible)
+				return;
+			if (!worldData.gameModels[i]->IsActive())
+				return;
+			if (!worldData.gameModels[i]->GetData().castShadows)
+				return;
+
+			const GameModelData& data = worldData.gameModels[i]->GetData();
+			ObjectMatrices& object = m_objects[i];
+			object.world = worldData.gameModels[i]->GetTransform()->GetWorldMatrix();
+			object.viewProjWorld = viewProj * object.world;
+			const glm::mat4& worldMatrix = object.world;
+			const auto& meshes = data.model.GetMeshes();
+			for (size_t meshId = 0; meshId < meshes.size(); meshId++)
+			{
+				const Mesh& mesh = meshes[meshId];
+
+				// levels from the previous main pass, the shadow pass runs first
+				const size_t mainLod = meshId < data.meshLods.size() ? data.meshLods[meshId] : 0;
+				const int lod = static_cast<int>(mainLod) + m_shadowLodBias;
+
+				// only the diffuse map for the alpha test
+				DrawMaterial drawMaterial{};
+				const auto& material = mesh.GetMaterial();
+				if (material && !material->diffuseTextures.empty() && IsValid(material->diffuseTextures[0]))
+					drawMaterial.textures[0] = material->diffuseTextures[0].id.handle;
+
+				const glm::vec3 center = worldMatrix * glm::vec4(mesh.GetAABB().GetCenter(), 1.0f);
+
+				DrawPacket packet{};
+				packet.mesh = &mesh;
+				packet.object = static_cast<uint32_t>(i);
+				packet.material = m_queue.GetMaterialId(drawMaterial);
+				packet.lod = static_cast<uint32_t>(std::clamp(lod, 0, std::max(static_cast<int>(mesh.GetNumLods()) - 1, 0)));
+				packet.sortKey = MakeDrawSortKey(0, 0, packet.material, geometry::GetRange(mesh.GetGeometry()).vao, glm::distance(lightPosition, center) / m_shadowFarPlane);
+				packets.push_back(packet);
+			}
+		});
+	m_queue.Sort();
 }
 //=============================================================================
-void RenderPass1::drawMesh(const Mesh& mesh, int hasDiffuseMapId)
+void RenderPass1::drawQueue(MeshletCullInfo& cullInfo, int matrixId, int hasDiffuseMapId, const VertexDecodeUniforms& vertexDecode)
 {
-	const auto& material = mesh.GetMaterial();
-	bool hasDiffuseMap = false;
-	Texture2DHandle diffuseTex{ 0 };
-	if (material)
+	constexpr uint32_t None = ~0u;
+	uint32_t object = None;
+	uint32_t material = None;
+	for (const DrawPacket& packet : m_queue.GetPackets())
 	{
-		if (!material->diffuseTextures.empty())
+		if (object != packet.object)
 		{
-			hasDiffuseMap = IsValid(material->diffuseTextures[0]);
-			diffuseTex = material->diffuseTextures[0].id;
+			object = packet.object;
+			cullInfo.worldMatrix = m_objects[object].world;
+			SetUniform(matrixId, m_objects[object].viewProjWorld);
+		}
+		if (material != packet.material)
+		{
+			material = packet.material;
+			const GLuint diffuseTex = m_queue.GetMaterial(material).textures[0];
+			SetUniform(hasDiffuseMapId, diffuseTex != 0);
+			BindTexture2D(0, { diffuseTex });
 		}
-	}
-
-	SetUniform(hasDiffuseMapId, hasDiffuseMap);
-	BindTexture2D(0, diffuseTex);
 
-	mesh.Draw(GL_TRIANGLES);
+		vertexDecode.Set(*packet.mesh);
+		packet.mesh->DrawCulled(cullInfo, m_drawRanges, packet.lod);
+	}
+	geometry::ResetBinding();
 }
 //=============================================================================
 void RenderPass1::BindDirLightDepthTexture(size_t id, unsigned slot) const
@@ -198,12 +237,11 @@ void RenderPass1::BindPointLightDepthTexture(size_t id, unsigned slot) const
 	m_depthFBOPointLights[id].BindDepthTexture(slot);
 }
 //=============================================================================
-bool RenderPass1::initProgram()
+bool RenderPass1::InitProgram()
 {
 	// DIRECTIONAL SHADER
 	{
-		m_programDirLight = LoadShaderProgram("data/shaders2/DirLightShadowVert.shader", "data/shaders2/DirLightShadowFrag.shader");
-		if (!m_programDirLight.handle)
+		if (!FinishShaderProgram(m_programDirLight))
 		{
 			Fatal("Scene Shadow Mapping Shader failed!");
 			return false;
@@ -218,12 +256,13 @@ bool RenderPass1::initProgram()
 		assert(m_dirLightHasDiffuseMapId > -1);
 		m_dirLightMvpMatrixId = GetUniformLocation(m_programDirLight, "mvpMatrix");
 		assert(m_dirLightMvpMatrixId > -1);
+		m_dirLightVertexDecode.Init(m_programDirLight);
+		assert(m_dirLightVertexDecode.packed > -1);
 	}
 
 	// POINT SHADER
 	{
-		m_programPointLight = LoadShaderProgram("data/shaders2/PointLightShadowVert.shader", "data/shaders2/PointLightShadowGeom.shader", "data/shaders2/PointLightShadowFrag.shader");
-		if (!m_programPointLight.handle)
+		if (!FinishShaderProgram(m_programPointLight))
 		{
 			Fatal("Scene Shadow Mapping Shader failed!");
 			return false;
@@ -238,10 +277,12 @@ bool RenderPass1::initProgram()
 		assert(m_pointLightHasDiffuseMapId > -1);
 		m_pointLightModelMatrixId = GetUniformLocation(m_programPointLight, "model");
 		assert(m_pointLightModelMatrixId > -1);
+		m_pointLightVertexDecode.Init(m_programPointLight);
+		assert(m_pointLightVertexDecode.packed > -1);
 
 		for (size_t i = 0; i < 6; i++)
 		{
-			m_pointLightCubeMatricesId[i] = GetUniformLocation(m_programPointLight, "cubeMatrices[" + std::to_string(i) + "]");
+			m_pointLightCubeMatricesId[i] = GetUniformLocation(m_programPointLight, "cubeMatrices", i);
 			assert(m_pointLightCubeMatricesId[i] > -1);
 		}
 
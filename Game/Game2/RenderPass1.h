@@ -15,6 +15,7 @@ enum class ShadowQuality
 };
 
 struct GameWorldData;
+struct GameModelData;
 
 /*
 TODO: под каждую карту теней свой FBO. это возможно не эффективно.
@@ -25,7 +26,10 @@ TODO: под каждую карту теней свой FBO. это возмо
 class RenderPass1 final
 {
 public:
+	// Init submits the programs, InitProgram waits for them and resolves the uniforms. The scene calls Init of
+	// every pass first so that the driver compiles all programs together
 	bool Init(ShadowQuality shadowQuality);
+	bool InitProgram();
 	void Close();
 
 	void RenderShadows(const GameWorldData& worldData);
@@ -39,20 +43,36 @@ public:
 
 	float GetShadowFarPlane() const { return m_shadowFarPlane; }
 
+	// shadow maps use coarser levels of detail than the main pass
+	void SetShadowLodBias(int bias) { m_shadowLodBias = bias; }
+
 private:
-	bool initProgram();
 	bool initFBO();
 	void drawScene(GameDirectionalLight* currentLight, const GameWorldData& worldData);
 	void drawScene(GamePointLight* currentLight, const GameWorldData& worldData);
-	void drawMesh(const Mesh& mesh, int hasDiffuseMapId);
+	// per object matrices, filled by the workers that build the queue
+	struct ObjectMatrices final
+	{
+		glm::mat4 world;
+		glm::mat4 viewProjWorld;
+	};
+
+	// matrixId of drawQueue gets viewProj * world of every object
+	void buildQueue(const GameWorldData& worldData, const glm::vec3& lightPosition, const glm::mat4& viewProj);
+	void drawQueue(MeshletCullInfo& cullInfo, int matrixId, int hasDiffuseMapId, const VertexDecodeUniforms& vertexDecode);
 
 	ShadowQuality                                m_shadowQuality;
 	glm::mat4                                    m_pointLightProj;  // for point lights
 	float                                        m_shadowFarPlane{ 100.0f };
+	int                                          m_shadowLodBias{ 1 };
+	RenderQueue                                  m_queue;
+	std::vector<ObjectMatrices>                  m_objects;
+	MeshDrawRanges                               m_drawRanges;
 
 	ProgramHandle                                m_programDirLight{ 0 };
 	int                                          m_dirLightMvpMatrixId{ -1 };
 	int                                          m_dirLightHasDiffuseMapId{ -1 };
+	VertexDecodeUniforms                         m_dirLightVertexDecode;
 
 	ProgramHandle                                m_programPointLight{ 0 };
 	int                                          m_pointLightModelMatrixId{ -1 };
@@ -60,6 +80,7 @@ private:
 	int                                          m_pointLightLightPosId{ -1 };
 	int                                          m_pointLightFarPlaneId{ -1 };
 	int                                          m_pointLightHasDiffuseMapId{ -1 };
+	VertexDecodeUniforms                         m_pointLightVertexDecode;
 
 	std::array<Framebuffer, MaxDirectionalLight> m_depthFBODirLights;
 	std::array<Framebuffer, MaxPointLight>       m_depthFBOPointLights;
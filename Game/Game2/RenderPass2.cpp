@@ -2,11 +2,15 @@
 #include "RenderPass2.h"
 #include "GameScene.h"
 //=============================================================================
+namespace
+{
+	constexpr float ViewFarPlane = 1000.0f;
+}
+//=============================================================================
 bool RenderPass2::Init(uint16_t framebufferWidth, uint16_t framebufferHeight)
 {
 	setSize(framebufferWidth, framebufferHeight);
-	if (!initProgram())
-		return false;
+	submitProgram();
 	if (!initFBO())
 		return false;
 
@@ -20,8 +24,8 @@ bool RenderPass2::Init(uint16_t framebufferWidth, uint16_t framebufferHeight)
 //=============================================================================
 void RenderPass2::Close()
 {
+	// the variants are owned by shadervariants
 	m_fbo.Destroy();
-	glDeleteProgram(m_program.handle);
 }
 //=============================================================================
 void RenderPass2::Draw(const RenderPass1& rpShadowMap, const GameWorldData& gameData)
@@ -33,45 +37,72 @@ void RenderPass2::Draw(const RenderPass1& rpShadowMap, const GameWorldData& game
 	glClearColor(0.3f, 0.4f, 0.9f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT /*| GL_STENCIL_BUFFER_BIT*/);
 
-	glUseProgram(m_program.handle);
+	// TODO: skybox
 
-	SetUniform(m_TileUId, 1.0f);
-	SetUniform(m_TileVId, 1.0f);
+	// shadow maps are bound once, every variant samples the same units
+	int textureOffset{ 6 };
+	std::array<int, MaxDirectionalLight> dirShadowUnits;
+	dirShadowUnits.fill(-1);
+	for (size_t i = 0; i < gameData.countGameDirectionalLights; i++)
+	{
+		if (!gameData.gameDirectionalLights[i]->GetCastShadows()) continue;
+		rpShadowMap.BindDirLightDepthTexture(i, textureOffset);
+		dirShadowUnits[i] = textureOffset++;
+	}
+	std::array<int, MaxPointLight> pointShadowUnits;
+	pointShadowUnits.fill(-1);
+	for (size_t i = 0; i < gameData.countGamePointLights; i++)
+	{
+		if (!gameData.gamePointLights[i]->GetCastShadows()) continue;
+		rpShadowMap.BindPointLightDepthTexture(i, textureOffset);
+		pointShadowUnits[i] = textureOffset++;
+	}
+
+	for (const ProgramUniforms& variant : m_variants)
+	{
+		glUseProgram(variant.program.handle);
+		setFrameUniforms(variant, rpShadowMap, gameData, dirShadowUnits, pointShadowUnits);
+	}
+
+	glBindSampler(0, m_sampler.handle);
+	drawScene(gameData, m_perspective, gameData.oldCamera->GetViewMatrix());
+	glBindSampler(0, 0);
+}
+//=============================================================================
+void RenderPass2::setFrameUniforms(const ProgramUniforms& variant, const RenderPass1& rpShadowMap, const GameWorldData& gameData, std::span<const int> dirShadowUnits, std::span<const int> pointShadowUnits)
+{
+	SetUniform(variant.tileU, 1.0f);
+	SetUniform(variant.tileV, 1.0f);
 
 	// Set materials
-	SetUniform(GetUniformLocation(m_program, "material.opacity"), 1.0f);
-	SetUniform(GetUniformLocation(m_program, "material.baseColor"), glm::vec3(1.0f));
-	SetUniform(GetUniformLocation(m_program, "material.specularity"), 1.0f);
-	SetUniform(GetUniformLocation(m_program, "material.shininess"), 10.0f);
+	SetUniform(variant.opacity, 1.0f);
+	SetUniform(variant.baseColor, glm::vec3(1.0f));
+	if (variant.specularity > -1) SetUniform(variant.specularity, 1.0f);
+	SetUniform(variant.shininess, 10.0f);
 
 	// set other uniforms
-	SetUniform(GetUniformLocation(m_program, "shadowsFarPlane"), rpShadowMap.GetShadowFarPlane());
-	SetUniform(GetUniformLocation(m_program, "ambientStrength"), 0.1f);
-	SetUniform(GetUniformLocation(m_program, "ambientColor"), glm::vec3(1.0f));
-	SetUniform(GetUniformLocation(m_program, "alphaTest"), true);
+	SetUniform(variant.shadowsFarPlane, rpShadowMap.GetShadowFarPlane());
+	SetUniform(variant.ambientStrength, 0.1f);
+	SetUniform(variant.ambientColor, glm::vec3(1.0f));
+	SetUniform(variant.alphaTest, true);
 
-	// TODO: skybox
-
-	int textureOffset{ 6 };
 	// Set Directional Lights
-	SetUniform(GetUniformLocation(m_program, "directionalLightsNumber"), (int)gameData.countGameDirectionalLights);
+	SetUniform(variant.directionalLightsNumber, (int)gameData.countGameDirectionalLights);
 	for (size_t i = 0; i < gameData.countGameDirectionalLights; i++)
 	{
 		auto* light = gameData.gameDirectionalLights[i];
-		const std::string idStr = std::to_string(i);
+		const auto& ids = variant.directionalLights[i];
 
 		glm::vec3 dir = gameData.oldCamera->GetViewMatrix() * glm::vec4(light->GetDirection(), 0.0f);
 
-		SetUniform(GetUniformLocation(m_program, "directionalLights[" + idStr + "].dir"), dir);
-		SetUniform(GetUniformLocation(m_program, "directionalLights[" + idStr + "].color"), light->GetColor());
-		SetUniform(GetUniformLocation(m_program, "directionalLights[" + idStr + "].intensity"), light->GetIntensity());
-		SetUniform(GetUniformLocation(m_program, "directionalLights[" + idStr + "].castShadows"), light->GetCastShadows());
+		SetUniform(ids.dir, dir);
+		SetUniform(ids.color, light->GetColor());
+		SetUniform(ids.intensity, light->GetIntensity());
+		SetUniform(ids.castShadows, light->GetCastShadows());
 		if (light->GetCastShadows())
 		{
-			rpShadowMap.BindDirLightDepthTexture(i, textureOffset);
-			SetUniform(GetUniformLocation(m_program, "directionalLights[" + idStr + "].shadowMap"), textureOffset);
-			SetUniform(GetUniformLocation(m_program, "directionalLights[" + idStr + "].lightViewProj"), light->GetLightTransformMatrix());
-			textureOffset++;
+			SetUniform(ids.shadowMap, dirShadowUnits[i]);
+			SetUniform(ids.lightViewProj, light->GetLightTransformMatrix());
 		}
 	}
 
@@ -79,37 +110,28 @@ void RenderPass2::Draw(const RenderPass1& rpShadowMap, const GameWorldData& game
 	// TODO:
 
 	// Set Point Lights
-	SetUniform(GetUniformLocation(m_program, "pointsLightsNumber"), (int)gameData.countGamePointLights);
+	SetUniform(variant.pointLightsNumber, (int)gameData.countGamePointLights);
 	for (size_t i = 0; i < gameData.countGamePointLights; i++)
 	{
 		auto* light = gameData.gamePointLights[i];
-		const std::string idStr = std::to_string(i);
+		const auto& ids = variant.pointLights[i];
 
 		glm::vec3 view = gameData.oldCamera->GetViewMatrix() * glm::vec4(light->GetPosition(), 0.0f);
 
-		SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].pos"), view);
-		SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].modelPos"), light->GetPosition());
-		SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].color"), light->GetColor());
-		SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].intensity"), light->GetIntensity());
+		SetUniform(ids.pos, view);
+		SetUniform(ids.modelPos, light->GetPosition());
+		SetUniform(ids.color, light->GetColor());
+		SetUniform(ids.intensity, light->GetIntensity());
 
-		//SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].constant"), light->GetConstant());
-		//SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].linear"), light->GetLinear());
-		//SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].quadratic"), light->GetQuadratic());
-		//SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].att"), light->GetAtt());
+		//SetUniform(GetUniformLocation(program, "pointLights", i, "constant"), light->GetConstant());
+		//SetUniform(GetUniformLocation(program, "pointLights", i, "linear"), light->GetLinear());
+		//SetUniform(GetUniformLocation(program, "pointLights", i, "quadratic"), light->GetQuadratic());
+		//SetUniform(GetUniformLocation(program, "pointLights", i, "att"), light->GetAtt());
 		
-		SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].castShadows"), light->GetCastShadows());
+		SetUniform(ids.castShadows, light->GetCastShadows());
 		if (light->GetCastShadows())
-		{
-			rpShadowMap.BindPointLightDepthTexture(i, textureOffset);
-			SetUniform(GetUniformLocation(m_program, "pointLights[" + idStr + "].shadowMap"), textureOffset);
-			textureOffset++;
-		}
+			SetUniform(ids.shadowMap, pointShadowUnits[i]);
 	}
-
-
-	glBindSampler(0, m_sampler.handle);
-	drawScene(gameData, m_perspective, gameData.oldCamera->GetViewMatrix());
-	glBindSampler(0, 0);
 }
 //=============================================================================
 void RenderPass2::Resize(uint16_t framebufferWidth, uint16_t framebufferHeight)
@@ -124,156 +146,231 @@ void RenderPass2::Resize(uint16_t framebufferWidth, uint16_t framebufferHeight)
 //=============================================================================
 void RenderPass2::drawScene(const GameWorldData& gameData, const glm::mat4& proj, const glm::mat4& view)
 {
-	bool hasDiffuseMap = false;
-	Texture2DHandle diffuseTex{ 0 };
-	bool hasSpecularMap = false;
-	Texture2DHandle specularTex{ 0 };
-	bool hasGlossMap = false;
-	Texture2DHandle glossTex{ 0 };
-	bool hasNormalMap = false;
-	Texture2DHandle normalTex{ 0 };
-	bool hasOpacityMap = false;
-	Texture2DHandle opacityTex{ 0 };
-
-	for (size_t i = 0; i < gameData.countGameModels; i++)
-	{
-		if (!gameData.gameModels[i] || !gameData.gameModels[i]->GetData().visible)
-			continue;
-		if (!gameData.gameModels[i]->IsActive())
-			continue;
-
-		SetUniform(GetUniformLocation(m_program, "material.receiveShadows"), gameData.gameModels[i]->GetData().receiveShadows);
-
-		SetUniform(m_modelMatrixId, gameData.gameModels[i]->GetTransform()->GetWorldMatrix());
-		SetUniform(m_modelViewMatrixId, view * gameData.gameModels[i]->GetTransform()->GetWorldMatrix());
-		SetUniform(m_modelViewProjMatrixId, proj * view * gameData.gameModels[i]->GetTransform()->GetWorldMatrix());
-
-		const auto& meshes = gameData.gameModels[i]->GetData().model.GetMeshes();
-		for (const auto& mesh : meshes)
+	LodSelectInfo lodInfo{};
+	lodInfo.projScale = GetLodProjScale(proj, static_cast<float>(m_framebufferHeight));
+	const glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+	const glm::mat4 viewProj = proj * view;
+
+	// face culling of this pass depends on the previous passes, only the frustum test is safe
+	MeshletCullInfo cullInfo{};
+	cullInfo.viewProj = viewProj;
+	cullInfo.viewPosition = cameraPosition;
+	cullInfo.coneCulling = false;
+
+	// one block per object in the frame ring, bound by range when the object changes
+	const size_t blockAlignment = framering::GetUniformAlignment();
+	const size_t objectStride = (sizeof(ObjectMatrices) + blockAlignment - 1) / blockAlignment * blockAlignment;
+	const FrameAllocation objectBlocks = framering::Allocate(gameData.countGameModels * objectStride);
+
+	// one packet per visible mesh, the key orders them by variant, material and geometry page, then front to back.
+	// Objects are split over the job system, each worker also computes the matrices of its objects
+	m_worldMatrices.resize(gameData.countGameModels);
+	m_queue.Clear();
+	m_queue.Build(gameData.countGameModels, [&](size_t i, std::vector<DrawPacket>& packets)
 		{
-			const auto& material = mesh.GetMaterial();
-			hasDiffuseMap = false;
-			diffuseTex.handle = 0;
-			hasSpecularMap = false;
-			specularTex.handle = 0;
-			hasGlossMap = false;
-			glossTex.handle = 0;
-			hasNormalMap = false;
-			normalTex.handle = 0;
-			hasOpacityMap = false;
-			opacityTex.handle = 0;
-
-			if (material)
+			if (!gameData.gameModels[i] || !gameData.gameModels[i]->GetData().visible)
+				return;
+			if (!gameData.gameModels[i]->IsActive())
+				return;
+
+			const glm::mat4& worldMatrix = m_worldMatrices[i] = gameData.gameModels[i]->GetTransform()->GetWorldMatrix();
+			ObjectMatrices object{ worldMatrix, view * worldMatrix, viewProj * worldMatrix };
+			std::memcpy(objectBlocks.data + i * objectStride, &object, sizeof(object));
+
+			const auto& meshes = gameData.gameModels[i]->GetData().model.GetMeshes();
+			auto& meshLods = gameData.gameModels[i]->GetData().meshLods;
+			meshLods.resize(meshes.size(), 0);
+			for (size_t meshId = 0; meshId < meshes.size(); meshId++)
 			{
-				if (!material->diffuseTextures.empty() && IsValid(material->diffuseTextures[0]))
+				const auto& mesh = meshes[meshId];
+				const float distance = GetLodDistance(mesh.GetAABB(), worldMatrix, cameraPosition);
+				meshLods[meshId] = static_cast<uint8_t>(mesh.SelectLod(distance, lodInfo, meshLods[meshId]));
+
+				// units: 0 - diffuse, 1 - normal, 2 - specular, 3 - gloss, 4 - opacity. Materials have no gloss and opacity maps yet
+				DrawMaterial drawMaterial{};
+				const auto& material = mesh.GetMaterial();
+				if (material)
 				{
-					hasDiffuseMap = true;
-					diffuseTex = material->diffuseTextures[0].id;
+					if (!material->diffuseTextures.empty() && IsValid(material->diffuseTextures[0]))
+						drawMaterial.textures[0] = material->diffuseTextures[0].id.handle;
+					if (!material->normalTextures.empty() && IsValid(material->normalTextures[0]))
+						drawMaterial.textures[1] = material->normalTextures[0].id.handle;
+					if (!material->specularTextures.empty() && IsValid(material->specularTextures[0]))
+						drawMaterial.textures[2] = material->specularTextures[0].id.handle;
 				}
-				if (!material->specularTextures.empty() && IsValid(material->specularTextures[0]))
-				{
-					hasSpecularMap = true;
-					specularTex = material->specularTextures[0].id;
-				}
-				//if (!material->.empty() && IsValid(material->[0]))
-				{
-					//hasGlossMap = true;
-					//glossTex = material->[0].id;
-				}
-				if (!material->normalTextures.empty() && IsValid(material->normalTextures[0]))
-				{
-					hasNormalMap = true;
-					normalTex = material->normalTextures[0].id;
-				}
-				//if (!material->.empty() && IsValid(material->[0]))
-				{
-					//hasOpacityMap = true;
-					//opacityTex = material->[0].id;
-				}
-			}
 
-			SetUniform(m_hasColorTexId, hasDiffuseMap);
-			BindTexture2D(0, diffuseTex);
-
-			SetUniform(m_hasNormalTexId, hasNormalMap);
-			BindTexture2D(1, normalTex);
+				DrawPacket packet{};
+				packet.mesh = &mesh;
+				packet.object = static_cast<uint32_t>(i);
+				packet.program = (drawMaterial.textures[1] ? MaterialFeature::NormalMap : 0u) | (drawMaterial.textures[2] ? MaterialFeature::SpecularMap : 0u);
+				packet.material = m_queue.GetMaterialId(drawMaterial);
+				packet.lod = meshLods[meshId];
+				packet.sortKey = MakeDrawSortKey(0, packet.program, packet.material, geometry::GetRange(mesh.GetGeometry()).vao, distance / ViewFarPlane);
+				packets.push_back(packet);
+			}
+		});
+	m_queue.Sort();
+
+	// uniforms belong to the program, a new variant sets the object and the material again
+	constexpr uint32_t None = ~0u;
+	const ProgramUniforms* variant = nullptr;
+	uint32_t object = None;
+	uint32_t material = None;
+	for (const DrawPacket& packet : m_queue.GetPackets())
+	{
+		if (variant != &m_variants[packet.program])
+		{
+			variant = &m_variants[packet.program];
+			glUseProgram(variant->program.handle);
+			object = None;
+			material = None;
+		}
+		if (object != packet.object)
+		{
+			object = packet.object;
+			cullInfo.worldMatrix = m_worldMatrices[object];
+			SetUniform(variant->receiveShadows, gameData.gameModels[object]->GetData().receiveShadows);
+			framering::Bind(GL_UNIFORM_BUFFER, ObjectBlockBinding, objectBlocks, static_cast<GLintptr>(object * objectStride), sizeof(ObjectMatrices));
+		}
+		if (material != packet.material)
+		{
+			material = packet.material;
+			const auto& textures = m_queue.GetMaterial(material).textures;
 
-			SetUniform(m_hasSpecularTexId, hasSpecularMap);
-			BindTexture2D(2, specularTex);
+			SetUniform(variant->hasColorTex, textures[0] != 0);
+			BindTexture2D(0, { textures[0] });
 
-			SetUniform(m_hasGlossTexId, hasGlossMap);
-			BindTexture2D(3, glossTex);
+			if (packet.program & MaterialFeature::NormalMap) BindTexture2D(1, { textures[1] });
+			if (packet.program & MaterialFeature::SpecularMap) BindTexture2D(2, { textures[2] });
 
-			SetUniform(m_hasOpacityTexId, hasOpacityMap);
-			BindTexture2D(4, opacityTex);
+			SetUniform(variant->hasGlossTex, textures[3] != 0);
+			BindTexture2D(3, { textures[3] });
 
-			mesh.Draw(GL_TRIANGLES);
+			SetUniform(variant->hasOpacityTex, textures[4] != 0);
+			BindTexture2D(4, { textures[4] });
 		}
+
+		variant->vertexDecode.Set(*packet.mesh);
+		packet.mesh->DrawCulled(cullInfo, m_drawRanges, packet.lod);
 	}
+	geometry::ResetBinding();
 }
 //=============================================================================
-bool RenderPass2::initProgram()
+void RenderPass2::submitProgram()
 {
-	const std::vector<std::string> defines = {
+	shadervariants::ShaderDesc desc{};
+	desc.name = "BlinnPhong";
+	desc.vsFile = "data/shaders2/BlinnPhong/vertexNew.shader";
+	desc.fsFile = "data/shaders2/BlinnPhong/fragmentNew.shader";
+	desc.defines = {
 		std::string("MAX_DIR_LIGHTS ") + std::to_string(MaxDirectionalLight),
 		std::string("MAX_POINT_LIGHTS ") + std::to_string(MaxPointLight),
 		std::string("MAX_SPOT_LIGHTS ") + std::to_string(MaxSpotLight),
 		std::string("MAX_AMBIENT_BOX_LIGHTS ") + std::to_string(MaxAmbientBoxLight),
 		std::string("MAX_AMBIENT_SPHERE_LIGHTS ") + std::to_string(MaxAmbientSphereLight),
 	};
+	desc.features = { "HAS_NORMAL_MAP", "HAS_SPECULAR_MAP" }; // order of MaterialFeature bits
 
-	m_program = LoadShaderProgram("data/shaders2/BlinnPhong/vertexNew.shader", "data/shaders2/BlinnPhong/fragmentNew.shader", defines);
-	if (!m_program.handle)
+	m_shader = shadervariants::Register(desc);
+	shadervariants::LoadManifest(m_shader, "data/shaders2/BlinnPhong/variants.manifest");
+}
+//=============================================================================
+bool RenderPass2::InitProgram()
+{
+	for (uint32_t features = 0; features < m_variants.size(); features++)
+	{
+		if (!initVariant(features, m_variants[features]))
+			return false;
+	}
+	return true;
+}
+//=============================================================================
+bool RenderPass2::initVariant(uint32_t features, ProgramUniforms& variant)
+{
+	variant.program = shadervariants::Get(m_shader, features);
+	if (!variant.program.handle)
 	{
 		Fatal("Scene Main RenderPass Shader failed!");
 		return false;
 	}
-	glUseProgram(m_program.handle);
+	const ProgramHandle program = variant.program;
+	glUseProgram(program.handle);
 
-	// texture bind slots
+	// texture bind slots, the samplers of missing features are optimized out
 	{
-		m_hasColorTexId = GetUniformLocation(m_program, "material.hasColorTex");
-		assert(m_hasColorTexId > -1);
-		m_colorTexId = GetUniformLocation(m_program, "material.colorTex");
-		assert(m_colorTexId > -1);
-		SetUniform(m_colorTexId, 0);
-
-		m_hasNormalTexId = GetUniformLocation(m_program, "material.hasNormalTex");
-		assert(m_hasNormalTexId > -1);
-		m_normalTexId = GetUniformLocation(m_program, "material.normalTex");
-		assert(m_normalTexId > -1);
-		SetUniform(m_normalTexId, 1);
-
-		m_hasSpecularTexId = GetUniformLocation(m_program, "material.hasSpecularTex");
-		assert(m_hasSpecularTexId > -1);
-		m_specularTexId = GetUniformLocation(m_program, "material.specularTex");
-		assert(m_specularTexId > -1);
-		SetUniform(m_specularTexId, 2);
-
-		m_hasGlossTexId = GetUniformLocation(m_program, "material.hasGlossTex");
-		assert(m_hasGlossTexId > -1);
-		m_glossTexId = GetUniformLocation(m_program, "material.glossTex");
-		assert(m_glossTexId > -1);
-		SetUniform(m_glossTexId, 3);
-
-		m_hasOpacityTexId = GetUniformLocation(m_program, "material.hasOpacityTex");
-		assert(m_hasOpacityTexId > -1);
-		m_opacityTexId = GetUniformLocation(m_program, "material.opacityTex");
-		assert(m_opacityTexId > -1);
-		SetUniform(m_opacityTexId, 4);
+		variant.hasColorTex = GetUniformLocation(program, "material.hasColorTex");
+		assert(variant.hasColorTex > -1);
+		const int colorTexId = GetUniformLocation(program, "material.colorTex");
+		assert(colorTexId > -1);
+		SetUniform(colorTexId, 0);
+
+		const int normalTexId = GetUniformLocation(program, "material.normalTex");
+		assert(!(features & MaterialFeature::NormalMap) || normalTexId > -1);
+		if (normalTexId > -1) SetUniform(normalTexId, 1);
+
+		const int specularTexId = GetUniformLocation(program, "material.specularTex");
+		assert(!(features & MaterialFeature::SpecularMap) || specularTexId > -1);
+		if (specularTexId > -1) SetUniform(specularTexId, 2);
+
+		variant.hasGlossTex = GetUniformLocation(program, "material.hasGlossTex");
+		assert(variant.hasGlossTex > -1);
+		const int glossTexId = GetUniformLocation(program, "material.glossTex");
+		assert(glossTexId > -1);
+		SetUniform(glossTexId, 3);
+
+		variant.hasOpacityTex = GetUniformLocation(program, "material.hasOpacityTex");
+		assert(variant.hasOpacityTex > -1);
+		const int opacityTexId = GetUniformLocation(program, "material.opacityTex");
+		assert(opacityTexId > -1);
+		SetUniform(opacityTexId, 4);
 	}
 
-	// vertex uniforms slots
-	m_modelMatrixId = GetUniformLocation(m_program, "modelMatrix");
-	assert(m_modelMatrixId > -1);
-	m_modelViewMatrixId = GetUniformLocation(m_program, "modelViewMatrix");
-	assert(m_modelViewMatrixId > -1);
-	m_modelViewProjMatrixId = GetUniformLocation(m_program, "modelViewProjMatrix");
-	assert(m_modelViewProjMatrixId > -1);
-	m_TileUId = GetUniformLocation(m_program, "TileU");
-	assert(m_TileUId > -1);
-	m_TileVId = GetUniformLocation(m_program, "TileV");
-	assert(m_TileVId > -1);
+	// vertex uniforms slots, the object matrices come from the frame ring
+	const GLuint objectBlock = glGetUniformBlockIndex(program.handle, "ObjectBlock");
+	assert(objectBlock != GL_INVALID_INDEX);
+	glUniformBlockBinding(program.handle, objectBlock, ObjectBlockBinding);
+	variant.tileU = GetUniformLocation(program, "TileU");
+	assert(variant.tileU > -1);
+	variant.tileV = GetUniformLocation(program, "TileV");
+	assert(variant.tileV > -1);
+	variant.vertexDecode.Init(program);
+	assert(variant.vertexDecode.packed > -1);
+	variant.receiveShadows = GetUniformLocation(program, "material.receiveShadows");
+
+	// frame uniforms, set once per frame by setFrameUniforms
+	variant.opacity = GetUniformLocation(program, "material.opacity");
+	variant.baseColor = GetUniformLocation(program, "material.baseColor");
+	variant.specularity = GetUniformLocation(program, "material.specularity");
+	assert((features & MaterialFeature::SpecularMap) || variant.specularity > -1);
+	variant.shininess = GetUniformLocation(program, "material.shininess");
+	variant.shadowsFarPlane = GetUniformLocation(program, "shadowsFarPlane");
+	variant.ambientStrength = GetUniformLocation(program, "ambientStrength");
+	variant.ambientColor = GetUniformLocation(program, "ambientColor");
+	variant.alphaTest = GetUniformLocation(program, "alphaTest");
+	variant.directionalLightsNumber = GetUniformLocation(program, "directionalLightsNumber");
+	variant.pointLightsNumber = GetUniformLocation(program, "pointsLightsNumber");
+
+	// light arrays, unused members are optimized out and stay -1
+	for (size_t i = 0; i < MaxDirectionalLight; i++)
+	{
+		auto& ids = variant.directionalLights[i];
+		ids.dir = GetUniformLocation(program, "directionalLights", i, "dir");
+		ids.color = GetUniformLocation(program, "directionalLights", i, "color");
+		ids.intensity = GetUniformLocation(program, "directionalLights", i, "intensity");
+		ids.castShadows = GetUniformLocation(program, "directionalLights", i, "castShadows");
+		ids.shadowMap = GetUniformLocation(program, "directionalLights", i, "shadowMap");
+		ids.lightViewProj = GetUniformLocation(program, "directionalLights", i, "lightViewProj");
+	}
+	for (size_t i = 0; i < MaxPointLight; i++)
+	{
+		auto& ids = variant.pointLights[i];
+		ids.pos = GetUniformLocation(program, "pointLights", i, "pos");
+		ids.modelPos = GetUniformLocation(program, "pointLights", i, "modelPos");
+		ids.color = GetUniformLocation(program, "pointLights", i, "color");
+		ids.intensity = GetUniformLocation(program, "pointLights", i, "intensity");
+		ids.castShadows = GetUniformLocation(program, "pointLights", i, "castShadows");
+		ids.shadowMap = GetUniformLocation(program, "pointLights", i, "shadowMap");
+	}
 
 	glUseProgram(0); // TODO: возможно вернуть прошлую версию шейдера
 
@@ -308,6 +405,6 @@ void RenderPass2::setSize(uint16_t framebufferWidth, uint16_t framebufferHeight)
 	assert(m_framebufferHeight > 0);
 
 	const float aspect = (float)m_framebufferWidth / (float)m_framebufferHeight;
-	m_perspective = glm::perspective(glm::radians(60.0f), aspect, 0.01f, 1000.0f);
+	m_perspective = glm::perspective(glm::radians(60.0f), aspect, 0.01f, ViewFarPlane);
 }
 //=============================================================================
\ No newline at end of file
@@ -7,7 +7,9 @@ struct GameWorldData;
 class RenderPass2 final
 {
 public:
+	// Init submits the program, InitProgram waits for it and resolves the uniforms
 	bool Init(uint16_t framebufferWidth, uint16_t framebufferHeight);
+	bool InitProgram();
 	void Close();
 
 	void Resize(uint16_t framebufferWidth, uint16_t framebufferHeight);
@@ -20,7 +22,7 @@ public:
 	uint16_t GetHeight() const { return m_framebufferHeight; }
 
 private:
-	bool initProgram();
+	void submitProgram();
 	bool initFBO();
 	void setSize(uint16_t framebufferWidth, uint16_t framebufferHeight);
 	void drawScene(const GameWorldData& gameData, const glm::mat4& proj, const glm::mat4& view);
@@ -29,23 +31,75 @@ private:
 	uint16_t      m_framebufferHeight{ 0 };
 	glm::mat4     m_perspective{ 1.0f };
 
-	ProgramHandle m_program{ 0 };
-	int           m_modelMatrixId{ -1 };
-	int           m_modelViewMatrixId{ -1 };
-	int           m_modelViewProjMatrixId{ -1 };
-	int           m_TileUId{ -1 };
-	int           m_TileVId{ -1 };
-
-	int           m_colorTexId{ -1 };
-	int           m_hasColorTexId{ -1 };
-	int           m_normalTexId{ -1 };
-	int           m_hasNormalTexId{ -1 };
-	int           m_specularTexId{ -1 };
-	int           m_hasSpecularTexId{ -1 };
-	int           m_glossTexId{ -1 };
-	int           m_hasGlossTexId{ -1 };
-	int           m_opacityTexId{ -1 };
-	int           m_hasOpacityTexId{ -1 };
+	struct DirectionalLightUniforms final
+	{
+		int dir{ -1 };
+		int color{ -1 };
+		int intensity{ -1 };
+		int castShadows{ -1 };
+		int shadowMap{ -1 };
+		int lightViewProj{ -1 };
+	};
+	struct PointLightUniforms final
+	{
+		int pos{ -1 };
+		int modelPos{ -1 };
+		int color{ -1 };
+		int intensity{ -1 };
+		int castShadows{ -1 };
+		int shadowMap{ -1 };
+	};
+	// locations differ between the variants of the shader
+	struct ProgramUniforms final
+	{
+		ProgramHandle        program{ 0 };
+		int                  tileU{ -1 };
+		int                  tileV{ -1 };
+		int                  receiveShadows{ -1 };
+		VertexDecodeUniforms vertexDecode;
+
+		int                  hasColorTex{ -1 };
+		int                  hasGlossTex{ -1 };
+		int                  hasOpacityTex{ -1 };
+
+		int                  opacity{ -1 };
+		int                  baseColor{ -1 };
+		int                  specularity{ -1 }; // -1 in the HAS_SPECULAR_MAP variants
+		int                  shininess{ -1 };
+		int                  shadowsFarPlane{ -1 };
+		int                  ambientStrength{ -1 };
+		int                  ambientColor{ -1 };
+		int                  alphaTest{ -1 };
+		int                  directionalLightsNumber{ -1 };
+		int                  pointLightsNumber{ -1 };
+
+		std::array<DirectionalLightUniforms, MaxDirectionalLight> directionalLights;
+		std::array<PointLightUniforms, MaxPointLight>             pointLights;
+	};
+	// feature bits of the BlinnPhong variants, the mask indexes m_variants
+	struct MaterialFeature final
+	{
+		static constexpr uint32_t NormalMap = 1u << 0;
+		static constexpr uint32_t SpecularMap = 1u << 1;
+	};
+
+	// std140 ObjectBlock of the vertex shader. The workers that build the queue write it to the frame ring
+	struct ObjectMatrices final
+	{
+		glm::mat4 model;
+		glm::mat4 modelView;
+		glm::mat4 modelViewProj;
+	};
+	static constexpr GLuint ObjectBlockBinding = 0;
+
+	bool initVariant(uint32_t features, ProgramUniforms& variant);
+	void setFrameUniforms(const ProgramUniforms& variant, const RenderPass1& rpShadowMap, const GameWorldData& gameData, std::span<const int> dirShadowUnits, std::span<const int> pointShadowUnits);
+
+	shadervariants::ShaderId       m_shader{ shadervariants::InvalidShader };
+	std::array<ProgramUniforms, 4> m_variants;
+	RenderQueue                    m_queue;
+	std::vector<glm::mat4>         m_worldMatrices; // for the meshlet culling on the GL thread
+	MeshDrawRanges                 m_drawRanges;
 
 	Framebuffer   m_fbo;
 
@@ -6,19 +6,7 @@ bool RenderPass6::Init(uint16_t framebufferWidth, uint16_t framebufferHeight)
 	m_framebufferWidth = framebufferWidth;
 	m_framebufferHeight = framebufferHeight;
 
-	m_program = LoadShaderProgram("data/shaders2/composite/vertex.shader", "data/shaders2/composite/fragment.shader"/*, std::vector<std::string>{"GAMMA_CORRECT"}*/);
-	if (!m_program.handle)
-	{
-		Fatal("Scene Composite RenderPass Shader failed!");
-		return false;
-	}
-
-	glUseProgram(m_program.handle);
-	SetUniform(GetUniformLocation(m_program, "colorInput"), 0);
-	//SetUniform(GetUniformLocation(m_program, "brightInput"), 1);
-	SetUniform(GetUniformLocation(m_program, "ssaoSampler"), 2);
-	//SetUniform(GetUniformLocation(m_program, "bloom"), false);
-	SetUniform(GetUniformLocation(m_program, "useSSAO"), EnableSSAO);
+	m_program = LoadShaderProgramAsync("data/shaders2/composite/vertex.shader", "data/shaders2/composite/fragment.shader"/*, std::vector<std::string>{"GAMMA_CORRECT"}*/);
 
 	FramebufferInfo fboInfo;
 
@@ -51,8 +39,6 @@ bool RenderPass6::Init(uint16_t framebufferWidth, uint16_t framebufferHeight)
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, currentVBO);
 
-	glUseProgram(0);
-
 	SamplerStateInfo samperCI{};
 	samperCI.minFilter = TextureFilter::Nearest;
 	samperCI.magFilter = TextureFilter::Nearest;
@@ -61,6 +47,25 @@ bool RenderPass6::Init(uint16_t framebufferWidth, uint16_t framebufferHeight)
 	return true;
 }
 //=============================================================================
+bool RenderPass6::InitProgram()
+{
+	if (!FinishShaderProgram(m_program))
+	{
+		Fatal("Scene Composite RenderPass Shader failed!");
+		return false;
+	}
+
+	glUseProgram(m_program.handle);
+	SetUniform(GetUniformLocation(m_program, "colorInput"), 0);
+	//SetUniform(GetUniformLocation(m_program, "brightInput"), 1);
+	SetUniform(GetUniformLocation(m_program, "ssaoSampler"), 2);
+	//SetUniform(GetUniformLocation(m_program, "bloom"), false);
+	SetUniform(GetUniformLocation(m_program, "useSSAO"), EnableSSAO);
+	glUseProgram(0);
+
+	return true;
+}
+//=============================================================================
 void RenderPass6::Close()
 {
 	glDeleteProgram(m_program.handle);
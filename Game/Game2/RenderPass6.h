@@ -3,7 +3,9 @@
 class RenderPass6 final
 {
 public:
+	// Init submits the program, InitProgram waits for it and sets the samplers
 	bool Init(uint16_t framebufferWidth, uint16_t framebufferHeight);
+	bool InitProgram();
 	void Close();
 
 	void Resize(uint16_t framebufferWidth, uint16_t framebufferHeight);
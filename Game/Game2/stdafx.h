@@ -14,6 +14,8 @@
 #include <Engine/NanoRender.h>
 #include <Engine/NanoRenderGeometryGen.h>
 #include <Engine/NanoRenderModel.h>
+#include <Engine/OGLShaderVariants.h>
+#include <Engine/OGLStateCache.h>
 
 #include <Engine/Transform.h>
 #include <Engine/NanoScene.h>
@@ -31,7 +31,12 @@ void GameApp()
 		camera.MovementSpeed = 10.0f;
 		camera.SetPosition(glm::vec3(0.0f, 2.5f, -1.0f));
 
-		modelLevel.model.Load("data/models/ForgottenPlains/Forgotten_Plains_Demo.obj", ModelMaterialType::BlinnPhong);
+		ModelLoadInfo levelLoadInfo{};
+		levelLoadInfo.optimize = true;
+		levelLoadInfo.generateLods = true;
+		levelLoadInfo.vertexFormat = MeshVertexFormat::Packed;
+		levelLoadInfo.buildMeshlets = true;
+		modelLevel.model.LoadAsync("data/models/ForgottenPlains/Forgotten_Plains_Demo.obj", ModelMaterialType::BlinnPhong, levelLoadInfo);
 		modelLevel.modelMat = glm::translate(glm::mat4(1.0f), glm::vec3(-30.0f, -10.0f, 15.0f));
 
 		glEnable(GL_CULL_FACE);
@@ -5,4 +5,7 @@ struct GameModel final
 	Model     model;
 	glm::mat4 modelMat{ glm::mat4(1.0f) };
 	bool      visible{ true };
+	Texture2DArrayHandle tileTextures{ 0 }; // map chunks: diffuse layers selected per vertex
+
+	std::vector<uint8_t> meshLods; // per mesh level of detail with hysteresis
 };
\ No newline at end of file
@@ -1,26 +1,10 @@
 ﻿#include "stdafx.h"
 #include "GeomMap.h"
 #include "GeomTileMap.h"
+#include "GeomTileTextures.h"
 #include "MapLoadObjTile.h"
 #include "Map.h"
 //=============================================================================
-size_t addMeshInfo(std::vector<MeshInfo>& meshInfo, Texture2D texId)
-{
-	for (size_t i = 0; i < meshInfo.size(); i++)
-	{
-		if (meshInfo[i].material->diffuseTextures[0] == texId)
-		{
-			return i;
-		}
-	}
-
-	MeshInfo nmi{};
-	nmi.material = Material();
-	nmi.material->diffuseTextures.push_back(texId);
-	meshInfo.push_back(nmi);
-	return meshInfo.size() - 1;
-}
-//=============================================================================
 inline std::string getFileNameBlock(TileGeometryType type)
 {
 	switch (type)
@@ -54,9 +38,9 @@ bool MapChunk::Init(Map& map)
 {
 	TileInfo tempTile;
 	tempTile.type = TileGeometryType::Block00;
-	tempTile.textureWall = textures::LoadTexture2D("data/tiles/grass01_wall.png", ColorSpace::Linear, true);
-	tempTile.textureCeil = textures::LoadTexture2D("data/tiles/grass01_ceil.png");
-	tempTile.textureFloor = textures::LoadTexture2D("data/tiles/grass01.png");
+	tempTile.textureWall = TileTextures::AddTexture("data/tiles/grass01_wall.png", true);
+	tempTile.textureCeil = TileTextures::AddTexture("data/tiles/grass01_ceil.png");
+	tempTile.textureFloor = TileTextures::AddTexture("data/tiles/grass01.png");
 
 	for (size_t x = 0; x < 7; x++)
 	{
@@ -67,9 +51,9 @@ bool MapChunk::Init(Map& map)
 	}
 
 	tempTile.type = TileGeometryType::Block01;
-	tempTile.textureWall = textures::LoadTexture2D("data/tiles/grass01_wall.png", ColorSpace::Linear, true);
-	tempTile.textureCeil = textures::LoadTexture2D("data/tiles/grass01_ceil.png");
-	tempTile.textureFloor = textures::LoadTexture2D("data/tiles/grass01.png");
+	tempTile.textureWall = TileTextures::AddTexture("data/tiles/grass01_wall.png", true);
+	tempTile.textureCeil = TileTextures::AddTexture("data/tiles/grass01_ceil.png");
+	tempTile.textureFloor = TileTextures::AddTexture("data/tiles/grass01.png");
 	tempTile.rotate = RotateAngleY::Rotate270;
 	map.SetGeomTile(TileBank::AddTileInfo(tempTile), 16, 17, 1);
 	tempTile.rotate = RotateAngleY::Rotate0;
@@ -89,6 +73,8 @@ bool MapChunk::Init(Map& map)
 //=============================================================================
 void MapChunk::Close()
 {
+	m_model.model.Free();
+	TileTextures::Close();
 }
 //=============================================================================
 void MapChunk::RecreateBuffer(Map& map)
@@ -99,7 +85,8 @@ void MapChunk::RecreateBuffer(Map& map)
 //=============================================================================
 void MapChunk::generateBufferMap(Map& map)
 {
-	std::vector<MeshInfo> meshInfo;
+	// one mesh for the whole chunk, the tile texture is picked by the layer in the vertex
+	std::vector<MeshInfo> meshInfo(1);
 	m_vertCount = 0;
 	m_indexCount = 0;
 
@@ -125,23 +112,28 @@ void MapChunk::generateBufferMap(Map& map)
 				blockModelInfo.rotate = getRotateAngle(id.rotate);
 				setVisibleBlock(map, id, blockModelInfo, ix, iy, iz);
 				blockModelInfo.modelPath = getFileNameBlock(id.type);
+				blockModelInfo.textureWall = id.textureWall;
+				blockModelInfo.textureCeil = id.textureCeil;
+				blockModelInfo.textureFloor = id.textureFloor;
 
-				size_t idWall  = addMeshInfo(meshInfo, id.textureWall);
-				size_t idFloor = addMeshInfo(meshInfo, id.textureFloor);
-				size_t idCeil  = addMeshInfo(meshInfo, id.textureCeil);
-
-				AddObjModel(blockModelInfo, meshInfo[idWall], meshInfo[idCeil], meshInfo[idFloor]);
+				AddObjModel(blockModelInfo, meshInfo[0]);
 			}
 		}
 	}
 
-	for (size_t i = 0; i < meshInfo.size(); i++)
+	TileTextures::Build();
+	m_model.tileTextures = TileTextures::GetTexture();
+
+	ModelLoadInfo loadInfo{};
+	loadInfo.optimize = true;
+	loadInfo.vertexFormat = MeshVertexFormat::Full; // tangent.x is the texture layer
+	m_model.model.Create(meshInfo, loadInfo);
+
+	for (const auto& mesh : m_model.model.GetMeshes())
 	{
-		m_vertCount += meshInfo[i].vertices.size();
-		m_indexCount += meshInfo[i].indices.size();
+		m_vertCount += mesh.GetVertexCount();
+		m_indexCount += mesh.GetIndexCount();
 	}
-
-	m_model.model.Create(meshInfo);
 }
 //=============================================================================
 bool testVisBlock(Map& map, TileGeometryType tile, size_t x, size_t y, size_t z)
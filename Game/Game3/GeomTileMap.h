@@ -29,9 +29,10 @@ struct TileInfo final
 
 	TileGeometryType type{};
 	glm::vec4 color{ 1.0f };
-	Texture2D textureFloor;
-	Texture2D textureCeil;
-	Texture2D textureWall;
+	// layers of TileTextures
+	uint32_t textureFloor{ 0 };
+	uint32_t textureCeil{ 0 };
+	uint32_t textureWall{ 0 };
 	RotateAngleY rotate{ RotateAngleY::Rotate0 };
 };
 
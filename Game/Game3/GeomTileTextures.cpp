@@ -0,0 +1,108 @@
+﻿#include "stdafx.h"
+#include "GeomTileTextures.h"
+#include "NanoJobs.h"
+#include <stb/stb_image_resize2.h>
+//=============================================================================
+struct TileImage final
+{
+	std::string fileName;
+	bool        flipVertical{ false };
+};
+//=============================================================================
+namespace
+{
+	std::vector<TileImage> TileImages;
+	Texture2DArrayHandle   TileArray;
+	uint32_t               TileArrayLayers{ 0 };
+}
+//=============================================================================
+uint32_t TileTextures::AddTexture(const std::string& fileName, bool flipVertical)
+{
+	for (size_t i = 0; i < TileImages.size(); i++)
+	{
+		if (TileImages[i].fileName == fileName && TileImages[i].flipVertical == flipVertical)
+			return static_cast<uint32_t>(i);
+	}
+	TileImages.push_back({ fileName, flipVertical });
+	return static_cast<uint32_t>(TileImages.size() - 1);
+}
+//=============================================================================
+bool TileTextures::Build()
+{
+	if (TileImages.empty() || (IsValid(TileArray) && TileArrayLayers == TileImages.size()))
+		return true;
+
+	struct DecodedImage final
+	{
+		stbi_uc* pixels{ nullptr };
+		int      width{ 0 };
+		int      height{ 0 };
+	};
+	std::vector<DecodedImage> decoded(TileImages.size());
+	jobs::ParallelFor(TileImages.size(), [&](size_t i)
+		{
+			int components = 0;
+			// the flip flag of stb_image is global, the thread local one overrides it for this worker
+			stbi_set_flip_vertically_on_load_thread(TileImages[i].flipVertical);
+			decoded[i].pixels = stbi_load(TileImages[i].fileName.c_str(), &decoded[i].width, &decoded[i].height, &components, STBI_rgb_alpha);
+		});
+
+	size_t first = 0;
+	while (first < decoded.size() && !decoded[first].pixels) first++;
+	if (first == decoded.size())
+	{
+		Error("Tile textures failed to load");
+		return false;
+	}
+	const int width = decoded[first].width;
+	const int height = decoded[first].height;
+
+	Destroy(TileArray);
+	TileArray = CreateTexture2DArray(InternalFormat::RGBA8, static_cast<unsigned>(width), static_cast<unsigned>(height), static_cast<unsigned>(decoded.size()), PixelFormat::Rgba, PixelType::UnsignedByte);
+	if (!IsValid(TileArray))
+		return false;
+
+	const std::vector<uint8_t> white(static_cast<size_t>(width) * height * 4, 255);
+	std::vector<uint8_t> resized;
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		const uint8_t* layerPixels = decoded[i].pixels;
+		if (!layerPixels)
+		{
+			Error("Failed to load tile texture: " + TileImages[i].fileName);
+			layerPixels = white.data();
+		}
+		else if (decoded[i].width != width || decoded[i].height != height)
+		{
+			Warning("Tile texture " + TileImages[i].fileName + " is resized to " + std::to_string(width) + "x" + std::to_string(height));
+			resized.resize(white.size());
+			stbir_resize_uint8_linear(decoded[i].pixels, decoded[i].width, decoded[i].height, 0, resized.data(), width, height, 0, STBIR_RGBA);
+			layerPixels = resized.data();
+		}
+		SetTextureLayerData(TileArray, static_cast<unsigned>(i), static_cast<unsigned>(width), static_cast<unsigned>(height), PixelFormat::Rgba, PixelType::UnsignedByte, layerPixels);
+		stbi_image_free(decoded[i].pixels);
+	}
+
+	TextureConfig config{};
+	SetTextureParameters(TileArray, config);
+	TileArrayLayers = static_cast<uint32_t>(decoded.size());
+	return true;
+}
+//=============================================================================
+void TileTextures::Close()
+{
+	Destroy(TileArray);
+	TileArrayLayers = 0;
+	TileImages.clear();
+}
+//=============================================================================
+Texture2DArrayHandle TileTextures::GetTexture()
+{
+	return TileArray;
+}
+//=============================================================================
+uint32_t TileTextures::GetLayerCount()
+{
+	return TileArrayLayers;
+}
+//=============================================================================
@@ -0,0 +1,16 @@
+﻿#pragma once
+
+// All tile images in one texture array, the map chunk keeps the layer in the vertex and draws in one call
+namespace TileTextures
+{
+	// returns the layer of the image. The same file and flip give the same layer
+	uint32_t AddTexture(const std::string& fileName, bool flipVertical = false);
+
+	// GL thread. When images were added since the last call, decodes all of them on the job system and recreates
+	// the RGBA8 array with mips. The array takes the size of the first image, others are resized to it
+	bool Build();
+	void Close();
+
+	Texture2DArrayHandle GetTexture();
+	uint32_t GetLayerCount();
+} // namespace TileTextures
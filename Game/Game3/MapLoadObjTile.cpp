@@ -23,7 +23,7 @@ struct IndexLess
 	}
 };
 //=============================================================================
-void ProcessModelData(const ObjModelData& model_data, const BlockModelInfo& modelInfo, MeshInfo& meshWall, MeshInfo& meshCeil, MeshInfo& meshFloor)
+void ProcessModelData(const ObjModelData& model_data, const BlockModelInfo& modelInfo, MeshInfo& mesh)
 {
 	glm::mat4 rotation_matrix(1.0f);
 
@@ -61,55 +61,37 @@ void ProcessModelData(const ObjModelData& model_data, const BlockModelInfo& mode
 	for (size_t s = 0; s < shapes.size(); s++)
 	{
 		const auto& name = shapes[s].name;
-		std::vector<MeshVertex>* vertices = nullptr;
-		std::vector<unsigned int>* indices = nullptr;
+		std::vector<MeshVertex>* vertices = &mesh.vertices;
+		std::vector<unsigned int>* indices = &mesh.indices;
+		uint32_t layer = modelInfo.textureWall;
 
 		if (name == "bottom")
 		{
 			if (!modelInfo.bottomVisible) continue;
 
-			vertices = &meshCeil.vertices;
-			indices = &meshCeil.indices;
+			layer = modelInfo.textureCeil;
 		}
 		else if (name == "top")
 		{
 			if (!modelInfo.topVisible) continue;
 
-			vertices = &meshFloor.vertices;
-			indices = &meshFloor.indices;
+			layer = modelInfo.textureFloor;
 		}
 		else if (name == "left")
 		{
 			if (!modelInfo.leftVisible) continue;
-
-			vertices = &meshWall.vertices;
-			indices = &meshWall.indices;
 		}
 		else if (name == "right")
 		{
 			if (!modelInfo.rightVisible) continue;
-
-			vertices = &meshWall.vertices;
-			indices = &meshWall.indices;
 		}
 		else if (name == "forward")
 		{
 			if (!modelInfo.forwardVisible) continue;
-
-			vertices = &meshWall.vertices;
-			indices = &meshWall.indices;
 		}
 		else if (name == "back")
 		{
 			if (!modelInfo.backVisible) continue;
-
-			vertices = &meshWall.vertices;
-			indices = &meshWall.indices;
-		}
-		else
-		{
-			vertices = &meshWall.vertices;
-			indices = &meshWall.indices;
 		}
 
 		// Используем std::map с пользовательской функцией сравнения для tinyobj::index_t
@@ -192,8 +174,8 @@ void ProcessModelData(const ObjModelData& model_data, const BlockModelInfo& mode
 					// Цвет (установим по умолчанию, так как OBJ обычно не хранит цвет вершины)
 					vertex.color = glm::vec3(1.0f, 1.0f, 1.0f);
 
-					// Тангент и битангент (установим по умолчанию, так как их нужно вычислять отдельно)
-					vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+					// Тайлы без карт нормалей: tangent.x хранит слой TileTextures (поэтому меш чанка только в формате Full)
+					vertex.tangent = glm::vec3(static_cast<float>(layer), 0.0f, 0.0f);
 					vertex.bitangent = glm::vec3(0.0f, 0.0f, 0.0f);
 
 					// Добавляем вершину в массив
@@ -216,7 +198,7 @@ void ProcessModelData(const ObjModelData& model_data, const BlockModelInfo& mode
 	}
 }
 //=============================================================================
-void AddObjModel(const BlockModelInfo& modelInfo, MeshInfo& meshWall, MeshInfo& meshCeil, MeshInfo& meshFloor)
+void AddObjModel(const BlockModelInfo& modelInfo, MeshInfo& mesh)
 {
 	// Проверяем, есть ли модель в кэше
 	auto it = model_cache.find(modelInfo.modelPath);
@@ -224,7 +206,7 @@ void AddObjModel(const BlockModelInfo& modelInfo, MeshInfo& meshWall, MeshInfo&
 	{
 		// Используем кэшированные данные
 		const auto& cached_data = it->second;
-		ProcessModelData(cached_data, modelInfo, meshWall, meshCeil, meshFloor);
+		ProcessModelData(cached_data, modelInfo, mesh);
 	}
 	else
 	{
@@ -251,7 +233,7 @@ void AddObjModel(const BlockModelInfo& modelInfo, MeshInfo& meshWall, MeshInfo&
 		model_data.materials = materials;
 		model_cache[modelInfo.modelPath] = model_data;
 
-		ProcessModelData(model_data, modelInfo, meshWall, meshCeil, meshFloor);
+		ProcessModelData(model_data, modelInfo, mesh);
 	}
 }
 //=============================================================================
\ No newline at end of file
@@ -5,6 +5,11 @@ struct BlockModelInfo final
 	std::string modelPath;
 	glm::vec3 color{ 1.0f };
 
+	// layers of TileTextures
+	uint32_t textureWall{ 0 };
+	uint32_t textureCeil{ 0 };
+	uint32_t textureFloor{ 0 };
+
 	glm::vec3 center{ 0.0f };
 	glm::vec3 rotate{ 0.0f }; // Порядок вращения: Z (roll), Y (yaw), X (pitch) в радианах
 
@@ -16,4 +21,4 @@ struct BlockModelInfo final
 	bool bottomVisible{ true };
 };
 
-void AddObjModel(const BlockModelInfo& modelInfo, MeshInfo& meshWall, MeshInfo& meshCeil, MeshInfo& meshFloor);
\ No newline at end of file
+void AddObjModel(const BlockModelInfo& modelInfo, MeshInfo& mesh);
\ No newline at end of file
@@ -45,8 +45,10 @@ void RenderPass2::Draw(const GameWorldData& gameData)
 	SetUniform(GetUniformLocation(m_program, "viewPos"), gameData.camera->Position);
 	
 	glBindSampler(0, m_sampler.handle);
+	glBindSampler(1, m_sampler.handle);
 	drawScene(gameData);
 	glBindSampler(0, 0);
+	glBindSampler(1, 0);
 
 	//glDisable(GL_DEPTH_TEST);
 	m_mapGrid.Draw(m_perspective, gameData.camera->GetViewMatrix());
@@ -65,16 +67,34 @@ void RenderPass2::drawScene(const GameWorldData& gameData)
 	bool hasDiffuseMap = false;
 	Texture2DHandle diffuseTex{ 0 };
 
+	LodSelectInfo lodInfo{};
+	lodInfo.projScale = GetLodProjScale(m_perspective, static_cast<float>(m_framebufferHeight));
+
+	MeshletCullInfo cullInfo{};
+	cullInfo.viewProj = m_perspective * gameData.camera->GetViewMatrix();
+	cullInfo.viewPosition = gameData.camera->Position;
+
 	for (size_t i = 0; i < gameData.countGameModels; i++)
 	{
-		if (!gameData.gameModels[i] || !gameData.gameModels[i]->visible)
+		if (!gameData.gameModels[i] || !gameData.gameModels[i]->visible || !gameData.gameModels[i]->model.IsReady())
 			continue;
 
 		SetUniform(GetUniformLocation(m_program, "modelMatrix"), gameData.gameModels[i]->modelMat);
+		cullInfo.worldMatrix = gameData.gameModels[i]->modelMat;
+
+		const Texture2DArrayHandle tileTextures = gameData.gameModels[i]->tileTextures;
+		SetUniform(GetUniformLocation(m_program, "hasTileTextures"), IsValid(tileTextures));
+		if (IsValid(tileTextures))
+			BindTexture2DArray(1, tileTextures);
 
 		const auto& meshes = gameData.gameModels[i]->model.GetMeshes();
-		for (const auto& mesh : meshes)
+		auto& meshLods = gameData.gameModels[i]->meshLods;
+		meshLods.resize(meshes.size(), 0);
+		for (size_t meshId = 0; meshId < meshes.size(); meshId++)
 		{
+			const auto& mesh = meshes[meshId];
+			meshLods[meshId] = static_cast<uint8_t>(mesh.SelectLod(GetLodDistance(mesh.GetAABB(), gameData.gameModels[i]->modelMat, gameData.camera->Position), lodInfo, meshLods[meshId]));
+
 			const auto& material = mesh.GetMaterial();
 			diffuseTex.handle = 0;
 			if (material)
@@ -88,9 +108,11 @@ void RenderPass2::drawScene(const GameWorldData& gameData)
 
 			SetUniform(GetUniformLocation(m_program, "hasDiffuseTex"), IsValid(diffuseTex));
 			BindTexture2D(0, diffuseTex);
-			mesh.Draw(GL_TRIANGLES);
+			m_vertexDecode.Set(mesh);
+			mesh.DrawCulled(cullInfo, m_drawRanges, meshLods[meshId]);
 		}
 	}
+	geometry::ResetBinding();
 }
 //=============================================================================
 bool RenderPass2::initProgram()
@@ -106,6 +128,12 @@ bool RenderPass2::initProgram()
 	int diffuseMap = GetUniformLocation(m_program, "diffuseTexture");
 	assert(diffuseMap > -1);
 	SetUniform(diffuseMap, 0);
+
+	int tileMap = GetUniformLocation(m_program, "tileTextures");
+	assert(tileMap > -1);
+	SetUniform(tileMap, 1);
+
+	m_vertexDecode.Init(m_program);
 	
 	glUseProgram(0); // TODO: возможно вернуть прошлую версию шейдера
 
@@ -28,6 +28,8 @@ private:
 
 	ProgramHandle m_program{ 0 };
 	int           m_modelMatrixId{ -1 };
+	VertexDecodeUniforms m_vertexDecode;
+	MeshDrawRanges m_drawRanges;
 
 	Framebuffer   m_fbo;
 
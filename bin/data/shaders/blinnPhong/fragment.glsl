@@ -236,8 +236,9 @@ void main()
 	vec3 normal;
 	if (hasNormalMap)
 	{
-		vec3 normalMap = texture(material.normalMap, fs_in.TexCoords).rgb;
-		normalMap = normalMap * 2.0 - 1.0; // Transform from [0,1] to [-1,1]
+		vec3 normalMap;
+		normalMap.xy = texture(material.normalMap, fs_in.TexCoords).rg * 2.0 - 1.0; // Transform from [0,1] to [-1,1]
+		normalMap.z = sqrt(max(1.0 - dot(normalMap.xy, normalMap.xy), 0.0)); // BC5 normal maps store only xy
 		normal = normalize(fs_in.TBN * normalMap);
 	}
 	else
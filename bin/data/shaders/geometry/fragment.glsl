@@ -34,8 +34,8 @@ void main()
 	gPosition.rgb = fs_in.FragPos;
 	if(material.hasNormal == 1)
 	{
-		Normal = texture(normalTexture, fs_in.TexCoords).rgb;
-		Normal = normalize(Normal * 2.0f - 1.0f);
+		Normal.xy = texture(normalTexture, fs_in.TexCoords).rg * 2.0f - 1.0f;
+		Normal.z = sqrt(max(1.0f - dot(Normal.xy, Normal.xy), 0.0f)); // BC5 normal maps store only xy
 		Normal = normalize(fs_in.TBN * Normal);
 	}
 	else
@@ -0,0 +1,32 @@
+// Decode of MeshVertex and MeshVertexPacked (see OGLVertexAttribute.h). Attributes are declared by the including shader:
+// location 0 vec4 position - packed: unorm16 inside the mesh AABB, w - bitangent sign
+// location 2 vec3 normal   - packed: octahedral snorm16 in xy
+// location 3 vec2 texCoord - packed: half float, no decode
+// location 4 vec3 tangent  - packed: octahedral snorm16 in xy
+
+uniform bool vertexPacked;
+uniform vec3 vertexPositionOffset;
+uniform vec3 vertexPositionScale;
+
+vec3 OctDecode(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
+vec3 DecodePosition(vec4 position)
+{
+	return vertexPacked ? vertexPositionOffset + position.xyz * vertexPositionScale : position.xyz;
+}
+
+vec3 DecodeDirection(vec3 direction)
+{
+	return vertexPacked ? OctDecode(direction.xy) : direction;
+}
+
+vec3 DecodeBitangent(vec4 position, vec3 normal, vec3 tangent, vec3 bitangent)
+{
+	return vertexPacked ? cross(normal, tangent) * (position.w > 0.5 ? 1.0 : -1.0) : bitangent;
+}
\ No newline at end of file
@@ -45,13 +45,12 @@ struct SpotLight
 
 //==========================================
 // Material
+// normal and specular maps are variants (HAS_NORMAL_MAP, HAS_SPECULAR_MAP), without them the samplers are unused
 
 struct Material
 {
 	bool hasColorTex;
-	bool hasSpecularTex;
 	bool hasGlossTex;
-	bool hasNormalTex;
 	bool hasOpacityTex;
 
 	sampler2D colorTex;
@@ -244,9 +243,21 @@ vec3 shade()
 
 void main()
 {
-	material.hasNormalTex ? N = normalize(fs_in.TBN * (texture(material.normalTex, fs_in.texCoords).rgb * 2.0 - 1.0)) : N = fs_in.normal;
+#if defined(HAS_NORMAL_MAP)
+	// z is rebuilt from xy, BC5 normal maps store only two channels
+	vec3 tangentNormal;
+	tangentNormal.xy = texture(material.normalTex, fs_in.texCoords).rg * 2.0 - 1.0;
+	tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+	N = normalize(fs_in.TBN * tangentNormal);
+#else
+	N = fs_in.normal;
+#endif
 	material.hasColorTex ? albedo = texture(material.colorTex, fs_in.texCoords) : albedo = vec4(material.baseColor, 1.0);
-	material.hasSpecularTex ? specularity = texture(material.specularTex, fs_in.texCoords).r : specularity = material.specularity;
+#if defined(HAS_SPECULAR_MAP)
+	specularity = texture(material.specularTex, fs_in.texCoords).r;
+#else
+	specularity = material.specularity;
+#endif
 	material.hasGlossTex ? shininess = texture(material.glossTex, fs_in.texCoords).r : shininess = material.shininess;
 	material.hasOpacityTex ? opacity = texture(material.opacityTex, fs_in.texCoords).r : opacity = material.opacity;
 	if (alphaTest && (opacity <= 0.0 || albedo.a < alphaClippingThreshold)) discard;
@@ -1,15 +1,21 @@
 #version 330 core
 
-layout(location = 0) in vec3 vertexPosition;
+layout(location = 0) in vec4 vertexPosition;
 layout(location = 1) in vec3 vertexColor;
 layout(location = 2) in vec3 vertexNormal;
 layout(location = 3) in vec2 vertexTexCoord;
 layout(location = 4) in vec3 vertexTangent;
 layout(location = 5) in vec3 vertexBitangent;
 
-uniform mat4 modelMatrix;
-uniform mat4 modelViewMatrix;
-uniform mat4 modelViewProjMatrix;
+#include "../../shaders/vertexDecode.glsl"
+
+// per object, bound from the frame ring
+layout(std140) uniform ObjectBlock
+{
+	mat4 modelMatrix;
+	mat4 modelViewMatrix;
+	mat4 modelViewProjMatrix;
+};
 
 uniform float TileU;
 uniform float TileV;
@@ -25,22 +31,30 @@ out VS_OUT {
 
 void main()
 {
+	vec3 position = DecodePosition(vertexPosition);
+	vec3 normal = DecodeDirection(vertexNormal);
+
 	vs_out.vertColor = vertexColor;
 
 	vs_out.texCoords = vertexTexCoord;
 	vs_out.texCoords.x *= TileU;
 	vs_out.texCoords.y *= TileV;
 
-	vs_out.pos = (modelViewMatrix * vec4(vertexPosition, 1.0)).xyz;
-	vs_out.modelPos = (modelMatrix * vec4(vertexPosition, 1.0)).xyz;
+	vs_out.pos = (modelViewMatrix * vec4(position, 1.0)).xyz;
+	vs_out.modelPos = (modelMatrix * vec4(position, 1.0)).xyz;
 
-	vec3 T = -normalize(vec3(modelViewMatrix * vec4(vertexTangent, 0.0)));
-	vec3 N = normalize(vec3(modelViewMatrix * vec4(vertexNormal, 0.0)));
+#if defined(HAS_NORMAL_MAP)
+	vec3 tangent = DecodeDirection(vertexTangent);
+	vec3 T = -normalize(vec3(modelViewMatrix * vec4(tangent, 0.0)));
+	vec3 N = normalize(vec3(modelViewMatrix * vec4(normal, 0.0)));
 	vec3 B = cross(N, T);
 
 	vs_out.TBN = mat3(T, B, N);
+#else
+	vs_out.TBN = mat3(1.0);
+#endif
 
-	vs_out.normal = mat3(transpose(inverse(modelViewMatrix))) * vertexNormal;
+	vs_out.normal = mat3(transpose(inverse(modelViewMatrix))) * normal;
 
-	gl_Position = modelViewProjMatrix * vec4(vertexPosition, 1.0f);
+	gl_Position = modelViewProjMatrix * vec4(position, 1.0f);
 }
\ No newline at end of file
@@ -24,12 +24,15 @@ in VS_OUT {
 	vec3 fragPos;
 	vec3 normal;
 	vec2 texCoords;
+	flat float texLayer;
 } fs_in;
 
 const float alphaClippingThreshold = 0.1;
 
 uniform sampler2D diffuseTexture;
 uniform bool hasDiffuseTex;
+uniform sampler2DArray tileTextures;
+uniform bool hasTileTextures;
 
 //uniform SphereLight sphereLight[4];
 //uniform Fog fog;
@@ -82,7 +85,9 @@ void main()
 	fog.density = 0.1;
 
 	vec4 diffuse = vec4(fs_in.vertColor, 1.0);
-	if (hasDiffuseTex) 
+	if (hasTileTextures)
+		diffuse = texture(tileTextures, vec3(fs_in.texCoords, fs_in.texLayer)) * diffuse;
+	else if (hasDiffuseTex)
 		diffuse = texture(diffuseTexture, fs_in.texCoords) * diffuse;
 	if (diffuse.a < alphaClippingThreshold) discard;
 
@@ -1,12 +1,14 @@
 #version 330 core
 
-layout(location = 0) in vec3 vertexPosition;
+layout(location = 0) in vec4 vertexPosition;
 layout(location = 1) in vec3 vertexColor;
 layout(location = 2) in vec3 vertexNormal;
 layout(location = 3) in vec2 vertexTexCoord;
 layout(location = 4) in vec3 vertexTangent;
 layout(location = 5) in vec3 vertexBitangent;
 
+#include "../shaders/vertexDecode.glsl"
+
 uniform mat4 projectionMatrix;
 uniform mat4 viewMatrix;
 uniform mat4 modelMatrix;
@@ -16,13 +18,17 @@ out VS_OUT {
 	vec3 fragPos;
 	vec3 normal;
 	vec2 texCoords;
+	flat float texLayer;
 } vs_out;
 
 void main()
 {
+	vec3 position = DecodePosition(vertexPosition);
+
 	vs_out.vertColor = vertexColor;
-	vs_out.fragPos = vec3(modelMatrix * vec4(vertexPosition, 1.0));
+	vs_out.fragPos = vec3(modelMatrix * vec4(position, 1.0));
 	vs_out.texCoords = vertexTexCoord;
-	vs_out.normal = normalize(mat3(transpose(inverse(modelMatrix))) * vertexNormal);
-	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(vertexPosition, 1.0f);
+	vs_out.texLayer = vertexTangent.x; // map chunks: layer of tileTextures
+	vs_out.normal = normalize(mat3(transpose(inverse(modelMatrix))) * DecodeDirection(vertexNormal));
+	gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(position, 1.0f);
 }
\ No newline at end of file